@@ -0,0 +1,274 @@
+// the printer is the only writer of its file, so it uses the unlocked stdio functions
+#define _GNU_SOURCE
+#include "asmPrinter.h"
+#include "machineIR.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the output goes through the stdio buffer of the file, so the text never exists as a whole in memory
+static void appendLength(FILE* file, const char* string, size_t length) {
+	fwrite_unlocked(string, 1, length, file);
+}
+
+static void appendString(FILE* file, const char* string) {
+	fputs_unlocked(string, file);
+}
+
+static void appendChar(FILE* file, char c) {
+	putc_unlocked(c, file);
+}
+
+// explicit sign for frame offsets like [rbp-8]
+static void appendNumber(FILE* file, long long value, bool sign) {
+
+	char digits[24];
+	int idx = sizeof(digits);
+	unsigned long long magnitude = value < 0 ? -(unsigned long long)value : (unsigned long long)value;
+
+	do {
+		digits[--idx] = '0' + magnitude % 10;
+		magnitude /= 10;
+	} while (magnitude != 0);
+
+	if (value < 0) {
+		digits[--idx] = '-';
+	}
+	else if (sign) {
+		digits[--idx] = '+';
+	}
+
+	appendLength(file, digits + idx, sizeof(digits) - idx);
+}
+
+const char* registerName(Register reg, int size) {
+	static const char* register_names[16][4] = {
+		{"al",   "ax",   "eax",  "rax"},
+		{"cl",   "cx",   "ecx",  "rcx"},
+		{"dl",   "dx",   "edx",  "rdx"},
+		{"bl",   "bx",   "ebx",  "rbx"},
+		{"spl",  "sp",   "esp",  "rsp"},
+		{"bpl",  "bp",   "ebp",  "rbp"},
+		{"sil",  "si",   "esi",  "rsi"},
+		{"dil",  "di",   "edi",  "rdi"},
+		{"r8b",  "r8w",  "r8d",  "r8" },
+		{"r9b",  "r9w",  "r9d",  "r9" },
+		{"r10b", "r10w", "r10d", "r10"},
+		{"r11b", "r11w", "r11d", "r11"},
+		{"r12b", "r12w", "r12d", "r12"},
+		{"r13b", "r13w", "r13d", "r13"},
+		{"r14b", "r14w", "r14d", "r14"},
+		{"r15b", "r15w", "r15d", "r15"}
+	};
+
+	if (reg < RAX_REG || reg > R15_REG) {
+		return NULL;
+	}
+
+	switch (size) {
+		case 1: return register_names[reg][0];
+		case 2: return register_names[reg][1];
+		case 4: return register_names[reg][2];
+		case 8: return register_names[reg][3];
+		default:
+			return NULL;
+	}
+}
+
+static const char* conditionName(Condition condition) {
+	switch (condition) {
+		case LESS_COND: return "l";
+		case LESS_EQUAL_COND: return "le";
+		case GREATER_COND: return "g";
+		case GREATER_EQUAL_COND: return "ge";
+		case EQUAL_COND: return "e";
+		case NOT_EQUAL_COND: return "ne";
+		case ZERO_COND: return "z";
+		case NOT_ZERO_COND: return "nz";
+		default: return "?";
+	}
+}
+
+static const char* opcodeName(Opcode opcode) {
+	switch (opcode) {
+		case MOV_INSTR: return "mov";
+		case MOVZX_INSTR: return "movzx";
+		case ADD_INSTR: return "add";
+		case SUB_INSTR: return "sub";
+		case IMUL_INSTR: return "imul";
+		case IDIV_INSTR: return "idiv";
+		case CDQ_INSTR: return "cdq";
+		case NEG_INSTR: return "neg";
+		case CMP_INSTR: return "cmp";
+		case TEST_INSTR: return "test";
+		case SETCC_INSTR: return "set";
+		case JMP_INSTR: return "jmp";
+		case JCC_INSTR: return "j";
+		case CALL_INSTR: return "call";
+		case PUSH_INSTR: return "push";
+		case POP_INSTR: return "pop";
+		case LEAVE_INSTR: return "leave";
+		case RET_INSTR: return "ret";
+		default: return "?";
+	}
+}
+
+static void appendLabel(FILE* file, MachineFunction* function, Operand* label) {
+
+	appendString(file, function->id);
+
+	switch (label->as.label.kind) {
+		case BLOCK_LABEL:
+			appendString(file, "_block_");
+			break;
+		case RETURN_LABEL:
+			appendString(file, "_return");
+			return;
+	}
+
+	appendNumber(file, label->as.label.number, false);
+}
+
+// memory operands need an explicit width when no register operand implies it
+static bool needsSizeKeyword(MachineInstr* instr, Operand* operand, Operand* other) {
+	if (operand->kind != FRAME_OPERAND && operand->kind != GLOBAL_OPERAND) {
+		return false;
+	}
+	return instr->opcode == MOVZX_INSTR || other->kind != REGISTER_OPERAND;
+}
+
+static const char* sizeKeyword(int size) {
+	switch (size) {
+		case 1: return "byte ";
+		case 2: return "word ";
+		case 4: return "dword ";
+		default: return "qword ";
+	}
+}
+
+static void appendOperand(FILE* file, MachineFunction* function, Operand* operand) {
+	switch (operand->kind) {
+		case REGISTER_OPERAND: {
+			// only seen when printing before register allocation
+			if (isVirtualRegister(operand)) {
+				appendString(file, "%v");
+				appendNumber(file, operand->as.reg - FIRST_VIRTUAL_REG, false);
+				break;
+			}
+			const char* name = registerName(operand->as.reg, operand->size);
+			appendString(file, name != NULL ? name : "?");
+			break;
+		}
+		case IMMEDIATE_OPERAND:
+			appendNumber(file, operand->as.immediate, false);
+			break;
+		case FRAME_OPERAND:
+			appendChar(file, '[');
+			appendString(file, registerName(operand->base, 8));
+			appendNumber(file, operand->as.offset, true);
+			appendChar(file, ']');
+			break;
+		case GLOBAL_OPERAND:
+			appendChar(file, '[');
+			appendString(file, operand->as.symbol);
+			appendChar(file, ']');
+			break;
+		case SYMBOL_OPERAND:
+			appendString(file, operand->as.symbol);
+			break;
+		case LABEL_OPERAND:
+			appendLabel(file, function, operand);
+			break;
+		case NO_OPERAND:
+			break;
+	}
+}
+
+static void printInstruction(FILE* file, MachineFunction* function, MachineInstr* instr) {
+
+	if (instr->opcode == LABEL_INSTR) {
+		if (instr->src.kind == IMMEDIATE_OPERAND) {
+			appendString(file, "\talign ");
+			appendNumber(file, instr->src.as.immediate, false);
+			appendChar(file, '\n');
+		}
+		appendLabel(file, function, &instr->dst);
+		appendString(file, ":\n");
+		return;
+	}
+
+	appendChar(file, '\t');
+	appendString(file, opcodeName(instr->opcode));
+
+	if (instr->opcode == SETCC_INSTR || instr->opcode == JCC_INSTR) {
+		appendString(file, conditionName(instr->condition));
+	}
+
+	if (instr->dst.kind != NO_OPERAND) {
+		appendChar(file, ' ');
+		if (needsSizeKeyword(instr, &instr->dst, &instr->src)) {
+			appendString(file, sizeKeyword(instr->dst.size));
+		}
+		appendOperand(file, function, &instr->dst);
+	}
+
+	if (instr->src.kind != NO_OPERAND) {
+		appendString(file, ", ");
+		if (needsSizeKeyword(instr, &instr->src, &instr->dst)) {
+			appendString(file, sizeKeyword(instr->src.size));
+		}
+		appendOperand(file, function, &instr->src);
+	}
+
+	appendChar(file, '\n');
+}
+
+int printAssembly(MachineModule* module, FILE* file) {
+
+	if (module == NULL || file == NULL) {
+		return 0;
+	}
+
+	appendString(file, "extern printf\n\n\tsection .data\n\tmessage db \"Result was: %d\", 10, 0\n\n");
+
+	for (int i = 0; i < module->globals->size; i++) {
+		MachineGlobal* global = (MachineGlobal*)module->globals->array[i];
+
+		appendString(file, "\tglobal ");
+		appendString(file, global->id);
+		appendString(file, "\n\talign ");
+		appendNumber(file, global->size, false);
+		appendChar(file, '\n');
+		appendString(file, global->id);
+		appendString(file, global->size == 1 ? ":\n\tdb " : ":\n\tdd ");
+		appendNumber(file, global->value, false);
+		appendString(file, "\n\n");
+	}
+
+	for (int i = 0; i < module->functions->size; i++) {
+		MachineFunction* function = (MachineFunction*)module->functions->array[i];
+
+		appendString(file, "; Start of Function \"");
+		appendString(file, function->id);
+		appendString(file, "\"\n\tsection .text\n\tglobal ");
+		appendString(file, function->id);
+		appendChar(file, '\n');
+		appendString(file, function->id);
+		appendString(file, ":\n");
+
+		for (int j = 0; j < function->size; j++) {
+			printInstruction(file, function, &function->code[j]);
+		}
+
+		appendString(file, "; End of Function \"");
+		appendString(file, function->id);
+		appendString(file, "\"\n\n");
+	}
+
+	if (ferror(file)) {
+		fprintf(stderr, "Error while writing the assembly\n");
+		return 0;
+	}
+
+	return 1;
+}
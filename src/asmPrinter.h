@@ -0,0 +1,11 @@
+#ifndef ASMPRINTER_H
+#define ASMPRINTER_H
+
+#include "machineIR.h"
+#include <stdio.h>
+
+// writes the module as NASM source
+int printAssembly(MachineModule* module, FILE* file);
+const char* registerName(Register reg, int size);
+
+#endif
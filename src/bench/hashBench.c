@@ -0,0 +1,204 @@
+// compares the open addressing HashTable from utils.c against the previous chained
+// implementation. build and run with "make hashbench"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../utils.h"
+
+// the chained table as it was before the switch to open addressing
+typedef struct ChainedBucket ChainedBucket;
+
+struct ChainedBucket {
+	char* id;
+	void* value;
+	ChainedBucket* next;
+};
+
+typedef struct ChainedTable {
+	int size;
+	ChainedBucket* array[];
+} ChainedTable;
+
+ChainedTable* chainedTable(int size) {
+	ChainedTable* table = calloc(1, sizeof(ChainedTable) + size * sizeof(ChainedBucket*));
+	table->size = size;
+	return table;
+}
+
+int chainedInsert(ChainedTable* table, char* key, void* value) {
+	unsigned long hashedKey = hash((unsigned char*)key) % table->size;
+
+	for (ChainedBucket* current = table->array[hashedKey]; current != NULL; current = current->next) {
+		if (strcmp(current->id, key) == 0) {
+			return 0;
+		}
+	}
+
+	ChainedBucket* bucket = calloc(1, sizeof(ChainedBucket));
+	bucket->id = strdup(key);
+	bucket->value = value;
+	bucket->next = table->array[hashedKey];
+	table->array[hashedKey] = bucket;
+	return 1;
+}
+
+void* chainedGet(ChainedTable* table, char* key) {
+	unsigned long hashedKey = hash((unsigned char*)key) % table->size;
+
+	for (ChainedBucket* current = table->array[hashedKey]; current != NULL; current = current->next) {
+		if (strcmp(current->id, key) == 0) {
+			return current->value;
+		}
+	}
+
+	return NULL;
+}
+
+void chainedRemove(ChainedTable* table, char* key) {
+	unsigned long hashedKey = hash((unsigned char*)key) % table->size;
+	ChainedBucket** link = &table->array[hashedKey];
+
+	while (*link != NULL) {
+		ChainedBucket* current = *link;
+		if (strcmp(current->id, key) == 0) {
+			*link = current->next;
+			free(current->id);
+			free(current);
+			return;
+		}
+		link = &current->next;
+	}
+}
+
+void freeChained(ChainedTable* table) {
+	for (int i = 0; i < table->size; i++) {
+		ChainedBucket* current = table->array[i];
+		while (current != NULL) {
+			ChainedBucket* next = current->next;
+			free(current->id);
+			free(current);
+			current = next;
+		}
+	}
+	free(table);
+}
+
+static double now(void) {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// identifiers shaped like the ones in generated programs
+static char** makeKeys(Interner* names, int count, const char* prefix) {
+	char** keys = malloc(count * sizeof(char*));
+	char buffer[32];
+
+	for (int i = 0; i < count; i++) {
+		int length = snprintf(buffer, sizeof(buffer), "%s%d", prefix, i * 7919 % (count * 4 + 1));
+		keys[i] = intern(names, buffer, length);
+	}
+
+	return keys;
+}
+
+// runs insert, hit, miss and remove over tables of the given size, repeating until
+// the same number of operations was done for every size
+static int runCase(Interner* names, int keyCount, long totalOperations) {
+	char** keys = makeKeys(names, keyCount, "var");
+	char** missing = makeKeys(names, keyCount, "tmp");
+	long rounds = totalOperations / keyCount;
+	if (rounds < 1) {
+		rounds = 1;
+	}
+
+	long checksum[3] = {0};
+	double seconds[3] = {0};
+	const char* labels[3] = {"chained", "open", "interned"};
+
+	for (int kind = 0; kind < 3; kind++) {
+		double start = now();
+
+		for (long round = 0; round < rounds; round++) {
+			ChainedTable* chained = NULL;
+			HashTable* table = NULL;
+
+			if (kind == 0) {
+				chained = chainedTable(256);
+			}
+			else {
+				table = kind == 1 ? hashTable(8, NULL) : symbolTable(8, NULL);
+			}
+
+			for (int i = 0; i < keyCount; i++) {
+				checksum[kind] += kind == 0 ? chainedInsert(chained, keys[i], keys[i]) : insertKeyPair(table, keys[i], keys[i]);
+			}
+
+			for (int i = 0; i < keyCount; i++) {
+				checksum[kind] += (kind == 0 ? chainedGet(chained, keys[i]) : getValue(table, keys[i])) == keys[i];
+				checksum[kind] += (kind == 0 ? chainedGet(chained, missing[i]) : getValue(table, missing[i])) != NULL;
+			}
+
+			for (int i = 0; i < keyCount; i += 2) {
+				if (kind == 0) {
+					chainedRemove(chained, keys[i]);
+				}
+				else {
+					removeKey(table, keys[i]);
+				}
+			}
+
+			for (int i = 0; i < keyCount; i++) {
+				checksum[kind] += (kind == 0 ? chainedGet(chained, keys[i]) : getValue(table, keys[i])) != NULL;
+			}
+
+			if (kind == 0) {
+				freeChained(chained);
+			}
+			else {
+				freeTable(table);
+			}
+		}
+
+		seconds[kind] = now() - start;
+	}
+
+	long operations = rounds * keyCount * 4 + rounds * ((keyCount + 1) / 2);
+	printf("%7d keys:", keyCount);
+	for (int kind = 0; kind < 3; kind++) {
+		printf("  %-8s %6.1f ns/op", labels[kind], seconds[kind] * 1e9 / operations);
+	}
+	printf("\n");
+
+	free(keys);
+	free(missing);
+
+	if (checksum[0] != checksum[1] || checksum[0] != checksum[2]) {
+		fprintf(stderr, "Error: tables disagree for %d keys: %ld %ld %ld\n", keyCount, checksum[0], checksum[1], checksum[2]);
+		return 0;
+	}
+
+	return 1;
+}
+
+int main(void) {
+
+	Arena* storage = arena(ARENA_CHUNK_SIZE);
+	Interner* names = interner(storage);
+
+	if (storage == NULL || names == NULL) {
+		return 1;
+	}
+
+	int sizes[] = {4, 16, 64, 256, 1024, 8192, 32768};
+	int success = 1;
+
+	for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+		success &= runCase(names, sizes[i], 1000000);
+	}
+
+	freeInterner(names);
+	freeArena(storage);
+	return success ? 0 : 1;
+}
@@ -0,0 +1,195 @@
+// compares the keyword classification of the lexer against the cascade of character checks it
+// replaced, on a source that is mostly keywords, then times the whole lexer with every scan mode
+// the cpu supports. build and run with "make lexbench"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../lexer.h"
+
+#define REPEATS 20000
+#define SECONDS 1.0
+
+// keeps the classification results alive so the loops are not optimized away
+static volatile long sink;
+
+// a function that uses every keyword, repeated to fill the source
+static const char snippet[] =
+	"i32 f(i32 a, i64 b, i16 c, bool d, char e, str s, f32 g, f64 h) {\n"
+	"	if d {\n"
+	"		return a\n"
+	"	} else {\n"
+	"		while false {\n"
+	"			d = true\n"
+	"		}\n"
+	"	}\n"
+	"	if d == false {\n"
+	"		return i32\n"
+	"	}\n"
+	"	return b\n"
+	"}\n";
+
+// the keyword checks as getToken did them before words were classified by length
+static TokenType cascadeWord(const char* w, int* length) {
+	if (w[0] == 'i' && w[1] == 'f' && !isalnum(w[2])) { *length = 2; return IF; }
+	if (w[0] == 'e' && w[1] == 'l' && w[2] == 's' && w[3] == 'e' && !isalnum(w[4])) { *length = 4; return ELSE; }
+	if (w[0] == 'w' && w[1] == 'h' && w[2] == 'i' && w[3] == 'l' && w[4] == 'e' && !isalnum(w[5])) { *length = 5; return WHILE; }
+	if (w[0] == 'b' && w[1] == 'o' && w[2] == 'o' && w[3] == 'l' && !isalnum(w[4])) { *length = 4; return BOOL; }
+	if (w[0] == 'i' && w[1] == '1' && w[2] == '6') { *length = 3; return I16; }
+	if (w[0] == 'i' && w[1] == '3' && w[2] == '2') { *length = 3; return I32; }
+	if (w[0] == 'i' && w[1] == '6' && w[2] == '4') { *length = 3; return I64; }
+	if (w[0] == 'f' && w[1] == '3' && w[2] == '2') { *length = 3; return F32; }
+	if (w[0] == 'f' && w[1] == '6' && w[2] == '4') { *length = 3; return F64; }
+	if (w[0] == 'c' && w[1] == 'h' && w[2] == 'a' && w[3] == 'r' && !isalnum(w[4])) { *length = 4; return CHAR; }
+	if (w[0] == 's' && w[1] == 't' && w[2] == 'r' && !isalnum(w[3])) { *length = 3; return STR; }
+	if (w[0] == 'r' && w[1] == 'e' && w[2] == 't' && w[3] == 'u' && w[4] == 'r' && w[5] == 'n' && !isalnum(w[6])) { *length = 6; return RETURN; }
+	if (w[0] == 't' && w[1] == 'r' && w[2] == 'u' && w[3] == 'e' && !isalnum(w[4])) { *length = 4; return TRUE; }
+	if (w[0] == 'f' && w[1] == 'a' && w[2] == 'l' && w[3] == 's' && w[4] == 'e' && !isalnum(w[5])) { *length = 5; return FALSE; }
+
+	int n = 1;
+	while (isalnum(w[n])) {
+		n++;
+	}
+
+	*length = n;
+	return ID;
+}
+
+// the word is scanned once and then classified by length
+static TokenType switchWord(const char* w, int* length) {
+	int n = 1;
+	while (isalnum(w[n])) {
+		n++;
+	}
+
+	*length = n;
+	return classifyWord(w, n);
+}
+
+static double seconds(struct timespec* start) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// classifies every word repeatedly for about a second and reports the words per second
+__attribute__((noinline, noclone)) static void benchmarkWords(const char* name, TokenType (*classify)(const char*, int*), const char** words, int count) {
+
+	long classified = 0;
+	long checksum = 0;
+	double elapsed = 0;
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (elapsed < SECONDS) {
+		for (int i = 0; i < count; i++) {
+			int length;
+			checksum += classify(words[i], &length) + length;
+		}
+
+		classified += count;
+		elapsed = seconds(&start);
+	}
+
+	sink = checksum;
+	printf("%-8s %.1f million words/s\n", name, classified / elapsed / 1e6);
+}
+
+// lexes the whole buffer repeatedly for about a second and reports the throughput
+static int benchmarkLexer(char* buffer, ScanMode mode) {
+
+	Lexer* lexer = initializeLexer(buffer);
+
+	if (lexer == NULL) {
+		return 0;
+	}
+
+	setLexerScanMode(lexer, mode);
+
+	long tokens = 0;
+	int passes = 0;
+	double elapsed = 0;
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (elapsed < SECONDS) {
+		if (!setLexerBuffer(lexer, buffer)) {
+			freeLexer(lexer);
+			return 0;
+		}
+
+		while (peekToken(lexer) != NULL && peekToken(lexer)->type != E_O_F) {
+			advanceToken(lexer);
+			tokens++;
+		}
+
+		if (peekToken(lexer) == NULL) {
+			fprintf(stderr, "Error: Lexing failed\n");
+			freeLexer(lexer);
+			return 0;
+		}
+
+		passes++;
+		elapsed = seconds(&start);
+	}
+
+	printf("%-8s %.1f million tokens/s\n", scanModeName(mode), tokens / elapsed / 1e6);
+	freeLexer(lexer);
+	return 1;
+}
+
+int main() {
+
+	int snippetLength = (int)strlen(snippet);
+	char* source = malloc((size_t)snippetLength * REPEATS + 1);
+	const char** words = malloc(sizeof(const char*) * (size_t)snippetLength * REPEATS);
+
+	if (source == NULL || words == NULL) {
+		return 1;
+	}
+
+	for (int i = 0; i < REPEATS; i++) {
+		memcpy(source + (size_t)i * snippetLength, snippet, snippetLength);
+	}
+
+	source[(size_t)snippetLength * REPEATS] = '\0';
+
+	// the start of every word, both classifiers have to agree on all of them
+	int count = 0;
+	int keywords = 0;
+
+	for (char* c = source; *c != '\0'; c++) {
+		if (isalpha(*c) && (c == source || !isalnum(c[-1]))) {
+			int cascadeLength;
+			int switchLength;
+			TokenType type = cascadeWord(c, &cascadeLength);
+
+			if (switchWord(c, &switchLength) != type || switchLength != cascadeLength) {
+				fprintf(stderr, "Error: The classifiers disagree on word %d\n", count);
+				return 1;
+			}
+
+			keywords += type != ID;
+			words[count++] = c;
+		}
+	}
+
+	printf("%d words, %d of them keywords\n", count, keywords);
+	benchmarkWords("cascade", cascadeWord, words, count);
+	benchmarkWords("switch", switchWord, words, count);
+
+	for (ScanMode mode = SCALAR_SCAN; mode <= detectScanMode(); mode++) {
+		if (mode != SCALAR_SCAN && !compareScanModes(source, mode)) {
+			return 1;
+		}
+
+		if (!benchmarkLexer(source, mode)) {
+			return 1;
+		}
+	}
+
+	free(words);
+	free(source);
+	return 0;
+}
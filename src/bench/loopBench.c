@@ -0,0 +1,142 @@
+// measures the cycles per iteration of a loop compiled with every local in a stack slot,
+// like the code generator did before register allocation, against the allocated version.
+// build and run with "make loopbench"
+#include <stdio.h>
+#include <stdlib.h>
+#include <x86intrin.h>
+#include "../parser.h"
+#include "../resolver.h"
+#include "../typeChecker.h"
+#include "../irBuilder.h"
+#include "../passManager.h"
+#include "../codegen.h"
+#include "../encoder.h"
+#include "../jit.h"
+
+#define ITERATIONS 10000000
+#define RUNS 5
+
+// the counter, the accumulator and the bound are carried from one iteration to the next
+static char source[] =
+	"i32 loop(i32 n) {\n"
+	"	acc = 0\n"
+	"	i = 0\n"
+	"	while i < n {\n"
+	"		acc = acc + i * 3\n"
+	"		if acc > 100000 {\n"
+	"			acc = acc - 100000\n"
+	"		}\n"
+	"		i = i + 1\n"
+	"	}\n"
+	"	return acc\n"
+	"}\n"
+	"i32 main() {\n"
+	"	return loop(10)\n"
+	"}\n";
+
+// runs the whole pipeline on the source, the returned code is freed by the caller
+MachineCode* compile(bool stackOnly) {
+
+	Parser* parser = initializeParser(source);
+	DynamicArray* ast = parser != NULL ? parseBuffer(parser) : NULL;
+
+	if (ast == NULL) {
+		freeParser(parser);
+		return NULL;
+	}
+
+	Resolver* resolver = initializeResolver(ast, parser->arena);
+
+	if (resolver == NULL || !resolveNames(resolver)) {
+		freeResolver(resolver);
+		freeArray(ast);
+		freeParser(parser);
+		return NULL;
+	}
+
+	int globalCount = resolver->globalCount;
+	freeResolver(resolver);
+
+	TypeChecker* typeChecker = initializeChecker(ast, globalCount);
+	IRModule* ir = typeChecker != NULL && checkTypes(typeChecker) ? lowerProgram(ast) : NULL;
+	PassManager* manager = passManager(1);
+	Codegen* codegen = NULL;
+	MachineCode* code = NULL;
+
+	if (ir != NULL && manager != NULL && runPasses(manager, ir)) {
+		codegen = initializeCodegen(ir);
+	}
+
+	if (codegen != NULL) {
+		codegen->stackOnly = stackOnly;
+		code = generate(codegen) ? encodeModule(codegen->module) : NULL;
+	}
+
+	freeCodegen(codegen);
+	freePassManager(manager);
+	freeIRModule(ir);
+	freeChecker(typeChecker);
+	freeArray(ast);
+	freeParser(parser);
+	return code;
+}
+
+// best of a few runs, the others are disturbed by interrupts and frequency changes
+double measure(int (*loop)(int)) {
+
+	double best = 0;
+
+	for (int run = 0; run < RUNS; run++) {
+		unsigned long long start = __rdtsc();
+		volatile int result = loop(ITERATIONS);
+		unsigned long long end = __rdtsc();
+		(void)result;
+
+		double cycles = (double)(end - start) / ITERATIONS;
+
+		if (run == 0 || cycles < best) {
+			best = cycles;
+		}
+	}
+
+	return best;
+}
+
+int main() {
+
+	const char* names[] = {"stack slots", "registers"};
+	double cycles[2];
+	int results[2];
+
+	for (int i = 0; i < 2; i++) {
+		MachineCode* code = compile(i == 0);
+		LoadedProgram* program = code != NULL ? loadMachineCode(code) : NULL;
+		int (*loop)(int) = program != NULL ? (int (*)(int))findFunction(program, "loop") : NULL;
+
+		if (loop == NULL) {
+			fprintf(stderr, "Error: Failed compiling the benchmark loop\n");
+			unloadProgram(program);
+			freeMachineCode(code);
+			return 1;
+		}
+
+		results[i] = loop(ITERATIONS);
+		cycles[i] = measure(loop);
+		unloadProgram(program);
+		freeMachineCode(code);
+	}
+
+	if (results[0] != results[1]) {
+		fprintf(stderr, "Error: The results differ, %d and %d\n", results[0], results[1]);
+		return 1;
+	}
+
+	printf("%d iterations, best of %d runs\n", ITERATIONS, RUNS);
+
+	for (int i = 0; i < 2; i++) {
+		printf("%-12s %6.2f cycles per iteration\n", names[i], cycles[i]);
+	}
+
+	printf("speedup      %6.2fx\n", cycles[0] / cycles[1]);
+	return 0;
+}
@@ -0,0 +1,121 @@
+// checks every vectorized scanner the cpu supports against the scalar one. the sources start at every
+// offset of a 64 byte block, end right before an unmapped page or start right after one, and have
+// words, numbers and whitespace of every length up to 70 bytes, so tokens cross 16 and 32 byte blocks.
+// build and run with "make lexcheck"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "../lexer.h"
+
+#define MAX_LENGTH 70
+#define OFFSETS 64
+
+static int appendRun(char* text, int size, const char* alphabet, int length) {
+	int count = (int)strlen(alphabet);
+
+	for (int i = 0; i < length; i++) {
+		text[size++] = alphabet[i % count];
+	}
+
+	return size;
+}
+
+// a source with the runs of the given length, the variant decides what comes right before the NUL
+static int buildSource(char* text, int length, int variant) {
+
+	int size = 0;
+	size = appendRun(text, size, " \t\n\r", length);
+	size = appendRun(text, size, "wordLIKE09identifier", length);
+	text[size++] = ' ';
+	size = appendRun(text, size, "1234567890", length);
+	size = appendRun(text, size, "\n", 1);
+	size = appendRun(text, size, "value", length % 7 + 1);
+	size = appendRun(text, size, " = (", 4);
+	size = appendRun(text, size, "42", length % 3 + 1);
+	size = appendRun(text, size, ") + ", 4);
+
+	switch (variant) {
+		// a word runs into the end
+		case 0:
+			size = appendRun(text, size, "tail", length);
+			break;
+		// so does a number
+		case 1:
+			size = appendRun(text, size, "9876543210", length);
+			break;
+		// and whitespace
+		default:
+			size = appendRun(text, size, " \t", length);
+			break;
+	}
+
+	text[size] = '\0';
+	return size;
+}
+
+static int check(char* buffer, ScanMode mode, const char* placement, int length, int variant) {
+	if (compareScanModes(buffer, mode)) {
+		return 1;
+	}
+
+	fprintf(stderr, "Error: %s, runs of %d bytes, variant %d\n", placement, length, variant);
+	return 0;
+}
+
+int main() {
+
+	long pageSize = sysconf(_SC_PAGESIZE);
+	// a writable page between two unmapped ones
+	char* pages = mmap(NULL, 3 * pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (pages == MAP_FAILED || mprotect(pages, pageSize, PROT_NONE) != 0 || mprotect(pages + 2 * pageSize, pageSize, PROT_NONE) != 0) {
+		fprintf(stderr, "Error: Cannot map the guard pages\n");
+		return 1;
+	}
+
+	char* page = pages + pageSize;
+	char text[8 * MAX_LENGTH];
+	int failed = 0;
+
+	for (ScanMode mode = SSE2_SCAN; mode <= detectScanMode(); mode++) {
+		int checks = 0;
+		int before = failed;
+
+		for (int length = 1; length <= MAX_LENGTH; length++) {
+			for (int variant = 0; variant < 3; variant++) {
+				int size = buildSource(text, length, variant);
+
+				// allocated to the byte, the sanitizer sees any read past the end that is not part of an aligned block
+				for (int offset = 0; offset < OFFSETS; offset++) {
+					char* memory = malloc(offset + size + 1);
+
+					if (memory == NULL) {
+						return 1;
+					}
+
+					memcpy(memory + offset, text, size + 1);
+					failed += !check(memory + offset, mode, "unaligned start", length, variant);
+					free(memory);
+					checks++;
+				}
+
+				memcpy(page + pageSize - size - 1, text, size + 1);
+				failed += !check(page + pageSize - size - 1, mode, "end of a page", length, variant);
+				memcpy(page, text, size + 1);
+				failed += !check(page, mode, "start of a page", length, variant);
+				checks += 2;
+			}
+		}
+
+		printf("%-6s matched the scalar lexer in %d of %d sources\n", scanModeName(mode), checks - (failed - before), checks);
+	}
+
+	if (detectScanMode() == SCALAR_SCAN) {
+		printf("No vectorized lexer on this cpu\n");
+	}
+
+	munmap(pages, 3 * pageSize);
+	return failed > 0;
+}
@@ -1,37 +1,48 @@
 #include "codegen.h"
-#include "parser.h"
+#include "ir.h"
+#include "machineIR.h"
+#include "regAlloc.h"
+#include "asmPrinter.h"
 #include "utils.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 
+#define LOOP_ALIGNMENT 16
+// bytes below rsp that signal handlers leave alone, so leaf functions may use them without moving rsp
+#define RED_ZONE_SIZE 128
+
 int generate(Codegen* codegen);
-int generateGlobalStatement(Codegen* codegen, Statement* statement);
-int generateGlobalAssignment(Codegen* codegen, Assignment* assignment);
-Value* calculateGlobalExpression(Expression* expression);
-Value* addValues(BinOperationType binOpType, Value* left, Value* right);
-int generateStatement(Codegen* codegen, Statement* statement);
-int generateFunctionStatement(Codegen* codegen, FunctionStmt* function);
-int annotateCall(Codegen* codegen, Expression* expression);
-int generateExpression(Codegen* codegen, Expression* expression);
-int generateFunctionCall(Codegen* codegen, FunctionCall* function, int hasCall);
-int generateBinOperation(Codegen* codegen, BinOperation* binOperation);
-int generateUnaryOperation(Codegen* codegen, UnaryOperation* unaryOperationt);
-int generateBlockStmt(Codegen* codegen, BlockStmt* blockStmt, HashTable* scope, DynamicArray* params, int paramC);
-int generateWhileStmt(Codegen* codegen, WhileStmt* whileStmt);
-int generateIfStmt(Codegen* codegen, IfStmt* ifStmt);
-int generateReturnStmt(Codegen* codegen, ReturnStmt* returnStmt);
-int generateAssignment(Codegen* codegen, Assignment* assignment);
-int getVariableOffset(Codegen* codegen, char* id);
-HashTable* getScopeForVar(Codegen* codegen, char* id);
+int emit(Codegen* codegen, Opcode opcode, Operand dst, Operand src);
+int emitCondition(Codegen* codegen, Opcode opcode, Condition condition, Operand operand);
+int emitLabel(Codegen* codegen, LabelKind kind, int number);
+int generateFunction(Codegen* codegen, IRFunction* function);
+int generateBlock(Codegen* codegen, IRBlock* block, IRBlock* next);
+int generateInstruction(Codegen* codegen, IRInstr* instr, IRBlock* next);
+int generateArithmetic(Codegen* codegen, IRInstr* instr);
+int generateDivision(Codegen* codegen, IRInstr* instr);
+int generateComparison(Codegen* codegen, IRInstr* instr);
+Condition emitComparison(Codegen* codegen, IRInstr* instr);
+bool isFusedCondition(Codegen* codegen, IRInstr* value);
+bool isHoistedEdge(Codegen* codegen, IRBlock* block, IRBlock* edge);
+int generateCall(Codegen* codegen, IRInstr* instr);
+bool isSiblingCall(Codegen* codegen, IRInstr* call);
+int generateTailCall(Codegen* codegen, IRInstr* call);
+int generatePhiCopies(Codegen* codegen, IRBlock* block, IRBlock* target);
+int generateBranch(Codegen* codegen, IRInstr* branch, IRBlock* next);
+int generateReturn(Codegen* codegen, IRInstr* ret, IRBlock* next);
+int generateFrame(Codegen* codegen, IRFunction* function);
+Operand valueRegister(Codegen* codegen, IRInstr* value);
+Operand valueOperand(Codegen* codegen, IRInstr* value);
+Operand materializeValue(Codegen* codegen, IRInstr* value);
 int getTypeSize(ValueType type);
-const char* getFunctionArgRegister(int reg, int typeSize);
-const char* getCalleeSavedRegister(int reg, int typeSize);
+Operand getFunctionArgRegister(int reg, int typeSize);
+Operand getCalleeSavedRegister(int reg, int typeSize);
+
+Codegen* initializeCodegen(IRModule* ir) {
 
-Codegen* initializeCodegen(DynamicArray* ast) {
-	
-	if (ast == NULL) {
+	if (ir == NULL) {
 		return NULL;
 	}
 
@@ -41,1451 +52,790 @@ Codegen* initializeCodegen(DynamicArray* ast) {
 		return NULL;
 	}
 
-	codegen->idx = 0;
-	codegen->maxSize = 1024;
-	codegen->buffer = malloc(1024);
-
-	if (codegen->buffer == NULL) {
-		freeCodegen(codegen);
-		return NULL;
-	}
-
-	codegen->scopes = dynamicArray(2, freeTable);
-
-	if (codegen->scopes == NULL) {
-		freeCodegen(codegen);
-		return NULL;
-	}
-
-	HashTable* globalScope = hashTable(256, NULL);
+	codegen->module = machineModule();
+	codegen->peephole = true;
+	codegen->peepholeStats = peepholeStats();
 
-	if (globalScope == NULL) {
+	if (codegen->module == NULL || codegen->peepholeStats == NULL) {
 		freeCodegen(codegen);
 		return NULL;
 	}
 
-	if (!pushItem(codegen->scopes, globalScope)) {
-		freeCodegen(codegen);
-		return NULL;
-	}
-
-	codegen->labelCounters = dynamicArray(2, free);
-
-	if (codegen->labelCounters == NULL) {
-		freeCodegen(codegen);
-		return NULL;
-	}
-
-	int* globalCounter = malloc(sizeof(int));
-
-	if (globalCounter == NULL) {
-		freeCodegen(codegen);
-		return NULL;
-	}
-
-	*globalCounter = 0;
-
-	if (!pushItem(codegen->labelCounters, globalCounter)) {
-		freeCodegen(codegen);
-		return NULL;
-	}
-
-	codegen->ast = ast;
+	codegen->ir = ir;
 	return codegen;
 }
 
 void writeToFile(Codegen* codegen, const char* filepath) {
-	FILE* file = fopen(filepath, "wb"); 
+	FILE* file = fopen(filepath, "wb");
 
 	if (file == NULL) {
 		fprintf(stderr, "Error: Cannot open file\n");
 		return;
 	}
 
-	int written = fwrite(codegen->buffer, 1, codegen->idx, file);
-	if (written != codegen->idx) {
-		fprintf(stderr, "Error while writing to file\n");
-		return;
-	}
-
+	printAssembly(codegen->module, file);
 	fclose(file);
 }
 
-int addToBuffer(Codegen* codegen, const char* token) {
-
-	if (codegen == NULL || token == NULL) {
-		return 0;
-	}
+// appends an instruction to the function that is currently generated
+int emit(Codegen* codegen, Opcode opcode, Operand dst, Operand src) {
+	return appendInstruction(codegen->function, opcode, NO_COND, dst, src);
+}
 
-	int token_len = strlen(token);
+int emitCondition(Codegen* codegen, Opcode opcode, Condition condition, Operand operand) {
+	return appendInstruction(codegen->function, opcode, condition, operand, noOperand());
+}
 
-	if (codegen->idx + token_len + 1 > codegen->maxSize) {
+int emitLabel(Codegen* codegen, LabelKind kind, int number) {
+	return appendInstruction(codegen->function, LABEL_INSTR, NO_COND, labelOperand(kind, number), noOperand());
+}
 
-		int new_size = codegen->maxSize * 2;
+// selects machine instructions for the ir, every ir value gets a virtual register
+int generate(Codegen* codegen) {
 
-		while (new_size < codegen->idx + token_len) {
-			new_size *= 2;
-		}
+	if (codegen == NULL) {
+		return 0;
+	}
 
-		char* new_buffer = realloc(codegen->buffer, new_size);
+	for (int i = 0; i < codegen->ir->globals->size; i++) {
+		IRGlobal* global = codegen->ir->globals->array[i];
+		int size = getTypeSize(global->type);
 
-		if (new_buffer == NULL) {
+		if (size == 0 || machineGlobal(codegen->module, global->id, size, global->value) == NULL) {
 			return 0;
 		}
-
-		codegen->buffer = new_buffer;
-		codegen->maxSize = new_size;
 	}
 
-	memcpy(codegen->buffer + codegen->idx, token, token_len);
-	codegen->idx += token_len;
-	codegen->buffer[codegen->idx] = '\0';
+	for (int i = 0; i < codegen->ir->functions->size; i++) {
+		if (!generateFunction(codegen, codegen->ir->functions->array[i])) {
+			return 0;
+		}
+	}
 
 	return 1;
 }
 
-int generate(Codegen* codegen) {
-
-	if (codegen == NULL) {
+int generateFunction(Codegen* codegen, IRFunction* function) {
+	if (codegen == NULL || function == NULL) {
 		return 0;
 	}
 
-	if (!addToBuffer(codegen, "extern printf\n\n\tsection .data\n\tmessage db \"Result was: %d\", 10, 0\n\n")) return 0;
-
-	for (int i = 0; i < codegen->ast->size; i++) {
-
-		if (!generateStatement(codegen, (Statement*)codegen->ast->array[i])) {
-
-			freeArray(codegen->scopes);
-			free(codegen->buffer);
+	// for now only 6 params allowed, the ones that are passed in registers
+	if (function->paramCount > 6) {
+		fprintf(stderr, "Error: Only 6 Function Prameters allowed for now\n");
+		return 0;
+	}
 
-			codegen->scopes = dynamicArray(2, freeTable);
+	// phi copies go to the end of the predecessors, which must not branch anywhere else
+	if (!splitPhiEdges(function)) {
+		return 0;
+	}
 
-			if (codegen->scopes == NULL) {
-				freeCodegen(codegen);
-				return 0;
-			}
-			
-			codegen->buffer = malloc(1024);
+	codegen->irFunction = function;
+	codegen->function = machineFunction(codegen->module, function->id);
+	free(codegen->valueRegisters);
+	free(codegen->useCounts);
+	codegen->valueRegisters = malloc(function->valueCount * sizeof(Operand));
+	codegen->useCounts = calloc(function->valueCount, sizeof(int));
 
-			if (codegen->buffer == NULL) {
-				freeCodegen(codegen);
-				return 0;
-			}
+	if (codegen->function == NULL || codegen->valueRegisters == NULL || codegen->useCounts == NULL) {
+		return 0;
+	}
 
-			HashTable* typeTable = hashTable(256, free);
+	for (int i = 0; i < function->valueCount; i++) {
+		codegen->valueRegisters[i] = noOperand();
+	}
 
-			if (typeTable == NULL) {
-				freeCodegen(codegen);
-				return 0;
-			}
+	DynamicArray* blocks = function->blocks;
 
-			if (!pushItem(codegen->scopes, typeTable))  {
-				freeCodegen(codegen);
-				return 0;
+	for (int i = 0; i < blocks->size; i++) {
+		for (IRInstr* instr = ((IRBlock*)blocks->array[i])->first; instr != NULL; instr = instr->next) {
+			for (int o = 0; o < instr->operandCount; o++) {
+				codegen->useCounts[instr->operands[o]->id]++;
 			}
-
-			return 0;
 		}
 	}
 
-	return 1;
-}
+	// the layout position, to tell loops apart by their backward edges
+	for (int i = 0; i < blocks->size; i++) {
+		((IRBlock*)blocks->array[i])->mark = i;
+	}
 
-void insertionSort(DynamicArray* arr) {
-    int i;
-    int j;
-    Variable* key;
-    for (i = 1; i < arr->size; i++) {
-        key = (Variable*)arr->array[i];
-        j = i - 1;
-        while (j >= 0 && getTypeSize(((Variable*)arr->array[j])->type) < getTypeSize(key->type)) {
-            arr->array[j + 1] = arr->array[j];
-            j = j - 1;
-        }
-        arr->array[j + 1] = key;
-    }
-}
+	bool* skipped = malloc(blocks->size * sizeof(bool));
 
-int generateGlobalStatement(Codegen* codegen, Statement* statement) {
-	if (codegen == NULL || statement == NULL) {
+	if (skipped == NULL) {
 		return 0;
 	}
 
-	if (statement->type == FUNCTION_STMT) {
-		return generateFunctionStatement(codegen, statement->as.function);
+	for (int i = 0; i < blocks->size; i++) {
+		IRBlock* block = blocks->array[i];
+		skipped[i] = block->predCount == 1 && isHoistedEdge(codegen, block->preds[0], block);
 	}
 
-	if (statement->type != EXPRESSION_STMT || statement->as.expression->type != ASSIGN_EXPR) {
-		fprintf(stderr, "Error: Encountered ILLEGAL statement in Global Data Section\n");
-		return 0;
-	}
+	for (int i = 0; i < blocks->size; i++) {
+		int following = i + 1;
 
-	switch (statement->as.expression->valueType) {
-		case BOOL_TYPE:
-		case LONG_TYPE: {
-			return generateGlobalAssignment(codegen, statement->as.expression->as.assignment);
+		while (following < blocks->size && skipped[following]) {
+			following++;
 		}
-		case DOUBLE_TYPE:
-			fprintf(stderr, "Error: Did not implement float Types yet :(\n");
-			return 0;
-		default:
-			fprintf(stderr, "Error: Unrecognized Type in generateGlobalStatement\n");
-			return 0;
-	}
-}
 
-int generateGlobalAssignment(Codegen* codegen, Assignment* assignment) {
-	if (codegen == NULL || assignment == NULL) {
-		return 0;
-	}
-
-	ValueType type = assignment->variable->type;
+		IRBlock* next = following < blocks->size ? blocks->array[following] : NULL;
 
-	if (type == UNKNOWN) {
-		fprintf(stderr, "Error: Declarations without Assingment not allowed in global Scope\n");
+		if (!skipped[i] && !generateBlock(codegen, blocks->array[i], next)) {
+			free(skipped);
+			return 0;
+		}
 	}
-	
-	Value* value = calculateGlobalExpression(assignment->expression);
 
-	if (value == NULL) {
-		fprintf(stderr, "Error: Failed to Calculate Value in generateGlobalAssignment\n");
+	free(skipped);
+
+	if (!allocateRegisters(codegen->function, codegen->stackOnly) || !generateFrame(codegen, function)) {
 		return 0;
 	}
 
-	char* variableId = assignment->variable->id;
-	if (!insertKeyPair((HashTable*)codegen->scopes->array[0], variableId, NULL)) {
-		fprintf(stderr, "Error: Tried to redifine global variable \"%s\"", variableId);
+	if (codegen->peephole && !optimizePeephole(codegen->function, codegen->peepholeStats)) {
 		return 0;
 	}
 
-	switch (type) {
-		char instr[256];
-		case BOOL_TYPE: {
-			bool val = value->as.b;
-			snprintf(instr, sizeof(instr), "\tsection .data\n\tglobal %s\n\talign 1\n\t\n%s:\n\tdb %d\n\n", variableId, variableId, val);
-			free(value);
-			return addToBuffer(codegen, instr);
-		}
-		case LONG_TYPE: {
-			long long val = value->as.i_64;
-			snprintf(instr, sizeof(instr), "\tsection .data\n\tglobal %s\n\talign 4\n\t\n%s:\n\tdd %lld\n\n", variableId, variableId, val);
-			free(value);
-			return addToBuffer(codegen, instr);
-		}
-		case DOUBLE_TYPE:
-			fprintf(stderr, "Error: Did not implement float Types yet :(\n");
-			free(value);
-			return 0;
-		default:
-			fprintf(stderr, "Error: Unrecognized Type in calculate Expression\n");
-			free(value);
-			return 0;
-	}
+	codegen->irFunction = NULL;
+	codegen->function = NULL;
+	return 1;
 }
 
-Value* calculateGlobalExpression(Expression* expression) {
-	if (expression == NULL) {
-		return NULL;
+// next is the block that follows in the layout, jumps to it fall through
+int generateBlock(Codegen* codegen, IRBlock* block, IRBlock* next) {
+	if (codegen == NULL || block == NULL) {
+		return 0;
 	}
 
-	switch (expression->type) {
-		case EXPR_WRAPPER_EXPR:
-			return calculateGlobalExpression(expression->as.expWrap);
-		case ASSIGN_EXPR:
-			fprintf(stderr, "Error: Unexpected Assignment in calculateGlobalExpression\n");
-			return NULL;
-		case UNARY_EXPR: {
-			if (expression->as.unop->type == MINUS) {
-				Value* value = calculateGlobalExpression(expression->as.unop->right);
-				if (value->type == LONG_TYPE) {
-					value->as.i_64 = -value->as.i_64;
-					return value;
-				}
-				free(value);
-				fprintf(stderr, "Error: Unexpected type for Unary Operand -\n");
-				return NULL;
-			}
-			if (expression->as.unop->type == NOT) {
-				Value* value = calculateGlobalExpression(expression->as.unop->right);
-				if (value->type == BOOL_TYPE) {
-					value->as.b = 1 ? value->as.b == 0 : 0;
-					return value;
-				}
-				fprintf(stderr, "Error: Unexpected type for Unary Operand !\n");
-				free(value);
-				return NULL;
-			}
+	if (block != codegen->irFunction->blocks->array[0]) {
+		bool loopHeader = false;
+
+		for (int i = 0; i < block->predCount; i++) {
+			loopHeader = loopHeader || block->preds[i]->mark >= block->mark;
 		}
-		case BINOP_EXPR: {
-			Value* left = calculateGlobalExpression(expression->as.binop->left);
-			Value* right = calculateGlobalExpression(expression->as.binop->right);
-			Value* newValue = addValues(expression->as.binop->type, left, right);
-			if (newValue == NULL) {
-				return NULL;
-			}
-			return newValue;
+
+		// loop starts are aligned, so the body is fetched in as few blocks as possible
+		Operand alignment = loopHeader ? immediateOperand(LOOP_ALIGNMENT, 0) : noOperand();
+
+		if (!appendInstruction(codegen->function, LABEL_INSTR, NO_COND, labelOperand(BLOCK_LABEL, block->id), alignment)) {
+			return 0;
 		}
-		case VARIABLE_EXPR:
-			fprintf(stderr, "Error: Unexpected Variable in Global Expression\n");
-			return NULL;
-		case VALUE_EXPR: {
-			Value* copiedValue = calloc(1, sizeof(Value));
-			memcpy(copiedValue, expression->as.value, sizeof(Value));
-			return copiedValue;
+	}
+
+	for (IRInstr* instr = block->first; instr != NULL; instr = instr->next) {
+		// the callee returns to our caller, the rest of the block would only pass its value on
+		if (instr->opcode == CALL_IR && isSiblingCall(codegen, instr)) {
+			return generateTailCall(codegen, instr);
 		}
-		default:
-			fprintf(stderr, "Error: Unexpected Expression type in generate Expression\n");
+
+		if (!generateInstruction(codegen, instr, next)) {
 			return 0;
+		}
 	}
+
+	return 1;
 }
 
-Value* addValues(BinOperationType binOpType, Value* left, Value* right) {
-	if (left == NULL || right == NULL) {
-		return NULL;
+int generateInstruction(Codegen* codegen, IRInstr* instr, IRBlock* next) {
+	if (codegen == NULL || instr == NULL) {
+		return 0;
 	}
 
-	Value* res = calloc(1, sizeof(Value));
-
-	if (res == NULL) return NULL;
-
-	switch (binOpType) {
-		case ADD_OP:
-			switch (left->type) {
-				case BOOL_TYPE:
-					fprintf(stderr, "Error: Operand + not allowed for type boolean in addValues\n");
-					return NULL;
-				case LONG_TYPE:
-					res->as.i_64 = left->as.i_64 + right->as.i_64;
-					res->type = LONG_TYPE;
-					break;
-				case DOUBLE_TYPE:
-					fprintf(stderr, "Error: Float type not implemented yet :(\n");
-					return NULL;
-				default:
-					fprintf(stderr, "Error: Unregognized type in addValues\n");
-					return NULL;
-			}
-			break;
-		case SUB_OP:
-			switch (left->type) {
-				case BOOL_TYPE:
-					fprintf(stderr, "Error: Operand - not allowed for type boolean in addValues\n");
-					return NULL;
-				case LONG_TYPE:
-					res->as.i_64 = left->as.i_64 + right->as.i_64;
-					res->type = LONG_TYPE;
-					break;
-				case DOUBLE_TYPE:
-					fprintf(stderr, "Error: Float type not implemented yet :(\n");
-					return NULL;
-				default:
-					fprintf(stderr, "Error: Unregognized type in addValues\n");
-					return NULL;
-			}
-			break;
-		case MUL_OP:
-			switch (left->type) {
-				case BOOL_TYPE:
-					fprintf(stderr, "Error: Operand * not allowed for type boolean in addValues\n");
-					return NULL;
-				case LONG_TYPE:
-					res->as.i_64 = left->as.i_64 * right->as.i_64;
-					res->type = LONG_TYPE;
-					break;
-				case DOUBLE_TYPE:
-					fprintf(stderr, "Error: Float type not implemented yet :(\n");
-					return NULL;
-				default:
-					fprintf(stderr, "Error: Unregognized type in addValues\n");
-					return NULL;
-			}
-			break;
-		case DIV_OP:
-			switch (left->type) {
-				case BOOL_TYPE:
-					fprintf(stderr, "Error: Operand / not allowed for type boolean in addValues\n");
-					return NULL;
-				case LONG_TYPE:
-					res->as.i_64 = left->as.i_64 / right->as.i_64;
-					res->type = LONG_TYPE;
-					break;
-				case DOUBLE_TYPE:
-					fprintf(stderr, "Error: Float type not implemented yet :(\n");
-					return NULL;
-				default:
-					fprintf(stderr, "Error: Unregognized type in addValues\n");
-					return NULL;
-			}
-			break;
-		case MOD_OP:
-			fprintf(stderr, "Error: Operator Modulus not implemented yet\n");
-			return NULL;
-		case ST_OP:
-			switch (left->type) {
-				case BOOL_TYPE:
-					fprintf(stderr, "Error: Operand < not allowed for type boolean in addValues\n");
-					return NULL;
-				case LONG_TYPE:
-					res->as.i_64 = left->as.i_64 < right->as.i_64;
-					res->type = BOOL_TYPE;
-					break;
-				case DOUBLE_TYPE:
-					fprintf(stderr, "Error: Float type not implemented yet :(\n");
-					return NULL;
-				default:
-					fprintf(stderr, "Error: Unregognized type in addValues\n");
-					return NULL;
-			}
-			break;
-		case STE_OP:
-			switch (left->type) {
-				case BOOL_TYPE:
-					fprintf(stderr, "Error: Operand <= not allowed for type boolean in addValues\n");
-					return NULL;
-				case LONG_TYPE:
-					res->as.i_64 = left->as.i_64 <= right->as.i_64;
-					res->type = BOOL_TYPE;
-					break;
-				case DOUBLE_TYPE:
-					fprintf(stderr, "Error: Float type not implemented yet :(\n");
-					return NULL;
-				default:
-					fprintf(stderr, "Error: Unregognized type in addValues\n");
-					return NULL;
-			}
-			break;
-		case GT_OP:
-			switch (left->type) {
-				case BOOL_TYPE:
-					fprintf(stderr, "Error: Operand > not allowed for type boolean in addValues\n");
-					return NULL;
-				case LONG_TYPE:
-					res->as.i_64 = left->as.i_64 > right->as.i_64;
-					res->type = BOOL_TYPE;
-					break;
-				case DOUBLE_TYPE:
-					fprintf(stderr, "Error: Float type not implemented yet :(\n");
-					return NULL;
-				default:
-					fprintf(stderr, "Error: Unregognized type in addValues\n");
-					return NULL;
-			}
-			break;
-		case GTE_OP:
-			switch (left->type) {
-				case BOOL_TYPE:
-					fprintf(stderr, "Error: Operand >= not allowed for type boolean in addValues\n");
-					return NULL;
-				case LONG_TYPE:
-					res->as.i_64 = left->as.i_64 >= right->as.i_64;
-					res->type = BOOL_TYPE;
-					break;
-				case DOUBLE_TYPE:
-					fprintf(stderr, "Error: Float type not implemented yet :(\n");
-					return NULL;
-				default:
-					fprintf(stderr, "Error: Unregognized type in addValues\n");
-					return NULL;
-			}
-			break;
-		case EQ_OP:
-			switch (left->type) {
-				case BOOL_TYPE:
-					fprintf(stderr, "Error: Operand == not allowed for type boolean in addValues\n");
-					return NULL;
-				case LONG_TYPE:
-					res->as.i_64 = left->as.i_64 == right->as.i_64;
-					res->type = BOOL_TYPE;
-					break;
-				case DOUBLE_TYPE:
-					fprintf(stderr, "Error: Float type not implemented yet :(\n");
-					return NULL;
-				default:
-					fprintf(stderr, "Error: Unregognized type in addValues\n");
-					return NULL;
+	switch (instr->opcode) {
+		// constants become immediates where they are used
+		case CONST_IR:
+		// phis are written by the copies at the end of the predecessors
+		case PHI_IR:
+			return 1;
+		case PARAM_IR: {
+			Operand dst = valueRegister(codegen, instr);
+			return emit(codegen, MOV_INSTR, dst, getFunctionArgRegister(instr->as.param + 1, dst.size));
+		}
+		case ADD_IR:
+		case SUB_IR:
+		case MUL_IR:
+			return generateArithmetic(codegen, instr);
+		case DIV_IR:
+		case MOD_IR:
+			return generateDivision(codegen, instr);
+		case NEG_IR: {
+			Operand dst = valueRegister(codegen, instr);
+			return emit(codegen, MOV_INSTR, dst, valueOperand(codegen, instr->operands[0]))
+				&& emit(codegen, NEG_INSTR, dst, noOperand());
+		}
+		case NOT_IR: {
+			// decided by the conditional jump of the branch instead
+			if (isFusedCondition(codegen, instr)) {
+				return 1;
+			}
+			Operand operand = materializeValue(codegen, instr->operands[0]);
+			return operand.kind != NO_OPERAND
+				&& emit(codegen, CMP_INSTR, operand, immediateOperand(0, operand.size))
+				&& emitCondition(codegen, SETCC_INSTR, EQUAL_COND, valueRegister(codegen, instr));
+		}
+		case LESS_IR:
+		case LESS_EQUAL_IR:
+		case GREATER_IR:
+		case GREATER_EQUAL_IR:
+		case EQUAL_IR:
+		case NOT_EQUAL_IR:
+			if (isFusedCondition(codegen, instr)) {
+				return 1;
+			}
+			return generateComparison(codegen, instr);
+		case LOAD_IR: {
+			Operand dst = valueRegister(codegen, instr);
+			return emit(codegen, MOV_INSTR, dst, globalOperand(instr->as.symbol, dst.size));
+		}
+		case STORE_IR: {
+			Operand src = valueOperand(codegen, instr->operands[0]);
+			return emit(codegen, MOV_INSTR, globalOperand(instr->as.symbol, src.size), src);
+		}
+		case CALL_IR:
+			return generateCall(codegen, instr);
+		case JUMP_IR:
+			if (!generatePhiCopies(codegen, instr->block, instr->targets[0])) {
+				return 0;
 			}
-			break;
-		case NEQ_OP:
-			switch (left->type) {
-				case BOOL_TYPE:
-					fprintf(stderr, "Error: Operand != not allowed for type boolean in addValues\n");
-					return NULL;
-				case LONG_TYPE:
-					res->as.i_64 = left->as.i_64 != right->as.i_64;
-					res->type = BOOL_TYPE;
-					break;
-				case DOUBLE_TYPE:
-					fprintf(stderr, "Error: Float type not implemented yet :(\n");
-					return NULL;
-				default:
-					fprintf(stderr, "Error: Unregognized type in addValues\n");
-					return NULL;
+			if (instr->targets[0] == next) {
+				return 1;
 			}
-			break;
+			return emit(codegen, JMP_INSTR, labelOperand(BLOCK_LABEL, instr->targets[0]->id), noOperand());
+		case BRANCH_IR:
+			return generateBranch(codegen, instr, next);
+		case RETURN_IR:
+			return generateReturn(codegen, instr, next);
 		default:
-			fprintf(stderr, "Error: Encountered illegal Operand in addValues\n");
+			fprintf(stderr, "Error: Unexpected ir instruction %s in generateInstruction\n", irOpcodeName(instr->opcode));
 			return 0;
 	}
-
-	free(right);
-	free(left);
-	return res;
 }
 
-int generateStatement(Codegen* codegen, Statement* statement) {
-	if (codegen == NULL || statement == NULL) {
-		return 0;
-	}
+int generateArithmetic(Codegen* codegen, IRInstr* instr) {
 
-	if (codegen->scopes->size == 1) {
-		return generateGlobalStatement(codegen, statement);
+	Operand dst = valueRegister(codegen, instr);
+
+	if (!emit(codegen, MOV_INSTR, dst, valueOperand(codegen, instr->operands[0]))) {
+		return 0;
 	}
 
-	switch (statement->type) {
-		case EXPRESSION_STMT:
-			annotateCall(codegen, statement->as.expression);
-			return generateExpression(codegen, statement->as.expression);
-		case FUNCTION_STMT:
-			for (int i = 0; i < statement->as.function->params->size; i++) {
-				annotateCall(codegen, statement->as.function->params->array[i]);
+	switch (instr->opcode) {
+		case ADD_IR:
+			return emit(codegen, ADD_INSTR, dst, valueOperand(codegen, instr->operands[1]));
+		case SUB_IR:
+			return emit(codegen, SUB_INSTR, dst, valueOperand(codegen, instr->operands[1]));
+		case MUL_IR: {
+			// imul has no form for 8 bit registers
+			if (dst.size == 1) {
+				fprintf(stderr, "Error: Cannot multiply bools\n");
+				return 0;
 			}
-			return generateFunctionStatement(codegen, statement->as.function);
-		case BLOCK_STMT:
-			return generateBlockStmt(codegen, statement->as.blockStmt, NULL, NULL, 0);
-		case WHILE_STMT:
-			annotateCall(codegen, statement->as.whileStmt->condition);
-			return generateWhileStmt(codegen, statement->as.whileStmt);
-		case IF_STMT:
-			annotateCall(codegen, statement->as.ifStmt->condition);
-			return generateIfStmt(codegen, statement->as.ifStmt);
-		case RETURN_STMT:
-			annotateCall(codegen, statement->as.returnStmt->expression);
-			return generateReturnStmt(codegen, statement->as.returnStmt);
-		case DECLARATION_STMT:
+			Operand src = materializeValue(codegen, instr->operands[1]);
+			return src.kind != NO_OPERAND && emit(codegen, IMUL_INSTR, dst, src);
+		}
 		default:
-			fprintf(stderr, "Error: Unexpected Statement type %d in generateStatement\n", statement->type);
 			return 0;
 	}
 }
 
-int generateFunctionStatement(Codegen* codegen, FunctionStmt* function) {
-	if (codegen == NULL || function == NULL) {
+// idiv divides edx:eax, the quotient ends up in eax and the remainder in edx
+int generateDivision(Codegen* codegen, IRInstr* instr) {
+
+	if (instr->type != LONG_TYPE) {
+		fprintf(stderr, "Error: Cannot divide bools\n");
 		return 0;
 	}
 
-	codegen->currentFunction = function;
+	Operand divisor = materializeValue(codegen, instr->operands[1]);
 
-	HashTable* functionScope = hashTable(256, free);
-	if (functionScope == NULL) {
+	if (divisor.kind == NO_OPERAND) {
 		return 0;
 	}
 
-	DynamicArray* params = dynamicArray(2, NULL);
-	if (params == NULL) {
-		freeTable(functionScope);
-		return 0;
-	}
+	Register result = instr->opcode == DIV_IR ? RAX_REG : RDX_REG;
 
-	int* labelCounter = malloc(sizeof(int));
-	if (labelCounter == NULL) {
-		freeTable(functionScope);
-		freeArray(params);
-		return 0;
-	}
-	*labelCounter = 0;
+	return emit(codegen, MOV_INSTR, registerOperand(RAX_REG, 4), valueOperand(codegen, instr->operands[0]))
+		&& emit(codegen, CDQ_INSTR, noOperand(), noOperand())
+		&& emit(codegen, IDIV_INSTR, divisor, noOperand())
+		&& emit(codegen, MOV_INSTR, valueRegister(codegen, instr), registerOperand(result, 4));
+}
 
-	if (!pushItem(codegen->labelCounters, labelCounter)) {
-		free(labelCounter);
-		freeTable(functionScope);
-		freeArray(params);
-		return 0;
-	}
+int generateComparison(Codegen* codegen, IRInstr* instr) {
+	Condition condition = emitComparison(codegen, instr);
+	return condition != NO_COND && emitCondition(codegen, SETCC_INSTR, condition, valueRegister(codegen, instr));
+}
 
-	// for now only i32s and 6 params allowed
-	if (function->params->size > 6) {
-		free(popItem(codegen->labelCounters));
-		freeTable(functionScope);
-		freeArray(params);
-		fprintf(stderr, "Error: Only 6 Function Prameters allowed for now\n");
-		return 0;
-	}
+// emits the cmp of a comparison and returns the condition that holds when it is true,
+// a constant on the left is swapped to the right where it can be an immediate
+Condition emitComparison(Codegen* codegen, IRInstr* instr) {
+
+	static const Condition conditions[] = {
+		[LESS_IR] = LESS_COND,
+		[LESS_EQUAL_IR] = LESS_EQUAL_COND,
+		[GREATER_IR] = GREATER_COND,
+		[GREATER_EQUAL_IR] = GREATER_EQUAL_COND,
+		[EQUAL_IR] = EQUAL_COND,
+		[NOT_EQUAL_IR] = NOT_EQUAL_COND,
+	};
 
-	// add Params
-	for (int i = 0; i < function->params->size; i++) {
-		Variable* param = (Variable*)function->params->array[i];
-		if (!insertKeyPair(functionScope, param->id, NULL)) {
-			free(popItem(codegen->labelCounters));
-			freeTable(functionScope);
-			freeArray(params);
-			return 0;
-		}
+	IRInstr* left = instr->operands[0];
+	IRInstr* right = instr->operands[1];
+	Condition condition = conditions[instr->opcode];
 
-		if (!pushItem(params, param)) {
-			free(popItem(codegen->labelCounters));
-			freeTable(functionScope);
-			freeArray(params);
-			return 0;
-		}
+	if (left->opcode == CONST_IR && right->opcode != CONST_IR) {
+		left = instr->operands[1];
+		right = instr->operands[0];
+		condition = swapCondition(condition);
 	}
 
-	function->toEmit = dynamicArray(16, free);
-	if (function->toEmit == NULL) {
-		free(popItem(codegen->labelCounters));
-		freeTable(functionScope);
-		return 0;
-	}
+	Operand operand = materializeValue(codegen, left);
 
-	
-	if (!generateBlockStmt(codegen, function->blockStmt, functionScope, params, function->params->size)) {
-		free(popItem(codegen->labelCounters));
-		freeArray(params);
-		return 0;
+	if (operand.kind == NO_OPERAND || !emit(codegen, CMP_INSTR, operand, valueOperand(codegen, right))) {
+		return NO_COND;
 	}
-	freeArray(params);
 
-	char instr[256];
-	int stackAllocationSize = function->maxStack;
+	return condition;
+}
 
-	if (function->maxCalleeSaved >= 0 && (function->maxCalleeSaved) % 2 == 0) {
-	    stackAllocationSize += 8;
-	}
+// a comparison or not that is only read by the branch at the end of its block, directly or through
+// other such nots, is not computed into a register. the branch compares and jumps on the flags instead
+bool isFusedCondition(Codegen* codegen, IRInstr* value) {
 
-	stackAllocationSize = (stackAllocationSize + 7) & ~7;
+	IRInstr* branch = value->block->last;
 
-	// function prologue
-	snprintf(instr, sizeof(instr), "; Start of Function \"%s\"\nsection .text\nglobal %s\n%s:\npush rbp\nmov rbp, rsp\n", function->id, function->id, function->id);
-	if (!addToBuffer(codegen, instr)) {
-		free(popItem(codegen->labelCounters));
-		return 0;
-	}
-	
-	// allocate space for local variables and align stack
-	snprintf(instr, sizeof(instr), "sub rsp, %d\n", stackAllocationSize);
-	if (!addToBuffer(codegen, instr)) {
-		free(popItem(codegen->labelCounters));
-		return 0;
+	if (branch == NULL || branch->opcode != BRANCH_IR) {
+		return false;
 	}
 
-	// push callee saved registers
-	if (function->maxCalleeSaved >= 0) {
-		for (int i = 0; i <= function->maxCalleeSaved; i++) {
-			const char* reg = getCalleeSavedRegister(i, 8);
-			snprintf(instr, sizeof(instr), "push %s\n", reg);
-			if (!addToBuffer(codegen, instr)) {
-				free(popItem(codegen->labelCounters));
-				return 0;
-			}
-		}
-	}
+	IRInstr* condition = branch->operands[0];
 
-	// emitting the function body
-	for (int i = 0; i < function->toEmit->size; i++) {
-		if (!addToBuffer(codegen, (char*)function->toEmit->array[i])) {
-			free(popItem(codegen->labelCounters));
-			return 0;
+	while (condition->block == value->block && codegen->useCounts[condition->id] == 1) {
+		if (condition == value) {
+			return isComparison(value->opcode) || value->opcode == NOT_IR;
+		}
+		if (condition->opcode != NOT_IR) {
+			return false;
 		}
+		condition = condition->operands[0];
 	}
 
-	// function epilogue
-	const char* printEpilogue = (strcmp(function->id, "main") == 0) ? "\tmov rdi, message\n\tmov esi, eax\n\tmov rax, 0\n\tcall printf\n\tmov rax, 0\n" : "";
-	if (!addToBuffer(codegen, printEpilogue)) {
-		free(popItem(codegen->labelCounters));
-		return 0;
-	}
+	return false;
+}
 
-	snprintf(instr, sizeof(instr), "%s_return:\n", function->id);
-	if (!addToBuffer(codegen, instr)) {
-		free(popItem(codegen->labelCounters));
+int generateCall(Codegen* codegen, IRInstr* instr) {
+
+	if (instr->operandCount > 6) {
+		fprintf(stderr, "Error: Only 6 Function Prameters allowed for now\n");
 		return 0;
 	}
 
-	// pop callee-saved registers in reverse order
-	if (function->maxCalleeSaved >= 0) {
-		for (int i = function->maxCalleeSaved; i >= 0; i--) {
-			const char* reg = getCalleeSavedRegister(i, 8);
-			snprintf(instr, sizeof(instr), "pop %s\n", reg);
-			if (!addToBuffer(codegen, instr)) {
-				free(popItem(codegen->labelCounters));
-				return 0;
-			}
+	// the arguments are computed already, so no argument register is overwritten too early
+	for (int i = 0; i < instr->operandCount; i++) {
+		Operand arg = valueOperand(codegen, instr->operands[i]);
+
+		if (!emit(codegen, MOV_INSTR, getFunctionArgRegister(i + 1, arg.size), arg)) {
+			return 0;
 		}
 	}
 
-	// deallocate local variable space
-	snprintf(instr, sizeof(instr), "add rsp, %d\n", stackAllocationSize);
-	if (!addToBuffer(codegen, instr)) {
-		free(popItem(codegen->labelCounters));
+	if (!emit(codegen, CALL_INSTR, symbolOperand(instr->as.symbol), noOperand())) {
 		return 0;
 	}
 
-	// restore base pointer and return
-	snprintf(instr, sizeof(instr), "leave\nret\n; End of Function \"%s\"\n\n", function->id);
-	if (!addToBuffer(codegen, instr)) return 0;
+	if (instr->type == UNKNOWN) {
+		return 1;
+	}
 
-	free(popItem(codegen->labelCounters));
+	Operand dst = valueRegister(codegen, instr);
+	return emit(codegen, MOV_INSTR, dst, registerOperand(RAX_REG, dst.size));
+}
 
-	codegen->currentFunction = NULL;
-	return 1;
+// main prints its result before it returns, so only the other functions may leave the call to the callee
+bool isSiblingCall(Codegen* codegen, IRInstr* call) {
+	return call->operandCount <= 6 && strcmp(codegen->irFunction->id, "main") != 0 && isTailCall(call);
 }
 
-// needs to create a new scope at start and remove it at the end
-// needs to handle correct increment/decrement of the global stack offset variable by e.g. remembering offset at start and resetting it at the end
-int generateBlockStmt(Codegen* codegen, BlockStmt* blockStmt, HashTable* scope, DynamicArray* params, int paramC) {
-	if (codegen == NULL || blockStmt == NULL) {
-		return 0;
-	}
+// the arguments are passed as for a call, generateFrame tears down the frame before the jump
+int generateTailCall(Codegen* codegen, IRInstr* call) {
 
-	HashTable* blockScope;
-	if (scope) {
-		blockScope = scope;
-	}
-	else {
-		blockScope = hashTable(256, free);
-	}
+	for (int i = 0; i < call->operandCount; i++) {
+		Operand arg = valueOperand(codegen, call->operands[i]);
 
-	if (blockScope == NULL) {
-		return 0;
+		if (!emit(codegen, MOV_INSTR, getFunctionArgRegister(i + 1, arg.size), arg)) {
+			return 0;
+		}
 	}
 
-	if (!pushItem(codegen->scopes, blockScope)) {
-		freeTable(blockScope);
-		return 0;
-	}
+	return emit(codegen, JMP_INSTR, symbolOperand(call->as.symbol), noOperand());
+}
 
-	DynamicArray* vars = dynamicArray(2, NULL);
+// the phis of the target take their values for the edge from block all at once, so when a phi
+// reads another phi of the same block the values go through temporaries first
+int generatePhiCopies(Codegen* codegen, IRBlock* block, IRBlock* target) {
 
-	if (params) {
-		for (int i = 0; i < params->size; i++) {
-			if (!pushItem(vars, params->array[i])) {
-				freeTable(scope);
-				freeArray(vars);
-				return 0;
-			}
-		}
+	int index = predecessorIndex(target, block);
+	int count = 0;
+	bool overlapping = false;
+
+	for (IRInstr* phi = target->first; phi != NULL && phi->opcode == PHI_IR; phi = phi->next) {
+		IRInstr* source = phi->operands[index];
+		overlapping = overlapping || (source->opcode == PHI_IR && source->block == target);
+		count++;
 	}
 
-	if (vars == NULL) {
-		freeTable(blockScope);
-		return 0;
+	if (count == 0) {
+		return 1;
 	}
 
-	for (int i = 0; i < blockStmt->stmts->size; i++) {
-		Statement* statement = ((Statement*)blockStmt->stmts->array[i]);
+	Operand* temporaries = overlapping ? malloc(count * sizeof(Operand)) : NULL;
 
-		if (statement->type == EXPRESSION_STMT && statement->as.expression->type == ASSIGN_EXPR) {
-			Variable* variable = ((Variable*)(statement->as.expression->as.assignment->variable));
-			HashTable* varScope = getScopeForVar(codegen, variable->id);
-			if (containsKey(blockScope, variable->id) || varScope == codegen->scopes->array[i] || getVariableOffset(codegen, variable->id) != 0) {
-				continue;
-			}
-			if (!insertKeyPair(blockScope, variable->id, NULL)) {
-				freeArray(vars);
-				freeTable(blockScope);
-				return 0;
-			}
-			if (!pushItem(vars, variable)) {
-				freeArray(vars);
-				freeTable(blockScope);
-				return 0;
-			}
-		}
+	if (overlapping && temporaries == NULL) {
+		return 0;
 	}
 
-	insertionSort(vars);
-	int currentMaxStackSize = codegen->currentFunction->maxStack;
+	int i = 0;
 
-	for (int i = 0; i < vars->size; i++) {
-		Variable* variable = ((Variable*)(vars->array[i]));
+	for (IRInstr* phi = target->first; phi != NULL && phi->opcode == PHI_IR; phi = phi->next, i++) {
+		IRInstr* source = phi->operands[index];
 
-		currentMaxStackSize += getTypeSize(variable->type);
-		int* varOffset = malloc(sizeof(int));
-		if (varOffset == NULL) {
-			freeArray(vars);
-			freeTable(blockScope);
-			return 0;
+		if (source == phi) {
+			continue;
 		}
-		*varOffset = -(int)currentMaxStackSize;
-		if (!updateKeyPair(blockScope, variable->id, varOffset)) {
-			free(varOffset);
-			freeArray(vars);
-			freeTable(blockScope);
+
+		Operand src = valueOperand(codegen, source);
+		Operand dst = overlapping ? newVirtualRegister(codegen->function, src.size) : valueRegister(codegen, phi);
+
+		if (!emit(codegen, MOV_INSTR, dst, src)) {
+			free(temporaries);
 			return 0;
 		}
-	}
 
-	// push params on the stack
-	if (params != NULL) {
-		for (int i = 0; i < paramC; i++) {
-			Variable* param = ((Variable*)params->array[i]);
-			const char* reg = getFunctionArgRegister(i+1, getTypeSize(param->type));
-			int paramOffset = *(int*)getValue(blockScope, param->id);
-			char instr[64];
-			snprintf(instr, sizeof(instr), "mov [rbp%+d], %s\n", paramOffset, reg);
-			if (!pushItem(codegen->currentFunction->toEmit, strdup(instr))) {
-				freeArray(vars);
-				freeTable((HashTable*)popItem(codegen->scopes));
-				return 0;
-			}
+		if (overlapping) {
+			temporaries[i] = dst;
 		}
 	}
 
-	freeArray(vars);
-	currentMaxStackSize = (currentMaxStackSize + 15) & ~15;
-	codegen->currentFunction->maxStack = currentMaxStackSize;
+	i = 0;
 
-	int maxDiff = 0;
-	for (int i = 0; i < blockStmt->stmts->size; i++) {
-		Statement* statement = (Statement*)blockStmt->stmts->array[i];
-
-		if (!generateStatement(codegen, statement)) {
-			freeTable((HashTable*)popItem(codegen->scopes));
+	for (IRInstr* phi = target->first; overlapping && phi != NULL && phi->opcode == PHI_IR; phi = phi->next, i++) {
+		if (phi->operands[index] != phi && !emit(codegen, MOV_INSTR, valueRegister(codegen, phi), temporaries[i])) {
+			free(temporaries);
 			return 0;
 		}
-
-		// we encountered another blockStmt that needed variable space
-		if (codegen->currentFunction->maxStack != currentMaxStackSize) {
-			int currentDiff = codegen->currentFunction->maxStack - currentMaxStackSize;
-			// new block is a new max
-			if (currentDiff > maxDiff) {
-				maxDiff = currentDiff;
-			}
-			codegen->currentFunction->maxStack = currentMaxStackSize;
-		}
 	}
 
-	codegen->currentFunction->maxStack = currentMaxStackSize + maxDiff;
-
-	freeTable((HashTable*)popItem(codegen->scopes));
+	free(temporaries);
 	return 1;
 }
 
-int generateWhileStmt(Codegen* codegen, WhileStmt* whileStmt) {
-	if (codegen == NULL || whileStmt == NULL) {
-		return 0;
-	}
-
-	int* counterPtr = (int*)peekArray(codegen->labelCounters);
-	int labelCounter = *counterPtr;
-	(*counterPtr)++;
-	char instr[64];
-	const char* functionID = codegen->currentFunction->id;
-
-	snprintf(instr, sizeof(instr), "%s_start_while_%d:\n", functionID, labelCounter);
-	if (!pushItem(codegen->currentFunction->toEmit, strdup(instr))) return 0;
+// an edge block on the way back to the start of a loop only holds the copies for the phis there.
+// they can go before the branch at the end of the loop instead, if nothing that runs after them
+// still needs the old values, so the loop branches back with a single conditional jump.
+// the loop is laid out from its header to the block that branches back
+bool isHoistedEdge(Codegen* codegen, IRBlock* block, IRBlock* edge) {
 
-	if (!generateExpression(codegen, whileStmt->condition)) return 0;
+	IRInstr* branch = block->last;
 
-	const char* testReg;
-	if (whileStmt->condition->hasCall) {
-		testReg = "rbx";
-	}
-	else {
-		testReg = "rax";
+	if (branch == NULL || branch->opcode != BRANCH_IR || edge->first != edge->last || edge->first->opcode != JUMP_IR) {
+		return false;
 	}
 
-	snprintf(instr, sizeof(instr), "\ttest %s, %s\n\tjz %s_end_while_%d\n", testReg, testReg, functionID, labelCounter);
-	if (!pushItem(codegen->currentFunction->toEmit, strdup(instr))) return 0;
+	IRBlock* header = edge->first->targets[0];
+	IRBlock* other = branch->targets[branch->targets[0] == edge ? 1 : 0];
 
-	if (!generateBlockStmt(codegen, whileStmt->body, NULL, NULL, 0)) return 0;
+	if (header->mark > block->mark || other->mark <= block->mark) {
+		return false;
+	}
 
-	snprintf(instr, sizeof(instr), "\tjmp %s_start_while_%d\n", functionID, labelCounter);
-	if (!pushItem(codegen->currentFunction->toEmit, strdup(instr))) return 0;
+	// the values the branch compares must not be overwritten by the copies
+	IRInstr* condition = branch->operands[0];
 
-	snprintf(instr, sizeof(instr), "%s_end_while_%d:\n", functionID, labelCounter);
-	if (!pushItem(codegen->currentFunction->toEmit, strdup(instr))) return 0;
+	while (condition->opcode == NOT_IR && isFusedCondition(codegen, condition)) {
+		condition = condition->operands[0];
+	}
 
-	return 1;
-}
+	IRInstr* reads[2] = {condition, NULL};
 
-int generateIfStmt(Codegen* codegen, IfStmt* ifStmt) {
-	if (codegen == NULL || ifStmt == NULL) {
-		return 0;
+	if (isComparison(condition->opcode) && isFusedCondition(codegen, condition)) {
+		reads[0] = condition->operands[0];
+		reads[1] = condition->operands[1];
 	}
 
-	int* counterPtr = (int*)peekArray(codegen->labelCounters);
-	int labelCounter = *counterPtr;
-	(*counterPtr)++;
-	char instr[64];
-	const char* functionId = codegen->currentFunction->id;
-	const char* testReg;
-	if (ifStmt->condition->hasCall) {
-		testReg = "rbx";
-	}
-	else {
-		testReg = "rax";
+	for (int i = 0; i < 2; i++) {
+		if (reads[i] != NULL && reads[i]->opcode == PHI_IR && reads[i]->block == header) {
+			return false;
+		}
 	}
 
-	if (!generateExpression(codegen, ifStmt->condition)) return 0;
+	// and the phis must not be read outside of the loop, where the loop may be left to
+	DynamicArray* blocks = codegen->irFunction->blocks;
 
-	if (ifStmt->type == ONLYIF) {
-		snprintf(instr, sizeof(instr), "\ttest %s, %s\n\tjz %s_end_if_%d\n", testReg, testReg, functionId, labelCounter);
-		if (!pushItem(codegen->currentFunction->toEmit, strdup(instr))) return 0;
+	for (int i = 0; i < blocks->size; i++) {
+		IRBlock* current = blocks->array[i];
 
-		if (!generateBlockStmt(codegen, ifStmt->trueBody, NULL, NULL, 0)) {
-			return 0;
+		if (current->mark >= header->mark && current->mark <= block->mark) {
+			continue;
 		}
-		snprintf(instr, sizeof(instr), "%s_end_if_%d:\n", functionId, labelCounter);
-		if (!pushItem(codegen->currentFunction->toEmit, strdup(instr))) return 0;
-
-		return 1;
-	}
-	else {
-		snprintf(instr, sizeof(instr), "\ttest %s, %s\n\tjz %s_else_%d\n", testReg, testReg, functionId, labelCounter);
-		if (!pushItem(codegen->currentFunction->toEmit, strdup(instr))) return 0;
 
-		int prevMaxStack = codegen->currentFunction->maxStack;
-		if (!generateBlockStmt(codegen, ifStmt->trueBody, NULL, NULL, 0)) {
-			return 0;
+		for (IRInstr* instr = current->first; instr != NULL; instr = instr->next) {
+			for (int o = 0; o < instr->operandCount; o++) {
+				if (instr->operands[o]->opcode == PHI_IR && instr->operands[o]->block == header) {
+					return false;
+				}
+			}
 		}
+	}
 
-		int trueBodyDiff = codegen->currentFunction->maxStack - prevMaxStack;
+	return true;
+}
 
-		snprintf(instr, sizeof(instr), "\tjmp %s_end_if_%d\n", functionId, labelCounter);
-		if (!pushItem(codegen->currentFunction->toEmit, strdup(instr))) return 0;
-		snprintf(instr, sizeof(instr), "%s_else_%d:\n", functionId, labelCounter);
-		if (!pushItem(codegen->currentFunction->toEmit, strdup(instr))) return 0;
+int generateBranch(Codegen* codegen, IRInstr* branch, IRBlock* next) {
 
-		codegen->currentFunction->maxStack = prevMaxStack;
-		if (ifStmt->type == IF_ELSE) {
-			if (!generateBlockStmt(codegen, ifStmt->as.ifElse, NULL, NULL, 0)) return 0;
-		} else {
-			if (!generateIfStmt(codegen, ifStmt->as.ifElseIf)) return 0;
-		}
+	IRInstr* condition = branch->operands[0];
+	IRBlock* targets[2] = {branch->targets[0], branch->targets[1]};
 
-		int blockDiff = codegen->currentFunction->maxStack - prevMaxStack;
+	for (int i = 0; i < 2; i++) {
+		if (isHoistedEdge(codegen, branch->block, targets[i])) {
+			IRBlock* header = targets[i]->first->targets[0];
 
-		if (blockDiff < trueBodyDiff) {
-			codegen->currentFunction->maxStack = prevMaxStack + trueBodyDiff;
+			if (!generatePhiCopies(codegen, targets[i], header)) {
+				return 0;
+			}
+			targets[i] = header;
 		}
-
-		snprintf(instr, sizeof(instr), "%s_end_if_%d:\n", functionId, labelCounter);
-		if (!pushItem(codegen->currentFunction->toEmit, strdup(instr))) return 0;
-
-		return 1;
 	}
-}
 
-int generateReturnStmt(Codegen* codegen, ReturnStmt* returnStmt) {
-	if (codegen == NULL || returnStmt == NULL) {
-		return 0;
-	}
+	IRBlock* trueTarget = targets[0];
+	IRBlock* falseTarget = targets[1];
 
-	const char* functionId = codegen->currentFunction->id;
-	if (!generateExpression(codegen, returnStmt->expression)) return 0;
-	if (strcmp(functionId, "main") == 0) {
-		return 1;
-	}
-	char instr[64];
-	int typeSize = getTypeSize(returnStmt->expression->valueType);
-	const char* src;
-	const char* dst = getFunctionArgRegister(0, typeSize);
-	if (returnStmt->expression->hasCall) {
-		src = getCalleeSavedRegister(0, typeSize);
-		snprintf(instr, sizeof(instr), "\tmov %s, %s\n", dst, src);
-		if (!pushItem(codegen->currentFunction->toEmit, strdup(instr))) return 0;
-	}
-	else {
-		src = getFunctionArgRegister(0, typeSize);
+	// a not only swaps the targets
+	while (condition->opcode == NOT_IR && isFusedCondition(codegen, condition)) {
+		IRBlock* target = trueTarget;
+		trueTarget = falseTarget;
+		falseTarget = target;
+		condition = condition->operands[0];
 	}
-	snprintf(instr, sizeof(instr), "\tjmp %s_return\n", functionId);
-	return pushItem(codegen->currentFunction->toEmit, strdup(instr));
-}
 
-static bool findCallsRecursive(Expression* expression);
-static void propagateCallsDownRecursive(Expression* expression, bool parentHasCall);
+	// nothing to decide at runtime
+	if (condition->opcode == CONST_IR) {
+		IRBlock* target = condition->as.constant ? trueTarget : falseTarget;
 
-int annotateCall(Codegen* codegen, Expression* expression) {
-	if (codegen == NULL || expression == NULL) {
-		return 0;
+		if (target == next) {
+			return 1;
+		}
+		return emit(codegen, JMP_INSTR, labelOperand(BLOCK_LABEL, target->id), noOperand());
 	}
 
-	findCallsRecursive(expression);
-	propagateCallsDownRecursive(expression, false);
-	return expression->hasCall;
-}
+	Condition jump = NOT_ZERO_COND;
 
-static bool findCallsRecursive(Expression* expression) {
-	if (expression == NULL) {
-		return false;
+	if (isComparison(condition->opcode) && isFusedCondition(codegen, condition)) {
+		jump = emitComparison(codegen, condition);
 	}
+	else {
+		Operand operand = valueRegister(codegen, condition);
 
-	bool foundCall = false;
-	switch (expression->type) {
-		case FUNCTIONCALL_EXPR:
-			foundCall = true;
-			break;
-		case EXPR_WRAPPER_EXPR:
-			foundCall = findCallsRecursive(expression->as.expWrap);
-			break;
-		case ASSIGN_EXPR:
-			foundCall = findCallsRecursive(expression->as.assignment->expression);
-			break;
-		case UNARY_EXPR:
-			foundCall = findCallsRecursive(expression->as.unop->right);
-			break;
-		case BINOP_EXPR: {
-			bool leftHasCall = findCallsRecursive(expression->as.binop->left);
-			bool rightHasCall = findCallsRecursive(expression->as.binop->right);
-			foundCall = leftHasCall || rightHasCall;
-			break;
+		if (!emit(codegen, CMP_INSTR, operand, immediateOperand(0, operand.size))) {
+			return 0;
 		}
-		case VARIABLE_EXPR:
-		case VALUE_EXPR:
-			foundCall = false;
-			break;
-		default:
-			foundCall = false;
-			break;
 	}
 
-	expression->hasCall = foundCall;
-	return foundCall;
-}
-
-static void propagateCallsDownRecursive(Expression* expression, bool parentHasCall) {
-	if (expression == NULL) {
-		return;
+	if (jump == NO_COND) {
+		return 0;
 	}
 
-	expression->hasCall = parentHasCall || expression->hasCall;
-
-	switch (expression->type) {
-		case FUNCTIONCALL_EXPR:
-			for (int i = 0; i < expression->as.functionCall->params->size; i++) {
-				propagateCallsDownRecursive(expression->as.functionCall->params->array[i], expression->hasCall);
-			}
-			break;
-		case EXPR_WRAPPER_EXPR:
-			propagateCallsDownRecursive(expression->as.expWrap, expression->hasCall);
-			break;
-		case ASSIGN_EXPR:
-			propagateCallsDownRecursive(expression->as.assignment->expression, expression->hasCall);
-			break;
-		case UNARY_EXPR:
-			propagateCallsDownRecursive(expression->as.unop->right, expression->hasCall);
-			break;
-		case BINOP_EXPR:
-			propagateCallsDownRecursive(expression->as.binop->left, expression->hasCall);
-			propagateCallsDownRecursive(expression->as.binop->right, expression->hasCall);
-			break;
-		case VARIABLE_EXPR:
-		case VALUE_EXPR:
-			break;
+	if (trueTarget == next) {
+		return emitCondition(codegen, JCC_INSTR, invertCondition(jump), labelOperand(BLOCK_LABEL, falseTarget->id));
 	}
-}
-	
 
-int generateExpression(Codegen* codegen, Expression* expression) {
-	if (codegen == NULL || expression == NULL) {
+	if (!emitCondition(codegen, JCC_INSTR, jump, labelOperand(BLOCK_LABEL, trueTarget->id))) {
 		return 0;
 	}
 
-	switch (expression->type) {
-		case EXPR_WRAPPER_EXPR:
-			return generateExpression(codegen, expression->as.expWrap);
-		case FUNCTIONCALL_EXPR:
-			return generateFunctionCall(codegen, expression->as.functionCall, expression->hasCall);
-		case ASSIGN_EXPR:
-			return generateAssignment(codegen, expression->as.assignment);
-		case UNARY_EXPR:
-			return generateUnaryOperation(codegen, expression->as.unop);
-		case BINOP_EXPR:
-			return generateBinOperation(codegen, expression->as.binop);
-		case VARIABLE_EXPR: {
-			char instr[128];
-			const char* destReg;
-			int typeSize = getTypeSize(expression->as.variable->type);
-
-			if (expression->hasCall) {
-				destReg = getCalleeSavedRegister(codegen->currentFunction->calleeSaved, typeSize);
-			}
-			else {
-				destReg = getFunctionArgRegister(codegen->currentFunction->callerSaved, typeSize);
-			}
-
-			char varLocation[64];
-			HashTable* varScope = getScopeForVar(codegen, expression->as.variable->id);
-			if ((HashTable*)codegen->scopes->array[0] == varScope) {
-				snprintf(varLocation, sizeof(varLocation), "[%s]", expression->as.variable->id);
-			}
-			else {
-				int variableOffset = getVariableOffset(codegen, expression->as.variable->id);
-				snprintf(varLocation, sizeof(varLocation), "[rbp%d]", variableOffset);
-			}
-
-			snprintf(instr, sizeof(instr), "\tmov %s, %s\n", destReg, varLocation);
-			return pushItem(codegen->currentFunction->toEmit, strdup(instr));
-		}
-		case VALUE_EXPR: {
-			char instr[128];
-			switch (expression->as.value->type) {
-				case LONG_TYPE: {
-					const char* destReg;
-					int typeSize = getTypeSize(LONG_TYPE);
-
-					if (expression->hasCall) {
-						destReg = getCalleeSavedRegister(codegen->currentFunction->calleeSaved, typeSize);
-					}
-					else {
-						destReg = getFunctionArgRegister(codegen->currentFunction->callerSaved, typeSize);
-					}
-
-					snprintf(instr, sizeof(instr), "\tmov %s, %ld\n", destReg, expression->as.value->as.i_32);
-					return pushItem(codegen->currentFunction->toEmit, strdup(instr));
-				}
-				case DOUBLE_TYPE:
-					fprintf(stderr, "Error: Did not implement float Types yet :(\n");
-					return 0;
-				case BOOL_TYPE: {
-					const char* destReg;
-
-					if (expression->hasCall) {
-						destReg = getCalleeSavedRegister(codegen->currentFunction->calleeSaved, 8);
-					}
-					else {
-						destReg = getFunctionArgRegister(codegen->currentFunction->callerSaved, 8);
-					}
-
-					snprintf(instr, sizeof(instr), "\tmov %s, %d\n", destReg, expression->as.value->as.b);
-					return pushItem(codegen->currentFunction->toEmit, strdup(instr));
-				}
-				default:
-					fprintf(stderr, "Error: Unregognized Value Type in generateValue\n");
-					return 0;
-			}
-		}
-		default:
-			fprintf(stderr, "Error: Unexpected Expression type in generate Expression\n");
-			return 0;
+	if (falseTarget == next) {
+		return 1;
 	}
+	return emit(codegen, JMP_INSTR, labelOperand(BLOCK_LABEL, falseTarget->id), noOperand());
 }
 
-int generateFunctionCall(Codegen* codegen, FunctionCall* function, int hasCall) {
-	if (codegen == NULL || function == NULL) {
-		return 0;
-	}
+// the result goes to eax, the epilogue follows the last block
+int generateReturn(Codegen* codegen, IRInstr* ret, IRBlock* next) {
 
-	char instr[64];
+	Operand value = valueOperand(codegen, ret->operands[0]);
+	Operand result = registerOperand(RAX_REG, 4);
 
-	for (int i = 0; i < function->params->size; i++) {
-		findCallsRecursive(function->params->array[i]);
+	if (value.kind == IMMEDIATE_OPERAND) {
+		if (!emit(codegen, MOV_INSTR, result, immediateOperand(value.as.immediate, 4))) return 0;
+	}
+	else if (value.size == 1) {
+		if (!emit(codegen, MOVZX_INSTR, result, value)) return 0;
+	}
+	else {
+		if (!emit(codegen, MOV_INSTR, result, value)) return 0;
 	}
 
-	// calculate and store args
-	for (int i = 0; i < function->params->size; i++) {
-		Expression* arg = (Expression*)function->params->array[i];
+	if (next == NULL) {
+		return 1;
+	}
 
-		if (codegen->currentFunction->calleeSaved+1 > codegen->currentFunction->maxCalleeSaved) {
-			if (codegen->currentFunction->calleeSaved > 4) {
-				fprintf(stderr, "Error: ran out of Registers when trying to evaluate Function Arguments\n");
-				return 0;
-			}
-			codegen->currentFunction->maxCalleeSaved = codegen->currentFunction->calleeSaved;
-		}
+	return emit(codegen, JMP_INSTR, labelOperand(RETURN_LABEL, 0), noOperand());
+}
 
-		if (!generateExpression(codegen, arg)) return 0;
+// prologue and epilogue, once the frame size and the used callee saved registers are known.
+// without a frame pointer the slots are addressed relative to rsp, and a leaf function whose slots
+// fit into the red zone below rsp needs no frame at all
+int generateFrame(Codegen* codegen, IRFunction* function) {
 
-		int argSize = getTypeSize(arg->valueType);
-		const char* opcode = (argSize == 1 || argSize == 2) ? "movzx" : "mov";
+	MachineFunction* machine = codegen->function;
+	bool saved[5] = {false};
+	int savedCount = 0;
+	// main calls printf in its epilogue
+	bool leaf = strcmp(function->id, "main") != 0;
 
-		const char* dstReg = getCalleeSavedRegister(codegen->currentFunction->calleeSaved, (argSize >= 4) ? argSize : 8);
-		const char* srcReg;
-		
-		if (arg->hasCall) {
-			srcReg = getCalleeSavedRegister(codegen->currentFunction->calleeSaved, argSize);
-		}
-		else {
-			srcReg = getFunctionArgRegister(codegen->currentFunction->callerSaved, argSize);
-		}
-
-		snprintf(instr, sizeof(instr), "\t%s %s, %s\n", opcode, dstReg, srcReg);
-		codegen->currentFunction->calleeSaved++;
-		if (!pushItem(codegen->currentFunction->toEmit, strdup(instr))) return 0;
-	}
+	for (int i = 0; i < machine->size; i++) {
+		MachineInstr* instr = &machine->code[i];
+		leaf = leaf && instr->opcode != CALL_INSTR;
 
-	// put args into correct registers
-	for (int i = 0; i < function->params->size; i++) {
-		Expression* arg = (Expression*)function->params->array[i];
-		int argSize = getTypeSize(arg->valueType);
-		const char* argSrc;
-		const char* argDst;
-		
-		argSrc = getCalleeSavedRegister(codegen->currentFunction->calleeSaved-(function->params->size-i), argSize);
+		for (int j = 0; j < 5; j++) {
+			Register reg = getCalleeSavedRegister(j, 8).as.reg;
+			bool used = (instr->dst.kind == REGISTER_OPERAND && instr->dst.as.reg == reg)
+				|| (instr->src.kind == REGISTER_OPERAND && instr->src.as.reg == reg);
 
-		argDst = getFunctionArgRegister(i+1, argSize);
-		snprintf(instr, sizeof(instr), "\tmov %s, %s\n", argDst, argSrc);
-		if (!pushItem(codegen->currentFunction->toEmit, strdup(instr))) return 0;
+			if (used && !saved[j]) {
+				saved[j] = true;
+				savedCount++;
+			}
+		}
 	}
 
-	int retTypeSize = getTypeSize(function->returnType);
-	const char* raxReg = getFunctionArgRegister(0, retTypeSize);
-	const char* dstReg;
+	int slotSize = (machine->frameSize + 7) & ~7;
+	bool redZone = !codegen->keepFramePointer && leaf && slotSize <= RED_ZONE_SIZE;
+	int stackAllocationSize = redZone ? 0 : slotSize;
+	// the return address and rbp, if it is pushed, are on the stack as well
+	int pushedSize = 8 * savedCount + (codegen->keepFramePointer ? 16 : 8);
 
-	if (hasCall) {
-		dstReg = getCalleeSavedRegister(codegen->currentFunction->calleeSaved-function->params->size, retTypeSize);
-	}
-	else {
-		dstReg = getFunctionArgRegister(codegen->currentFunction->callerSaved, retTypeSize);
+	// the stack stays 16 byte aligned for calls
+	if (!leaf && (stackAllocationSize + pushedSize) % 16 != 0) {
+		stackAllocationSize += 8;
 	}
 
-	snprintf(instr, sizeof(instr), "\tcall %s\n\tmov %s, %s\n", function->id, dstReg, raxReg);
-	codegen->currentFunction->calleeSaved -= function->params->size;
-	return pushItem(codegen->currentFunction->toEmit, strdup(instr));
-}
+	MachineInstr prologue[8];
+	int prologueSize = 0;
+	MachineInstr teardown[8];
+	int teardownSize = 0;
 
-int generateBinOperation(Codegen* codegen, BinOperation* binOperation) {
-	if (codegen == NULL || binOperation == NULL) {
-		return 0;
+	// with a frame pointer the slots are right below rbp and the registers are saved below them,
+	// without one the registers are pushed first and the slots are allocated below them
+	if (codegen->keepFramePointer) {
+		prologue[prologueSize++] = (MachineInstr){PUSH_INSTR, NO_COND, registerOperand(RBP_REG, 8), noOperand()};
+		prologue[prologueSize++] = (MachineInstr){MOV_INSTR, NO_COND, registerOperand(RBP_REG, 8), registerOperand(RSP_REG, 8)};
 	}
 
-	const char* leftReg;
-	const char* rightReg;
-	int typeSize = getTypeSize(binOperation->left->valueType);
-
+	if (codegen->keepFramePointer && stackAllocationSize > 0) {
+		prologue[prologueSize++] = (MachineInstr){SUB_INSTR, NO_COND, registerOperand(RSP_REG, 8), immediateOperand(stackAllocationSize, 4)};
+	}
 
-	int hasCall = binOperation->left->hasCall;
+	for (int i = 0; i < 5; i++) {
+		if (saved[i]) {
+			prologue[prologueSize++] = (MachineInstr){PUSH_INSTR, NO_COND, getCalleeSavedRegister(i, 8), noOperand()};
+		}
+	}
 
-	if (hasCall) {
-		leftReg = getCalleeSavedRegister(codegen->currentFunction->calleeSaved, typeSize);
+	if (!codegen->keepFramePointer && stackAllocationSize > 0) {
+		prologue[prologueSize++] = (MachineInstr){SUB_INSTR, NO_COND, registerOperand(RSP_REG, 8), immediateOperand(stackAllocationSize, 4)};
+		teardown[teardownSize++] = (MachineInstr){ADD_INSTR, NO_COND, registerOperand(RSP_REG, 8), immediateOperand(stackAllocationSize, 4)};
+	}
 
-		if (codegen->currentFunction->calleeSaved + 1 > codegen->currentFunction->maxCalleeSaved) {
-			if (codegen->currentFunction->calleeSaved > 4) {
-				fprintf(stderr, "Error: Ran out of Callee-Saved Registers when evaluating Expression\n");
-				return 0;
-			}
-			codegen->currentFunction->maxCalleeSaved = codegen->currentFunction->calleeSaved;
+	// pop callee-saved registers in reverse order
+	for (int i = 4; i >= 0; i--) {
+		if (saved[i]) {
+			teardown[teardownSize++] = (MachineInstr){POP_INSTR, NO_COND, getCalleeSavedRegister(i, 8), noOperand()};
 		}
-		rightReg = getCalleeSavedRegister(codegen->currentFunction->calleeSaved + 1, typeSize);
+	}
 
-		if (!generateExpression(codegen, binOperation->left)) return 0;
-		codegen->currentFunction->calleeSaved++;
-		if (!generateExpression(codegen, binOperation->right)) return 0;
-		codegen->currentFunction->calleeSaved--;
+	// leave deallocates the slots as well
+	if (codegen->keepFramePointer) {
+		teardown[teardownSize++] = (MachineInstr){LEAVE_INSTR, NO_COND, noOperand(), noOperand()};
 	}
-	else {
-		// dont use rdx for now, as it may be used in integer division as special register for overflow, also for mod operations later
-		int originalCallerSaved = codegen->currentFunction->callerSaved;
 
-		int leftIdx = originalCallerSaved;
-		if (leftIdx == 3) {
-			leftIdx++;
-		}
-		
-		int rightIdx = leftIdx + 1;
-		if (rightIdx == 3) {
-			rightIdx++;
-		}
-		
-		if (rightIdx > codegen->currentFunction->maxCallerSaved) {
-			if (rightIdx > 6) {
-				fprintf(stderr, "Error: Ran out of Caller-Saved Registers when evaluating Expression\n");
-				return 0;
-			}
-			codegen->currentFunction->maxCallerSaved = rightIdx;
-		}
-		
-		leftReg = getFunctionArgRegister(leftIdx, typeSize);
-		rightReg = getFunctionArgRegister(rightIdx, typeSize);
-		
-		codegen->currentFunction->callerSaved = leftIdx;
-		if (!generateExpression(codegen, binOperation->left)) codegen->currentFunction->callerSaved = originalCallerSaved;
-		
-		codegen->currentFunction->callerSaved = rightIdx;
-		if (!generateExpression(codegen, binOperation->right)) return 0;
-		
-		codegen->currentFunction->callerSaved = originalCallerSaved;
-	}
-
-	char instr[64];
-	switch (binOperation->type) {
-		case ADD_OP:
-			snprintf(instr, sizeof(instr), "\tadd %s, %s\n", leftReg, rightReg);
-			return pushItem(codegen->currentFunction->toEmit, strdup(instr));
-		case SUB_OP:
-			snprintf(instr, sizeof(instr), "\tsub %s, %s\n", leftReg, rightReg);
-			return pushItem(codegen->currentFunction->toEmit, strdup(instr));
-		case MUL_OP: {
-			snprintf(instr, sizeof(instr), "\timul %s, %s\n", leftReg, rightReg);
-			return pushItem(codegen->currentFunction->toEmit, strdup(instr));
-		}
-		case DIV_OP: {
-			const char* raxReg = getFunctionArgRegister(0, typeSize);
-			snprintf(instr, sizeof(instr), "\tmov %s, %s\n\tidiv %s\n", raxReg, rightReg, leftReg);
-			return pushItem(codegen->currentFunction->toEmit, strdup(instr));
-		}
-		case MOD_OP:
-			fprintf(stderr, "Error: Operator Modulus not implemented yet\n");
-			return 0;
-		case ST_OP:
-		case STE_OP:
-		case GT_OP:
-		case GTE_OP:
-		case EQ_OP:
-		case NEQ_OP:
-			snprintf(instr, sizeof(instr), "\tcmp %s, %s\n", leftReg, rightReg);
-			if (!pushItem(codegen->currentFunction->toEmit, strdup(instr))) return 0;
-
-			const char* destBoolReg;
-			if (hasCall) {
-				destBoolReg = getCalleeSavedRegister(codegen->currentFunction->calleeSaved, 1);
-			}
-			else {
-				destBoolReg = getFunctionArgRegister(codegen->currentFunction->callerSaved, 1);
-			}
-			switch (binOperation->type) {
-				case ST_OP:
-					snprintf(instr, sizeof(instr), "\tsetl %s\n", destBoolReg);
-					if(!pushItem(codegen->currentFunction->toEmit, strdup(instr))) return 0;
-					break;
-				case STE_OP:
-					snprintf(instr, sizeof(instr), "\tsetle %s\n", destBoolReg);
-					if(!pushItem(codegen->currentFunction->toEmit, strdup(instr))) return 0;
-					break;
-				case GT_OP:
-					snprintf(instr, sizeof(instr), "\tsetg %s\n", destBoolReg);
-					if(!pushItem(codegen->currentFunction->toEmit, strdup(instr))) return 0;
-					break;
-				case GTE_OP:
-					snprintf(instr, sizeof(instr), "\tsetge %s\n", destBoolReg);
-					if(!pushItem(codegen->currentFunction->toEmit, strdup(instr))) return 0;
-					break;
-				case EQ_OP:
-					snprintf(instr, sizeof(instr), "\tsete %s\n", destBoolReg);
-					if(!pushItem(codegen->currentFunction->toEmit, strdup(instr))) return 0;
-					break;
-				case NEQ_OP:
-					snprintf(instr, sizeof(instr), "\tsetne %s\n", destBoolReg);
-					if(!pushItem(codegen->currentFunction->toEmit, strdup(instr))) return 0;
-					break;
-				default:
-					fprintf(stderr, "Error: Encountered illegal Operand in generateBinOperation\n");
-					return 0;
-			}
+	for (int i = machine->size - 1; i >= 0; i--) {
+		MachineInstr* instr = &machine->code[i];
+		Operand* operands[2] = {&instr->dst, &instr->src};
 
-			const char* fullDestReg;
-			if (hasCall) {
-				fullDestReg = getCalleeSavedRegister(codegen->currentFunction->calleeSaved, 8);
-			}
-			else {
-				fullDestReg = getFunctionArgRegister(codegen->currentFunction->callerSaved, 8);
+		// the slots were numbered down from rbp, without it they sit at the bottom of the allocation
+		for (int j = 0; j < 2 && !codegen->keepFramePointer; j++) {
+			if (operands[j]->kind == FRAME_OPERAND) {
+				operands[j]->base = RSP_REG;
+				operands[j]->as.offset += stackAllocationSize;
 			}
+		}
 
-			snprintf(instr, sizeof(instr), "\tmovzx %s, %s\n", fullDestReg, destBoolReg);
-			return pushItem(codegen->currentFunction->toEmit, strdup(instr));
-		default:
-			fprintf(stderr, "Error: Encountered illegal Operand generateBinOperation\n");
+		// tail calls leave with the frame of the caller gone, the callee returns in its place
+		if (instr->opcode == JMP_INSTR && instr->dst.kind == SYMBOL_OPERAND && !insertInstructions(machine, i, teardown, teardownSize)) {
 			return 0;
+		}
 	}
-}
 
-int generateUnaryOperation(Codegen* codegen, UnaryOperation* unaryOperation) {
-	if (codegen == NULL || unaryOperation == NULL) {
+	if (!insertInstructions(machine, 0, prologue, prologueSize) || !emitLabel(codegen, RETURN_LABEL, 0)) {
 		return 0;
 	}
 
-	const char* testReg;
-
-	char instr[128];
-
-	if (unaryOperation->type == NOT) {
-		const char* fullReg;
-		const char* dstReg;
-		if (unaryOperation->right->hasCall) {
-			testReg = getCalleeSavedRegister(codegen->currentFunction->calleeSaved, 1);
-			dstReg = getCalleeSavedRegister(codegen->currentFunction->calleeSaved, 1);
-			fullReg = getCalleeSavedRegister(codegen->currentFunction->calleeSaved, 8);
-		}
-		else {
-			testReg = getFunctionArgRegister(codegen->currentFunction->callerSaved, 1);
-			dstReg = getFunctionArgRegister(codegen->currentFunction->callerSaved, 1);
-			fullReg = getFunctionArgRegister(codegen->currentFunction->callerSaved, 8);
+	// function epilogue, main prints its result
+	if (strcmp(function->id, "main") == 0) {
+		if (!emit(codegen, MOV_INSTR, registerOperand(RDI_REG, 8), symbolOperand("message"))
+			|| !emit(codegen, MOV_INSTR, registerOperand(RSI_REG, 4), registerOperand(RAX_REG, 4))
+			|| !emit(codegen, MOV_INSTR, registerOperand(RAX_REG, 8), immediateOperand(0, 4))
+			|| !emit(codegen, CALL_INSTR, symbolOperand("printf"), noOperand())
+			|| !emit(codegen, MOV_INSTR, registerOperand(RAX_REG, 8), immediateOperand(0, 4))) {
+			return 0;
 		}
-		if (!generateExpression(codegen, unaryOperation->right)) return 0;
-		snprintf(instr, sizeof(instr), "\tmovzx %s, %s\n\ttest %s, %s\n\tsetz %s\n", fullReg, dstReg, testReg, testReg, testReg);
-		return pushItem(codegen->currentFunction->toEmit, strdup(instr));
 	}
-	else if (unaryOperation->type == MINUS) {
-		int typeSize = getTypeSize(unaryOperation->right->valueType);
 
-		if (unaryOperation->right->hasCall) {
-			testReg = getCalleeSavedRegister(codegen->currentFunction->calleeSaved, typeSize);
-		}
-		else {
-			testReg = getFunctionArgRegister(codegen->currentFunction->callerSaved, typeSize);
+	for (int i = 0; i < teardownSize; i++) {
+		if (!emit(codegen, teardown[i].opcode, teardown[i].dst, teardown[i].src)) {
+			return 0;
 		}
-		if (!generateExpression(codegen, unaryOperation->right)) return 0;
-		snprintf(instr, sizeof(instr), "\tneg %s\n", testReg);
-		return pushItem(codegen->currentFunction->toEmit, strdup(instr));
 	}
 
-	fprintf(stderr, "Error: Unexpected Unary Operation Operand encountered in generateUnaryOperation: %d\n", unaryOperation->type);
-	return 0;
+	return emit(codegen, RET_INSTR, noOperand(), noOperand());
 }
 
-int generateAssignment(Codegen* codegen, Assignment* assignment) {
-	if (codegen == NULL || assignment == NULL) {
-		return 0;
-	}
-
-	if (!generateExpression(codegen, assignment->expression)) return 0;
-	int variableOffset = getVariableOffset(codegen, assignment->variable->id);
+// the virtual register that holds the value, handed out on first use
+Operand valueRegister(Codegen* codegen, IRInstr* value) {
 
-	ValueType variableType = assignment->variable->type;
-	int typeSize = getTypeSize(variableType);
-
-	const char* reg;
-	if (assignment->expression->hasCall) {
-		reg = getCalleeSavedRegister(0, typeSize);
-	}
-	else {
-		reg = getFunctionArgRegister(0, typeSize);
-	}
+	Operand* reg = &codegen->valueRegisters[value->id];
 
-	HashTable* varScope = getScopeForVar(codegen, assignment->variable->id);
-	char varLocation[64];
-	// global variable
-	if ((HashTable*)codegen->scopes->array[0] == varScope) {
-		snprintf(varLocation, sizeof(varLocation), "[%s]", assignment->variable->id);
-	}
-	else {
-		snprintf(varLocation, sizeof(varLocation), "[rbp%d]", variableOffset);
+	if (reg->kind == NO_OPERAND) {
+		*reg = newVirtualRegister(codegen->function, getTypeSize(value->type));
 	}
 
-	char lastInstruction[128];
-	snprintf(lastInstruction, sizeof(lastInstruction), "\tmov %s, %s\n", varLocation, reg);
-
-	return pushItem(codegen->currentFunction->toEmit, strdup(lastInstruction));
+	return *reg;
 }
 
-int getVariableOffset(Codegen* codegen, char* id) {
-	if (codegen == NULL || id == NULL) {
-		return 0;
-	}
+// constants as immediates, everything else in its register
+Operand valueOperand(Codegen* codegen, IRInstr* value) {
 
-	for (int i = 0; i < codegen->scopes->size; i++) {
-		if (containsKey(codegen->scopes->array[i], id)) {
-			void* value = getValue((HashTable*)codegen->scopes->array[i], id);
-			if (value == NULL) return 0;
-			return (ValueType)*(int*)value;
-		}
+	if (value->opcode == CONST_IR) {
+		return immediateOperand(value->as.constant, getTypeSize(value->type));
 	}
 
-	return 0;
+	return valueRegister(codegen, value);
 }
 
-HashTable* getScopeForVar(Codegen* codegen, char* id) {
-	if (codegen == NULL || id == NULL) {
-		return NULL;
+// for operands that cannot be immediates, constants are moved into a fresh register first
+Operand materializeValue(Codegen* codegen, IRInstr* value) {
+
+	if (value->opcode != CONST_IR) {
+		return valueRegister(codegen, value);
 	}
 
-	for (int i = 0; i < codegen->scopes->size; i++) {
-		if (containsKey(codegen->scopes->array[i], id)) {
-			return (HashTable*)codegen->scopes->array[i];
-		}
+	Operand reg = newVirtualRegister(codegen->function, getTypeSize(value->type));
+
+	if (!emit(codegen, MOV_INSTR, reg, valueOperand(codegen, value))) {
+		return noOperand();
 	}
 
-	return NULL;
+	return reg;
 }
 
 int getTypeSize(ValueType type) {
@@ -1500,70 +850,37 @@ int getTypeSize(ValueType type) {
 		default:
 			fprintf(stderr, "Error: Unrecognized Type %d, cannot get type Offset\n", type);
 			return 0;
-			
+
 	}
 }
 
-const char* getFunctionArgRegister(int reg, int typeSize) {
-	static const char* register_names[7][4] = {
-		{"al",  "ax",  "eax", "rax"},
-		{"dil", "di",  "edi", "rdi"},
-		{"sil", "si",  "esi", "rsi"},
-		{"dl",  "dx",  "edx", "rdx"},
-		{"cl",  "cx",  "ecx", "rcx"},
-		{"r8b", "r8w", "r8d", "r8" },
-		{"r9b", "r9w", "r9d", "r9" }
-	};
-
-	if (reg > 6 || typeSize < 0) {
-		return NULL;
-	}
+Operand getFunctionArgRegister(int reg, int typeSize) {
+	static const Register registers[7] = {RAX_REG, RDI_REG, RSI_REG, RDX_REG, RCX_REG, R8_REG, R9_REG};
 
-	int size_index;
-	switch (typeSize) {
-		case 1: size_index = 0; break;
-		case 2: size_index = 1; break;
-		case 4: size_index = 2; break;
-		case 8: size_index = 3; break;
-		default:
-			return NULL;
+	if (reg < 0 || reg > 6) {
+		return noOperand();
 	}
 
-	return register_names[reg][size_index];
+	return registerOperand(registers[reg], typeSize);
 }
 
-const char* getCalleeSavedRegister(int reg, int typeSize) {
-	static const char* register_names[5][4] = {
-		{"bl",  "bx",   "ebx",  "rbx"},
-		{"r12b","r12w", "r12d", "r12"},
-		{"r13b","r13w", "r13d", "r13"},
-		{"r14b","r14w", "r14d", "r14"},
-		{"r15b","r15w", "r15d", "r15"}
-	};
+Operand getCalleeSavedRegister(int reg, int typeSize) {
+	static const Register registers[5] = {RBX_REG, R12_REG, R13_REG, R14_REG, R15_REG};
 
 	if (reg < 0 || reg > 4) {
-		return NULL;
-	}
-
-	int size_index;
-	switch (typeSize) {
-		case 1: size_index = 0; break;
-		case 2: size_index = 1; break;
-		case 4: size_index = 2; break;
-		case 8: size_index = 3; break;
-		default:
-			return NULL;
+		return noOperand();
 	}
 
-	return register_names[reg][size_index];
+	return registerOperand(registers[reg], typeSize);
 }
 
 void freeCodegen(Codegen* codegen) {
 	if (codegen == NULL) {
 		return;
 	}
-	freeArray(codegen->labelCounters);
-	freeArray(codegen->scopes);
-	free(codegen->buffer);
+	free(codegen->valueRegisters);
+	free(codegen->useCounts);
+	freePeepholeStats(codegen->peepholeStats);
+	freeMachineModule(codegen->module);
 	free(codegen);
 }
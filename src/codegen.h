@@ -1,5 +1,8 @@
-#include "parser.h"
+#include "ir.h"
+#include "machineIR.h"
+#include "peephole.h"
 #include "utils.h"
+#include <stdbool.h>
 
 #ifndef CODEGEN_H
 #define CODEGEN_H
@@ -7,17 +10,26 @@
 typedef struct Codegen Codegen;
 
 struct Codegen {
-	int idx;
-	int maxSize;
-	char* buffer;
-	int stackOffset;
-	FunctionStmt* currentFunction;
-	DynamicArray* labelCounters;
-	DynamicArray* scopes;
-	DynamicArray* ast;
+	// the generated program, printed as assembly by writeToFile
+	MachineModule* module;
+	// machine code of the function that is currently generated
+	MachineFunction* function;
+	IRModule* ir;
+	IRFunction* irFunction;
+	// virtual register of every ir value of the current function by value id, created on first use
+	Operand* valueRegisters;
+	// number of instructions reading every ir value of the current function by value id
+	int* useCounts;
+	// keep every value in a frame slot instead of allocating registers, the baseline of the loop benchmark
+	bool stackOnly;
+	// clean up the finished machine code of every function, off to debug the instruction selection
+	bool peephole;
+	PeepholeStats* peepholeStats;
+	// keep rbp as frame pointer in every function, for profilers and debuggers walking the stack
+	bool keepFramePointer;
 };
 
-Codegen* initializeCodegen(DynamicArray* ast);
+Codegen* initializeCodegen(IRModule* ir);
 int generate(Codegen* codegen);
 void writeToFile(Codegen* codegen, const char* filepath);
 void freeCodegen(Codegen* codegen);
@@ -0,0 +1,218 @@
+#include "elfWriter.h"
+#include "encoder.h"
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+	NULL_SECTION_INDEX,
+	TEXT_SECTION_INDEX,
+	DATA_SECTION_INDEX,
+	SYMTAB_SECTION_INDEX,
+	STRTAB_SECTION_INDEX,
+	RELA_TEXT_SECTION_INDEX,
+	NOTE_STACK_SECTION_INDEX,
+	SHSTRTAB_SECTION_INDEX,
+	SECTION_COUNT
+} SectionIndex;
+
+// names of the sections, each followed by its zero terminator
+static const char sectionNames[] = "\0.text\0.data\0.symtab\0.strtab\0.rela.text\0.note.GNU-stack\0.shstrtab";
+
+static size_t alignOffset(size_t offset, size_t align) {
+	return (offset + align - 1) & ~(align - 1);
+}
+
+static Elf64_Word sectionNameOffset(const char* name) {
+	for (size_t i = 1; i < sizeof(sectionNames); i += strlen(sectionNames + i) + 1) {
+		if (strcmp(sectionNames + i, name) == 0) {
+			return i;
+		}
+	}
+	return 0;
+}
+
+static void sectionHeader(Elf64_Shdr* header, const char* name, Elf64_Word type, Elf64_Xword flags, size_t offset, size_t size, Elf64_Xword align) {
+	header->sh_name = sectionNameOffset(name);
+	header->sh_type = type;
+	header->sh_flags = flags;
+	header->sh_offset = offset;
+	header->sh_size = size;
+	header->sh_addralign = align;
+}
+
+int writeObjectFile(MachineCode* code, const char* filepath) {
+
+	if (code == NULL || filepath == NULL) {
+		return 0;
+	}
+
+	// elf wants the local symbols first, so the symbols get new indices
+	int symbolCount = code->symbolCount + 1;
+	int* elfIndex = malloc(code->symbolCount * sizeof(int));
+	Elf64_Sym* symbols = calloc(symbolCount, sizeof(Elf64_Sym));
+	Elf64_Rela* relocations = calloc(code->relocationCount + 1, sizeof(Elf64_Rela));
+
+	size_t strtabSize = 1;
+	for (int i = 0; i < code->symbolCount; i++) {
+		strtabSize += strlen(code->symbols[i].name) + 1;
+	}
+	char* strtab = calloc(strtabSize, 1);
+
+	if (elfIndex == NULL || symbols == NULL || relocations == NULL || strtab == NULL) {
+		free(elfIndex);
+		free(symbols);
+		free(relocations);
+		free(strtab);
+		return 0;
+	}
+
+	int next = 1;
+	int firstGlobal = 0;
+	size_t strtabIdx = 1;
+
+	for (int pass = 0; pass < 2; pass++) {
+		if (pass == 1) {
+			firstGlobal = next;
+		}
+
+		for (int i = 0; i < code->symbolCount; i++) {
+			CodeSymbol* symbol = &code->symbols[i];
+
+			if (symbol->global != (pass == 1)) {
+				continue;
+			}
+
+			Elf64_Sym* elfSymbol = &symbols[next];
+			elfIndex[i] = next++;
+
+			size_t length = strlen(symbol->name);
+			memcpy(strtab + strtabIdx, symbol->name, length + 1);
+			elfSymbol->st_name = strtabIdx;
+			strtabIdx += length + 1;
+
+			unsigned char type = symbol->function ? STT_FUNC : (symbol->section == DATA_SECTION ? STT_OBJECT : STT_NOTYPE);
+			elfSymbol->st_info = ELF64_ST_INFO(symbol->global ? STB_GLOBAL : STB_LOCAL, type);
+			elfSymbol->st_value = symbol->offset;
+			elfSymbol->st_size = symbol->size;
+
+			switch (symbol->section) {
+				case TEXT_SECTION:
+					elfSymbol->st_shndx = TEXT_SECTION_INDEX;
+					break;
+				case DATA_SECTION:
+					elfSymbol->st_shndx = DATA_SECTION_INDEX;
+					break;
+				default:
+					elfSymbol->st_shndx = SHN_UNDEF;
+					break;
+			}
+		}
+	}
+
+	for (int i = 0; i < code->relocationCount; i++) {
+		Relocation* relocation = &code->relocations[i];
+		Elf64_Word type;
+
+		switch (relocation->kind) {
+			case ABSOLUTE_RELOCATION:
+				type = R_X86_64_64;
+				break;
+			case PC_RELATIVE_RELOCATION:
+				type = R_X86_64_PC32;
+				break;
+			default:
+				type = R_X86_64_PLT32;
+				break;
+		}
+
+		relocations[i].r_offset = relocation->offset;
+		relocations[i].r_info = ELF64_R_INFO(elfIndex[relocation->symbol], type);
+		relocations[i].r_addend = relocation->addend;
+	}
+
+	// file layout: header, section contents, section header table
+	size_t textOffset = alignOffset(sizeof(Elf64_Ehdr), 16);
+	size_t dataOffset = alignOffset(textOffset + code->text.size, 8);
+	size_t symtabOffset = alignOffset(dataOffset + code->data.size, 8);
+	size_t symtabSize = symbolCount * sizeof(Elf64_Sym);
+	size_t strtabOffset = symtabOffset + symtabSize;
+	size_t relaOffset = alignOffset(strtabOffset + strtabSize, 8);
+	size_t relaSize = code->relocationCount * sizeof(Elf64_Rela);
+	size_t shstrtabOffset = relaOffset + relaSize;
+	size_t headersOffset = alignOffset(shstrtabOffset + sizeof(sectionNames), 8);
+	size_t fileSize = headersOffset + SECTION_COUNT * sizeof(Elf64_Shdr);
+
+	unsigned char* file = calloc(fileSize, 1);
+
+	if (file == NULL) {
+		free(elfIndex);
+		free(symbols);
+		free(relocations);
+		free(strtab);
+		return 0;
+	}
+
+	Elf64_Ehdr* header = (Elf64_Ehdr*)file;
+	memcpy(header->e_ident, ELFMAG, SELFMAG);
+	header->e_ident[EI_CLASS] = ELFCLASS64;
+	header->e_ident[EI_DATA] = ELFDATA2LSB;
+	header->e_ident[EI_VERSION] = EV_CURRENT;
+	header->e_ident[EI_OSABI] = ELFOSABI_SYSV;
+	header->e_type = ET_REL;
+	header->e_machine = EM_X86_64;
+	header->e_version = EV_CURRENT;
+	header->e_shoff = headersOffset;
+	header->e_ehsize = sizeof(Elf64_Ehdr);
+	header->e_shentsize = sizeof(Elf64_Shdr);
+	header->e_shnum = SECTION_COUNT;
+	header->e_shstrndx = SHSTRTAB_SECTION_INDEX;
+
+	if (code->text.size > 0) memcpy(file + textOffset, code->text.bytes, code->text.size);
+	if (code->data.size > 0) memcpy(file + dataOffset, code->data.bytes, code->data.size);
+	memcpy(file + symtabOffset, symbols, symtabSize);
+	memcpy(file + strtabOffset, strtab, strtabSize);
+	if (relaSize > 0) memcpy(file + relaOffset, relocations, relaSize);
+	memcpy(file + shstrtabOffset, sectionNames, sizeof(sectionNames));
+
+	Elf64_Shdr* sections = (Elf64_Shdr*)(file + headersOffset);
+	sectionHeader(&sections[TEXT_SECTION_INDEX], ".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, textOffset, code->text.size, 16);
+	sectionHeader(&sections[DATA_SECTION_INDEX], ".data", SHT_PROGBITS, SHF_ALLOC | SHF_WRITE, dataOffset, code->data.size, 8);
+	sectionHeader(&sections[SYMTAB_SECTION_INDEX], ".symtab", SHT_SYMTAB, 0, symtabOffset, symtabSize, 8);
+	sections[SYMTAB_SECTION_INDEX].sh_link = STRTAB_SECTION_INDEX;
+	sections[SYMTAB_SECTION_INDEX].sh_info = firstGlobal;
+	sections[SYMTAB_SECTION_INDEX].sh_entsize = sizeof(Elf64_Sym);
+	sectionHeader(&sections[STRTAB_SECTION_INDEX], ".strtab", SHT_STRTAB, 0, strtabOffset, strtabSize, 1);
+	sectionHeader(&sections[RELA_TEXT_SECTION_INDEX], ".rela.text", SHT_RELA, SHF_INFO_LINK, relaOffset, relaSize, 8);
+	sections[RELA_TEXT_SECTION_INDEX].sh_link = SYMTAB_SECTION_INDEX;
+	sections[RELA_TEXT_SECTION_INDEX].sh_info = TEXT_SECTION_INDEX;
+	sections[RELA_TEXT_SECTION_INDEX].sh_entsize = sizeof(Elf64_Rela);
+	// marks the stack as not executable for the linker
+	sectionHeader(&sections[NOTE_STACK_SECTION_INDEX], ".note.GNU-stack", SHT_PROGBITS, 0, shstrtabOffset, 0, 1);
+	sectionHeader(&sections[SHSTRTAB_SECTION_INDEX], ".shstrtab", SHT_STRTAB, 0, shstrtabOffset, sizeof(sectionNames), 1);
+
+	free(elfIndex);
+	free(symbols);
+	free(relocations);
+	free(strtab);
+
+	FILE* output = fopen(filepath, "wb");
+
+	if (output == NULL) {
+		fprintf(stderr, "Error: Cannot open file %s\n", filepath);
+		free(file);
+		return 0;
+	}
+
+	size_t written = fwrite(file, 1, fileSize, output);
+	fclose(output);
+	free(file);
+
+	if (written != fileSize) {
+		fprintf(stderr, "Error while writing to file %s\n", filepath);
+		return 0;
+	}
+
+	return 1;
+}
@@ -0,0 +1,9 @@
+#ifndef ELFWRITER_H
+#define ELFWRITER_H
+
+#include "encoder.h"
+
+// writes the encoded program as an x86-64 ELF relocatable object, ready for the linker
+int writeObjectFile(MachineCode* code, const char* filepath);
+
+#endif
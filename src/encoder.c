@@ -0,0 +1,662 @@
+#include "encoder.h"
+#include "machineIR.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+// labels are numbered per kind, so kind and number together index the label table
+static const int LABEL_KINDS = RETURN_LABEL + 1;
+
+typedef struct LabelFixup {
+	int offset;
+	int label;
+} LabelFixup;
+
+// state while encoding one function
+typedef struct Encoder {
+	MachineCode* code;
+	int* labelOffsets;
+	int labelCapacity;
+	LabelFixup* fixups;
+	int fixupCount;
+	int fixupCapacity;
+} Encoder;
+
+int encodeFunction(Encoder* encoder, MachineFunction* function);
+int encodeInstruction(Encoder* encoder, MachineInstr* instr);
+
+static int reserveBytes(ByteBuffer* buffer, int size) {
+
+	if (buffer->size + size <= buffer->capacity) {
+		return 1;
+	}
+
+	int capacity = buffer->capacity > 0 ? buffer->capacity * 2 : 1024;
+
+	while (capacity < buffer->size + size) {
+		capacity *= 2;
+	}
+
+	unsigned char* bytes = realloc(buffer->bytes, capacity);
+
+	if (bytes == NULL) {
+		return 0;
+	}
+
+	buffer->bytes = bytes;
+	buffer->capacity = capacity;
+	return 1;
+}
+
+// the longest instruction is 10 bytes, so every instruction reserves its room once up front
+static inline void byte(ByteBuffer* buffer, unsigned char value) {
+	buffer->bytes[buffer->size++] = value;
+}
+
+static inline void int32(ByteBuffer* buffer, int32_t value) {
+	memcpy(buffer->bytes + buffer->size, &value, 4);
+	buffer->size += 4;
+}
+
+static inline void int64(ByteBuffer* buffer, int64_t value) {
+	memcpy(buffer->bytes + buffer->size, &value, 8);
+	buffer->size += 8;
+}
+
+static int addSymbol(MachineCode* code, char* name, SectionKind section, int offset, bool global, bool function) {
+
+	if (code->symbolCount == code->symbolCapacity) {
+		int capacity = code->symbolCapacity * 2;
+		CodeSymbol* symbols = realloc(code->symbols, capacity * sizeof(CodeSymbol));
+
+		if (symbols == NULL) {
+			return -1;
+		}
+
+		code->symbols = symbols;
+		code->symbolCapacity = capacity;
+	}
+
+	if (!insertKeyPair(code->symbolIndex, name, (void*)(intptr_t)(code->symbolCount + 1))) {
+		fprintf(stderr, "Error: Symbol \"%s\" is defined twice\n", name);
+		return -1;
+	}
+
+	CodeSymbol* symbol = &code->symbols[code->symbolCount];
+	symbol->name = name;
+	symbol->section = section;
+	symbol->offset = offset;
+	symbol->size = 0;
+	symbol->global = global;
+	symbol->function = function;
+	return code->symbolCount++;
+}
+
+int findCodeSymbol(MachineCode* code, const char* name) {
+	if (code == NULL || name == NULL) {
+		return -1;
+	}
+	return (int)(intptr_t)getValue(code->symbolIndex, (char*)name) - 1;
+}
+
+// symbols that are only referenced, like printf, are added as undefined
+static int referenceSymbol(MachineCode* code, char* name) {
+	int symbol = findCodeSymbol(code, name);
+
+	if (symbol >= 0) {
+		return symbol;
+	}
+
+	return addSymbol(code, name, UNDEFINED_SECTION, 0, true, false);
+}
+
+static int addRelocation(MachineCode* code, int offset, RelocationKind kind, char* name, long long addend) {
+
+	int symbol = referenceSymbol(code, name);
+
+	if (symbol < 0) {
+		return 0;
+	}
+
+	if (code->relocationCount == code->relocationCapacity) {
+		int capacity = code->relocationCapacity * 2;
+		Relocation* relocations = realloc(code->relocations, capacity * sizeof(Relocation));
+
+		if (relocations == NULL) {
+			return 0;
+		}
+
+		code->relocations = relocations;
+		code->relocationCapacity = capacity;
+	}
+
+	Relocation* relocation = &code->relocations[code->relocationCount++];
+	relocation->offset = offset;
+	relocation->kind = kind;
+	relocation->symbol = symbol;
+	relocation->addend = addend;
+	return 1;
+}
+
+static bool isMemory(Operand* operand) {
+	return operand->kind == FRAME_OPERAND || operand->kind == GLOBAL_OPERAND;
+}
+
+// spl, bpl, sil and dil need a REX prefix, without one their codes mean ah, ch, dh and bh
+static bool needsRex(Operand* operand) {
+	return operand->kind == REGISTER_OPERAND && operand->size == 1 && operand->as.reg >= RSP_REG && operand->as.reg <= RDI_REG;
+}
+
+// writes the optional 0x66 and REX prefixes, the opcode and the ModRM operand rm with reg in its reg field.
+// immediateSize is the number of bytes that still follow, rip relative operands are measured from the end
+static int encodeModRM(Encoder* encoder, int size, const unsigned char* opcode, int opcodeLength, int reg, bool forceRex, Operand* rm, int immediateSize) {
+
+	ByteBuffer* text = &encoder->code->text;
+
+	if (size == 2) {
+		byte(text, 0x66);
+	}
+
+	unsigned char rex = 0x40;
+	if (size == 8) rex |= 0x08;
+	if (reg >= 8) rex |= 0x04;
+	if (rm->kind == REGISTER_OPERAND && rm->as.reg >= 8) rex |= 0x01;
+
+	if (rex != 0x40 || forceRex || needsRex(rm)) {
+		byte(text, rex);
+	}
+
+	for (int i = 0; i < opcodeLength; i++) {
+		byte(text, opcode[i]);
+	}
+
+	switch (rm->kind) {
+		case REGISTER_OPERAND:
+			byte(text, 0xC0 | ((reg & 7) << 3) | (rm->as.reg & 7));
+			return 1;
+		case FRAME_OPERAND: {
+			// rbp as base always needs a displacement, rsp as base a SIB byte
+			bool small = rm->as.offset >= -128 && rm->as.offset <= 127;
+			byte(text, (small ? 0x40 : 0x80) | ((reg & 7) << 3) | (rm->base & 7));
+
+			if ((rm->base & 7) == RSP_REG) {
+				byte(text, 0x24);
+			}
+
+			if (small) {
+				byte(text, (unsigned char)rm->as.offset);
+			}
+			else {
+				int32(text, rm->as.offset);
+			}
+			return 1;
+		}
+		case GLOBAL_OPERAND:
+			// rip relative, so the code does not depend on its load address
+			byte(text, ((reg & 7) << 3) | 0x05);
+			int32(text, 0);
+			return addRelocation(encoder->code, text->size - 4, PC_RELATIVE_RELOCATION, rm->as.symbol, -4 - immediateSize);
+		default:
+			fprintf(stderr, "Error: Unexpected Operand kind %d in encodeModRM\n", rm->kind);
+			return 0;
+	}
+}
+
+// the short register forms like push and mov reg, imm keep the register in the opcode
+static void encodeShortForm(Encoder* encoder, bool wide, unsigned char opcode, Operand* reg) {
+
+	ByteBuffer* text = &encoder->code->text;
+	unsigned char rex = 0x40;
+	if (wide) rex |= 0x08;
+	if (reg->as.reg >= 8) rex |= 0x01;
+
+	if (rex != 0x40 || needsRex(reg)) {
+		byte(text, rex);
+	}
+
+	byte(text, opcode + (reg->as.reg & 7));
+}
+
+static int encodeLabelJump(Encoder* encoder, Operand* label) {
+
+	if (encoder->fixupCount == encoder->fixupCapacity) {
+		int capacity = encoder->fixupCapacity * 2;
+		LabelFixup* fixups = realloc(encoder->fixups, capacity * sizeof(LabelFixup));
+
+		if (fixups == NULL) {
+			return 0;
+		}
+
+		encoder->fixups = fixups;
+		encoder->fixupCapacity = capacity;
+	}
+
+	ByteBuffer* text = &encoder->code->text;
+	encoder->fixups[encoder->fixupCount].offset = text->size;
+	encoder->fixups[encoder->fixupCount].label = label->as.label.number * LABEL_KINDS + label->as.label.kind;
+	encoder->fixupCount++;
+	int32(text, 0);
+	return 1;
+}
+
+// pads with the recommended multi byte nops, so the padding decodes as few instructions
+static void alignText(ByteBuffer* text, int alignment) {
+
+	static const unsigned char nops[9][9] = {
+		{0x90},
+		{0x66, 0x90},
+		{0x0F, 0x1F, 0x00},
+		{0x0F, 0x1F, 0x40, 0x00},
+		{0x0F, 0x1F, 0x44, 0x00, 0x00},
+		{0x66, 0x0F, 0x1F, 0x44, 0x00, 0x00},
+		{0x0F, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00},
+		{0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00},
+		{0x66, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00}
+	};
+
+	int padding = (alignment - text->size % alignment) % alignment;
+
+	while (padding > 0) {
+		int length = padding < 9 ? padding : 9;
+
+		for (int i = 0; i < length; i++) {
+			byte(text, nops[length - 1][i]);
+		}
+		padding -= length;
+	}
+}
+
+static int defineLabel(Encoder* encoder, Operand* label) {
+
+	int idx = label->as.label.number * LABEL_KINDS + label->as.label.kind;
+
+	if (idx >= encoder->labelCapacity) {
+		int capacity = encoder->labelCapacity * 2;
+
+		while (capacity <= idx) {
+			capacity *= 2;
+		}
+
+		int* offsets = realloc(encoder->labelOffsets, capacity * sizeof(int));
+
+		if (offsets == NULL) {
+			return 0;
+		}
+
+		for (int i = encoder->labelCapacity; i < capacity; i++) {
+			offsets[i] = -1;
+		}
+
+		encoder->labelOffsets = offsets;
+		encoder->labelCapacity = capacity;
+	}
+
+	encoder->labelOffsets[idx] = encoder->code->text.size;
+	return 1;
+}
+
+static unsigned char conditionCode(Condition condition) {
+	switch (condition) {
+		case LESS_COND: return 0x0C;
+		case LESS_EQUAL_COND: return 0x0E;
+		case GREATER_COND: return 0x0F;
+		case GREATER_EQUAL_COND: return 0x0D;
+		case EQUAL_COND:
+		case ZERO_COND: return 0x04;
+		case NOT_EQUAL_COND:
+		case NOT_ZERO_COND: return 0x05;
+		default: return 0xFF;
+	}
+}
+
+// add, sub and cmp share their encodings: op r/m, reg and the immediate group 0x81 /digit
+static int encodeArithmetic(Encoder* encoder, MachineInstr* instr, unsigned char opcode, int digit) {
+
+	Operand* dst = &instr->dst;
+	Operand* src = &instr->src;
+	ByteBuffer* text = &encoder->code->text;
+
+	if (src->kind == REGISTER_OPERAND) {
+		unsigned char op = dst->size == 1 ? opcode - 1 : opcode;
+		return encodeModRM(encoder, dst->size, &op, 1, src->as.reg, needsRex(src), dst, 0);
+	}
+
+	if (src->kind == IMMEDIATE_OPERAND) {
+		if (dst->size == 1) {
+			unsigned char op = 0x80;
+			if (!encodeModRM(encoder, 1, &op, 1, digit, false, dst, 1)) return 0;
+			byte(text, (unsigned char)src->as.immediate);
+			return 1;
+		}
+		if (src->as.immediate >= -128 && src->as.immediate <= 127) {
+			unsigned char op = 0x83;
+			if (!encodeModRM(encoder, dst->size, &op, 1, digit, false, dst, 1)) return 0;
+			byte(text, (unsigned char)src->as.immediate);
+			return 1;
+		}
+		unsigned char op = 0x81;
+		if (!encodeModRM(encoder, dst->size, &op, 1, digit, false, dst, 4)) return 0;
+		int32(text, (int32_t)src->as.immediate);
+		return 1;
+	}
+
+	if (isMemory(src) && dst->kind == REGISTER_OPERAND) {
+		unsigned char op = dst->size == 1 ? opcode + 1 : opcode + 2;
+		return encodeModRM(encoder, dst->size, &op, 1, dst->as.reg, needsRex(dst), src, 0);
+	}
+
+	fprintf(stderr, "Error: Unsupported Operands for arithmetic Instruction %d\n", instr->opcode);
+	return 0;
+}
+
+static int encodeMove(Encoder* encoder, MachineInstr* instr) {
+
+	Operand* dst = &instr->dst;
+	Operand* src = &instr->src;
+	ByteBuffer* text = &encoder->code->text;
+
+	if (src->kind == REGISTER_OPERAND) {
+		unsigned char op = src->size == 1 ? 0x88 : 0x89;
+		return encodeModRM(encoder, src->size, &op, 1, src->as.reg, needsRex(src), dst, 0);
+	}
+
+	if (isMemory(dst) && src->kind == IMMEDIATE_OPERAND && dst->size != 2) {
+		// the 8 byte store sign extends a 32 bit immediate
+		unsigned char op = dst->size == 1 ? 0xC6 : 0xC7;
+		int immediateSize = dst->size == 1 ? 1 : 4;
+		if (!encodeModRM(encoder, dst->size, &op, 1, 0, false, dst, immediateSize)) return 0;
+		if (immediateSize == 1) {
+			byte(text, (unsigned char)src->as.immediate);
+		}
+		else {
+			int32(text, (int32_t)src->as.immediate);
+		}
+		return 1;
+	}
+
+	if (dst->kind != REGISTER_OPERAND) {
+		fprintf(stderr, "Error: Unsupported Operands for mov\n");
+		return 0;
+	}
+
+	if (isMemory(src)) {
+		unsigned char op = dst->size == 1 ? 0x8A : 0x8B;
+		return encodeModRM(encoder, dst->size, &op, 1, dst->as.reg, needsRex(dst), src, 0);
+	}
+
+	if (src->kind == SYMBOL_OPERAND) {
+		encodeShortForm(encoder, true, 0xB8, dst);
+		int64(text, 0);
+		return addRelocation(encoder->code, text->size - 8, ABSOLUTE_RELOCATION, src->as.symbol, 0);
+	}
+
+	if (src->kind != IMMEDIATE_OPERAND) {
+		fprintf(stderr, "Error: Unsupported Operands for mov\n");
+		return 0;
+	}
+
+	long long value = src->as.immediate;
+
+	switch (dst->size) {
+		case 1:
+			encodeShortForm(encoder, false, 0xB0, dst);
+			byte(text, (unsigned char)value);
+			return 1;
+		case 4:
+			encodeShortForm(encoder, false, 0xB8, dst);
+			int32(text, (int32_t)value);
+			return 1;
+		case 8:
+			// writing the 32 bit register clears the upper half, which is shorter for small constants
+			if (value >= 0 && value <= UINT32_MAX) {
+				encodeShortForm(encoder, false, 0xB8, dst);
+				int32(text, (int32_t)value);
+			}
+			else if (value >= INT32_MIN && value <= INT32_MAX) {
+				unsigned char op = 0xC7;
+				if (!encodeModRM(encoder, 8, &op, 1, 0, false, dst, 4)) return 0;
+				int32(text, (int32_t)value);
+			}
+			else {
+				encodeShortForm(encoder, true, 0xB8, dst);
+				int64(text, value);
+			}
+			return 1;
+		default:
+			fprintf(stderr, "Error: Unsupported immediate size %d for mov\n", dst->size);
+			return 0;
+	}
+}
+
+int encodeInstruction(Encoder* encoder, MachineInstr* instr) {
+
+	ByteBuffer* text = &encoder->code->text;
+	Operand* dst = &instr->dst;
+	Operand* src = &instr->src;
+
+	if (!reserveBytes(text, 16)) {
+		return 0;
+	}
+
+	switch (instr->opcode) {
+		case MOV_INSTR:
+			return encodeMove(encoder, instr);
+		case MOVZX_INSTR: {
+			unsigned char op[2] = {0x0F, src->size == 1 ? 0xB6 : 0xB7};
+			return encodeModRM(encoder, dst->size, op, 2, dst->as.reg, needsRex(src), src, 0);
+		}
+		case ADD_INSTR:
+			return encodeArithmetic(encoder, instr, 0x01, 0);
+		case SUB_INSTR:
+			return encodeArithmetic(encoder, instr, 0x29, 5);
+		case CMP_INSTR:
+			return encodeArithmetic(encoder, instr, 0x39, 7);
+		case IMUL_INSTR: {
+			unsigned char op[2] = {0x0F, 0xAF};
+			return encodeModRM(encoder, dst->size, op, 2, dst->as.reg, false, src, 0);
+		}
+		case TEST_INSTR: {
+			unsigned char op = dst->size == 1 ? 0x84 : 0x85;
+			return encodeModRM(encoder, dst->size, &op, 1, src->as.reg, needsRex(src), dst, 0);
+		}
+		case IDIV_INSTR: {
+			unsigned char op = dst->size == 1 ? 0xF6 : 0xF7;
+			return encodeModRM(encoder, dst->size, &op, 1, 7, false, dst, 0);
+		}
+		case CDQ_INSTR:
+			byte(text, 0x99);
+			return 1;
+		case NEG_INSTR: {
+			unsigned char op = dst->size == 1 ? 0xF6 : 0xF7;
+			return encodeModRM(encoder, dst->size, &op, 1, 3, false, dst, 0);
+		}
+		case SETCC_INSTR: {
+			unsigned char op[2] = {0x0F, 0x90 | conditionCode(instr->condition)};
+			return encodeModRM(encoder, 1, op, 2, 0, false, dst, 0);
+		}
+		case JMP_INSTR:
+			byte(text, 0xE9);
+
+			// a tail call, which is reached like a call
+			if (dst->kind == SYMBOL_OPERAND) {
+				int32(text, 0);
+				return addRelocation(encoder->code, text->size - 4, CALL_RELOCATION, dst->as.symbol, -4);
+			}
+			return encodeLabelJump(encoder, dst);
+		case JCC_INSTR:
+			byte(text, 0x0F);
+			byte(text, 0x80 | conditionCode(instr->condition));
+			return encodeLabelJump(encoder, dst);
+		case CALL_INSTR:
+			byte(text, 0xE8);
+			int32(text, 0);
+			return addRelocation(encoder->code, text->size - 4, CALL_RELOCATION, dst->as.symbol, -4);
+		case PUSH_INSTR:
+			encodeShortForm(encoder, false, 0x50, dst);
+			return 1;
+		case POP_INSTR:
+			encodeShortForm(encoder, false, 0x58, dst);
+			return 1;
+		case LEAVE_INSTR:
+			byte(text, 0xC9);
+			return 1;
+		case RET_INSTR:
+			byte(text, 0xC3);
+			return 1;
+		case LABEL_INSTR:
+			// at most 15 bytes of padding, which the reserved bytes cover
+			if (src->kind == IMMEDIATE_OPERAND && src->as.immediate > 1 && src->as.immediate <= 16) {
+				alignText(text, src->as.immediate);
+			}
+			return defineLabel(encoder, dst);
+		default:
+			fprintf(stderr, "Error: Cannot encode Instruction %d\n", instr->opcode);
+			return 0;
+	}
+}
+
+int encodeFunction(Encoder* encoder, MachineFunction* function) {
+
+	MachineCode* code = encoder->code;
+	int symbol = addSymbol(code, function->id, TEXT_SECTION, code->text.size, true, true);
+
+	if (symbol < 0) {
+		return 0;
+	}
+
+	encoder->fixupCount = 0;
+	for (int i = 0; i < encoder->labelCapacity; i++) {
+		encoder->labelOffsets[i] = -1;
+	}
+
+	for (int i = 0; i < function->size; i++) {
+		if (!encodeInstruction(encoder, &function->code[i])) {
+			return 0;
+		}
+	}
+
+	// jumps were encoded with a zero distance until their label was known
+	for (int i = 0; i < encoder->fixupCount; i++) {
+		LabelFixup* fixup = &encoder->fixups[i];
+		int target = fixup->label < encoder->labelCapacity ? encoder->labelOffsets[fixup->label] : -1;
+
+		if (target < 0) {
+			fprintf(stderr, "Error: Jump to undefined Label in Function \"%s\"\n", function->id);
+			return 0;
+		}
+
+		int32_t distance = target - (fixup->offset + 4);
+		memcpy(code->text.bytes + fixup->offset, &distance, 4);
+	}
+
+	code->symbols[symbol].size = code->text.size - code->symbols[symbol].offset;
+	return 1;
+}
+
+static int addData(MachineCode* code, char* name, const void* value, int size, int align, bool global) {
+
+	ByteBuffer* data = &code->data;
+
+	if (!reserveBytes(data, size + align)) {
+		return 0;
+	}
+
+	while (data->size % align != 0) {
+		byte(data, 0);
+	}
+
+	if (addSymbol(code, name, DATA_SECTION, data->size, global, false) < 0) {
+		return 0;
+	}
+
+	memcpy(data->bytes + data->size, value, size);
+	data->size += size;
+	return 1;
+}
+
+// calls into the text section itself need no relocation in the output
+static void resolveLocalCalls(MachineCode* code) {
+
+	int kept = 0;
+
+	for (int i = 0; i < code->relocationCount; i++) {
+		Relocation* relocation = &code->relocations[i];
+		CodeSymbol* symbol = &code->symbols[relocation->symbol];
+
+		if (relocation->kind == CALL_RELOCATION && symbol->section == TEXT_SECTION) {
+			int32_t distance = (int32_t)(symbol->offset + relocation->addend - relocation->offset);
+			memcpy(code->text.bytes + relocation->offset, &distance, 4);
+			continue;
+		}
+
+		code->relocations[kept++] = *relocation;
+	}
+
+	code->relocationCount = kept;
+}
+
+MachineCode* encodeModule(MachineModule* module) {
+
+	if (module == NULL) {
+		return NULL;
+	}
+
+	MachineCode* code = calloc(1, sizeof(MachineCode));
+
+	if (code == NULL) {
+		return NULL;
+	}
+
+	code->symbolCapacity = 16;
+	code->symbols = malloc(code->symbolCapacity * sizeof(CodeSymbol));
+	code->relocationCapacity = 16;
+	code->relocations = malloc(code->relocationCapacity * sizeof(Relocation));
+	code->symbolIndex = hashTable(module->functions->size + module->globals->size + 2, NULL);
+
+	Encoder encoder = {0};
+	encoder.code = code;
+	encoder.labelCapacity = 64;
+	encoder.labelOffsets = malloc(encoder.labelCapacity * sizeof(int));
+	encoder.fixupCapacity = 64;
+	encoder.fixups = malloc(encoder.fixupCapacity * sizeof(LabelFixup));
+
+	int success = code->symbols != NULL && code->relocations != NULL && code->symbolIndex != NULL
+		&& encoder.labelOffsets != NULL && encoder.fixups != NULL;
+
+	// the format string main prints its result with
+	static const char message[] = "Result was: %d\n";
+	success = success && addData(code, "message", message, sizeof(message), 1, false);
+
+	for (int i = 0; success && i < module->globals->size; i++) {
+		MachineGlobal* global = (MachineGlobal*)module->globals->array[i];
+		int64_t value = global->value;
+		success = addData(code, global->id, &value, global->size, global->size, true);
+	}
+
+	for (int i = 0; success && i < module->functions->size; i++) {
+		success = encodeFunction(&encoder, (MachineFunction*)module->functions->array[i]);
+	}
+
+	free(encoder.labelOffsets);
+	free(encoder.fixups);
+
+	if (!success) {
+		freeMachineCode(code);
+		return NULL;
+	}
+
+	resolveLocalCalls(code);
+	return code;
+}
+
+void freeMachineCode(MachineCode* code) {
+	if (code == NULL) return;
+	free(code->text.bytes);
+	free(code->data.bytes);
+	free(code->symbols);
+	free(code->relocations);
+	freeTable(code->symbolIndex);
+	free(code);
+}
@@ -0,0 +1,69 @@
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include "machineIR.h"
+#include "utils.h"
+#include <stdbool.h>
+
+typedef struct ByteBuffer ByteBuffer;
+typedef struct CodeSymbol CodeSymbol;
+typedef struct Relocation Relocation;
+typedef struct MachineCode MachineCode;
+
+typedef enum {
+	UNDEFINED_SECTION,
+	TEXT_SECTION,
+	DATA_SECTION
+} SectionKind;
+
+typedef enum {
+	// 64 bit address of the symbol
+	ABSOLUTE_RELOCATION,
+	// 32 bit distance from the field to the symbol
+	PC_RELATIVE_RELOCATION,
+	// like PC_RELATIVE_RELOCATION, but external functions may be reached through the PLT
+	CALL_RELOCATION
+} RelocationKind;
+
+struct ByteBuffer {
+	unsigned char* bytes;
+	int size;
+	int capacity;
+};
+
+struct CodeSymbol {
+	char* name;
+	SectionKind section;
+	int offset;
+	int size;
+	bool global;
+	bool function;
+};
+
+// the value of the symbol plus addend goes to offset in the text section
+struct Relocation {
+	int offset;
+	RelocationKind kind;
+	int symbol;
+	long long addend;
+};
+
+// the encoded program, calls between its own functions are already resolved
+struct MachineCode {
+	ByteBuffer text;
+	ByteBuffer data;
+	CodeSymbol* symbols;
+	int symbolCount;
+	int symbolCapacity;
+	Relocation* relocations;
+	int relocationCount;
+	int relocationCapacity;
+	// symbol name to its index + 1
+	HashTable* symbolIndex;
+};
+
+MachineCode* encodeModule(MachineModule* module);
+int findCodeSymbol(MachineCode* code, const char* name);
+void freeMachineCode(MachineCode* code);
+
+#endif
@@ -0,0 +1,437 @@
+#include "inliner.h"
+#include "ir.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct Inliner {
+	IRModule* module;
+	PassManager* manager;
+	// function id to its index in the module + 1
+	HashTable* indices;
+	// tarjan's state by function index, the order is -1 until the function is visited
+	int* order;
+	int* lowLink;
+	bool* onStack;
+	int* stack;
+	int stackSize;
+	int nextOrder;
+	// part of a cycle in the call graph, or calls itself
+	bool* recursive;
+	// of the final function, set once its own calls are inlined
+	int* costs;
+	bool failed;
+} Inliner;
+
+// roughly the instructions left once the body is copied into a caller, constants and params
+// are free and returns turn into jumps that mostly fall through
+static int inlineCost(IRFunction* function) {
+
+	int cost = 0;
+
+	for (int i = 0; i < function->blocks->size; i++) {
+		IRBlock* block = function->blocks->array[i];
+
+		for (IRInstr* instr = block->first; instr != NULL; instr = instr->next) {
+			switch (instr->opcode) {
+				case CONST_IR:
+				case PARAM_IR:
+				case JUMP_IR:
+				case RETURN_IR:
+					break;
+				default:
+					cost++;
+					break;
+			}
+		}
+	}
+
+	return cost;
+}
+
+static int calleeIndex(Inliner* inliner, IRInstr* call) {
+	return (int)(long)getValue(inliner->indices, call->as.symbol) - 1;
+}
+
+static bool hasReturn(IRFunction* function) {
+	for (int i = 0; i < function->blocks->size; i++) {
+		IRBlock* block = function->blocks->array[i];
+
+		if (block->last != NULL && block->last->opcode == RETURN_IR) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// the callee to copy into the call, NULL if the call stays
+static IRFunction* inlinedCallee(Inliner* inliner, IRFunction* caller, IRInstr* call) {
+
+	int index = calleeIndex(inliner, call);
+
+	if (index < 0) {
+		return NULL;
+	}
+
+	IRFunction* callee = inliner->module->functions->array[index];
+	IRBlock* entry = callee->blocks->array[0];
+	int cost = inliner->costs[index];
+	int threshold = inliner->manager->inlineThreshold;
+	const char* reason = NULL;
+
+	if (inliner->recursive[index]) {
+		reason = "recursive";
+	}
+	else if (callee->paramCount != call->operandCount) {
+		reason = "argument count differs";
+	}
+	// the call jumps to the copied entry, which must not be the target of a loop
+	else if (entry->predCount > 0) {
+		reason = "entry is a loop header";
+	}
+	else if (!hasReturn(callee)) {
+		reason = "never returns";
+	}
+	else if (cost > threshold) {
+		reason = "too large";
+	}
+
+	if (inliner->manager->inlineReport) {
+		if (reason == NULL) {
+			printf("Inlined %s into %s, cost %d\n", callee->id, caller->id, cost);
+		}
+		else if (cost > threshold && !inliner->recursive[index]) {
+			printf("Kept call of %s in %s, cost %d over the threshold %d\n", callee->id, caller->id, cost, threshold);
+		}
+		else {
+			printf("Kept call of %s in %s, %s\n", callee->id, caller->id, reason);
+		}
+	}
+
+	return reason == NULL ? callee : NULL;
+}
+
+// replaces the call with a copy of the callee, the code after the call moves to a new block that
+// the returns jump to. the new blocks are pushed to the layout, the last one is the returned block
+// holding the rest of the call's block
+static IRBlock* inlineCall(IRFunction* caller, IRInstr* call, IRFunction* callee, DynamicArray* layout) {
+
+	IRBlock* block = call->block;
+	IRBlock* rest = irBlock(caller);
+	IRBlock** blocks = calloc(callee->blockCount, sizeof(IRBlock*));
+	IRInstr** values = calloc(callee->valueCount, sizeof(IRInstr*));
+	// by predecessor of the rest
+	IRInstr** returned = calloc(callee->blockCount, sizeof(IRInstr*));
+
+	if (rest == NULL || blocks == NULL || values == NULL || returned == NULL) {
+		free(blocks);
+		free(values);
+		free(returned);
+		return NULL;
+	}
+
+	IRInstr* instr = call->next;
+
+	while (instr != NULL) {
+		IRInstr* next = instr->next;
+		removeIR(instr);
+		appendIR(rest, instr);
+		instr = next;
+	}
+
+	// the successors keep the position of the edge, so their phis stay as they are
+	for (int i = 0; i < successorCount(rest); i++) {
+		IRBlock* target = successor(rest, i);
+
+		for (int j = 0; j < target->predCount; j++) {
+			if (target->preds[j] == block) {
+				target->preds[j] = rest;
+			}
+		}
+	}
+
+	bool failed = false;
+
+	// creates every copy first, operands may refer to values of blocks later in the layout
+	for (int i = 0; i < callee->blocks->size && !failed; i++) {
+		IRBlock* original = callee->blocks->array[i];
+		IRBlock* copy = irBlock(caller);
+
+		if (copy == NULL || !pushItem(layout, copy)) {
+			failed = true;
+			break;
+		}
+
+		blocks[original->id] = copy;
+
+		for (instr = original->first; instr != NULL; instr = instr->next) {
+			if (instr->opcode == PARAM_IR) {
+				values[instr->id] = call->operands[instr->as.param];
+				continue;
+			}
+
+			bool isReturn = instr->opcode == RETURN_IR;
+			IRInstr* clone = isReturn ? irInstr(caller, JUMP_IR, UNKNOWN, 0) : irInstr(caller, instr->opcode, instr->type, instr->operandCount);
+
+			if (clone == NULL) {
+				failed = true;
+				break;
+			}
+
+			clone->as = instr->as;
+			values[instr->id] = clone;
+			appendIR(copy, clone);
+		}
+	}
+
+	for (int i = 0; i < callee->blocks->size && !failed; i++) {
+		IRBlock* original = callee->blocks->array[i];
+		IRBlock* copy = blocks[original->id];
+
+		// the copied phis already have all their operands, so adding the edges leaves them alone
+		for (int j = 0; j < original->predCount; j++) {
+			if (!addPredecessor(caller, copy, blocks[original->preds[j]->id])) {
+				failed = true;
+			}
+		}
+
+		for (instr = original->first; instr != NULL && !failed; instr = instr->next) {
+			if (instr->opcode == PARAM_IR) {
+				continue;
+			}
+
+			IRInstr* clone = values[instr->id];
+
+			if (instr->opcode == RETURN_IR) {
+				returned[rest->predCount] = instr->operandCount > 0 ? values[instr->operands[0]->id] : NULL;
+				clone->targets[0] = rest;
+				failed = !addPredecessor(caller, rest, copy);
+				continue;
+			}
+
+			for (int j = 0; j < instr->operandCount; j++) {
+				clone->operands[j] = values[instr->operands[j]->id];
+			}
+
+			for (int j = 0; j < 2; j++) {
+				clone->targets[j] = instr->targets[j] != NULL ? blocks[instr->targets[j]->id] : NULL;
+			}
+		}
+	}
+
+	IRInstr* result = NULL;
+
+	if (!failed && call->type != UNKNOWN) {
+		if (rest->predCount == 1) {
+			result = returned[0];
+		}
+		else {
+			result = irInstr(caller, PHI_IR, call->type, rest->predCount);
+
+			if (result != NULL) {
+				memcpy(result->operands, returned, rest->predCount * sizeof(IRInstr*));
+				prependIR(rest, result);
+			}
+		}
+
+		failed = result == NULL;
+	}
+
+	IRBlock* entry = blocks[((IRBlock*)callee->blocks->array[0])->id];
+	IRInstr* jump = !failed ? irInstr(caller, JUMP_IR, UNKNOWN, 0) : NULL;
+	free(blocks);
+	free(values);
+	free(returned);
+
+	if (jump == NULL || !addPredecessor(caller, entry, block) || !pushItem(layout, rest)) {
+		return NULL;
+	}
+
+	// the uses of the call are redirected once the whole caller is done
+	removeIR(call);
+	call->replacement = result;
+	jump->targets[0] = entry;
+	appendIR(block, jump);
+	return rest;
+}
+
+// inlines the calls of the function, its callees are final by now
+static int inlineCalls(Inliner* inliner, int index) {
+
+	IRFunction* function = inliner->module->functions->array[index];
+	DynamicArray* blocks = function->blocks;
+	// only built once something is inlined
+	DynamicArray* layout = NULL;
+
+	for (int i = 0; i < blocks->size; i++) {
+		IRBlock* block = blocks->array[i];
+
+		if (layout != NULL && !pushItem(layout, block)) {
+			return 0;
+		}
+
+		IRInstr* instr = block->first;
+
+		while (instr != NULL) {
+			IRInstr* next = instr->next;
+			IRFunction* callee = instr->opcode == CALL_IR ? inlinedCallee(inliner, function, instr) : NULL;
+
+			if (callee != NULL) {
+				if (layout == NULL) {
+					layout = arenaDynamicArray(inliner->module->arena, 2);
+
+					for (int j = 0; layout != NULL && j <= i; j++) {
+						if (!pushItem(layout, blocks->array[j])) {
+							return 0;
+						}
+					}
+
+					if (layout == NULL) {
+						return 0;
+					}
+				}
+
+				// continues with the code after the call, which may hold more calls
+				block = inlineCall(function, instr, callee, layout);
+
+				if (block == NULL) {
+					return 0;
+				}
+
+				next = block->first;
+			}
+
+			instr = next;
+		}
+	}
+
+	if (layout != NULL) {
+		function->blocks = layout;
+		applyReplacements(function);
+	}
+
+	inliner->costs[index] = inlineCost(function);
+	return 1;
+}
+
+// tarjan's algorithm, which finishes the strongly connected components of the call graph callees
+// first. so every function is handled right when its component is complete
+static void visitFunction(Inliner* inliner, int index) {
+
+	IRFunction* function = inliner->module->functions->array[index];
+	inliner->order[index] = inliner->nextOrder;
+	inliner->lowLink[index] = inliner->nextOrder;
+	inliner->nextOrder++;
+	inliner->stack[inliner->stackSize++] = index;
+	inliner->onStack[index] = true;
+
+	for (int i = 0; i < function->blocks->size && !inliner->failed; i++) {
+		IRBlock* block = function->blocks->array[i];
+
+		for (IRInstr* instr = block->first; instr != NULL; instr = instr->next) {
+			int callee = instr->opcode == CALL_IR ? calleeIndex(inliner, instr) : -1;
+
+			if (callee < 0) {
+				continue;
+			}
+
+			if (callee == index) {
+				inliner->recursive[index] = true;
+			}
+
+			if (inliner->order[callee] < 0) {
+				visitFunction(inliner, callee);
+
+				if (inliner->lowLink[callee] < inliner->lowLink[index]) {
+					inliner->lowLink[index] = inliner->lowLink[callee];
+				}
+			}
+			else if (inliner->onStack[callee] && inliner->order[callee] < inliner->lowLink[index]) {
+				inliner->lowLink[index] = inliner->order[callee];
+			}
+		}
+	}
+
+	if (inliner->failed || inliner->lowLink[index] != inliner->order[index]) {
+		return;
+	}
+
+	int start = inliner->stackSize;
+
+	while (inliner->stack[--start] != index);
+
+	for (int i = start; i < inliner->stackSize; i++) {
+		int member = inliner->stack[i];
+		inliner->onStack[member] = false;
+
+		if (inliner->stackSize - start > 1) {
+			inliner->recursive[member] = true;
+		}
+	}
+
+	for (int i = start; i < inliner->stackSize && !inliner->failed; i++) {
+		inliner->failed = !inlineCalls(inliner, inliner->stack[i]);
+	}
+
+	inliner->stackSize = start;
+}
+
+static void freeInliner(Inliner* inliner) {
+	freeTable(inliner->indices);
+	free(inliner->order);
+	free(inliner->lowLink);
+	free(inliner->onStack);
+	free(inliner->stack);
+	free(inliner->recursive);
+	free(inliner->costs);
+}
+
+int inlineFunctions(IRModule* module, PassManager* manager) {
+
+	if (module == NULL || manager == NULL) {
+		return 0;
+	}
+
+	if (manager->inlineThreshold <= 0) {
+		return 1;
+	}
+
+	int count = module->functions->size;
+	Inliner inliner = {0};
+	inliner.module = module;
+	inliner.manager = manager;
+	inliner.indices = symbolTable(count > 0 ? count : 1, NULL);
+	inliner.order = malloc(count * sizeof(int));
+	inliner.lowLink = malloc(count * sizeof(int));
+	inliner.onStack = calloc(count, sizeof(bool));
+	inliner.stack = malloc(count * sizeof(int));
+	inliner.recursive = calloc(count, sizeof(bool));
+	inliner.costs = calloc(count, sizeof(int));
+
+	if (inliner.indices == NULL || inliner.order == NULL || inliner.lowLink == NULL || inliner.onStack == NULL
+			|| inliner.stack == NULL || inliner.recursive == NULL || inliner.costs == NULL) {
+		freeInliner(&inliner);
+		return 0;
+	}
+
+	for (int i = 0; i < count; i++) {
+		IRFunction* function = module->functions->array[i];
+		inliner.order[i] = -1;
+
+		if (!insertKeyPair(inliner.indices, function->id, (void*)(long)(i + 1))) {
+			freeInliner(&inliner);
+			return 0;
+		}
+	}
+
+	for (int i = 0; i < count && !inliner.failed; i++) {
+		if (inliner.order[i] < 0) {
+			visitFunction(&inliner, i);
+		}
+	}
+
+	bool failed = inliner.failed;
+	freeInliner(&inliner);
+	return !failed;
+}
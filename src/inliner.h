@@ -0,0 +1,16 @@
+#ifndef INLINER_H
+#define INLINER_H
+
+#include "ir.h"
+#include "passManager.h"
+
+// callees up to this cost are inlined unless --inline-threshold says otherwise
+#define DEFAULT_INLINE_THRESHOLD 20
+// -O2 trades code size for fewer calls
+#define O2_INLINE_THRESHOLD 50
+
+// copies the bodies of small non-recursive functions into their callers, callees first so they
+// are already final when they are copied. returns 0 on failure and reports the error itself
+int inlineFunctions(IRModule* module, PassManager* manager);
+
+#endif
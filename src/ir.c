@@ -0,0 +1,741 @@
+#include "ir.h"
+#include "parser.h"
+#include "utils.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+IRModule* irModule() {
+
+	IRModule* module = calloc(1, sizeof(IRModule));
+
+	if (module == NULL) {
+		return NULL;
+	}
+
+	module->arena = arena(ARENA_CHUNK_SIZE);
+	module->globals = arenaDynamicArray(module->arena, 2);
+	module->functions = arenaDynamicArray(module->arena, 2);
+
+	if (module->arena == NULL || module->globals == NULL || module->functions == NULL) {
+		freeIRModule(module);
+		return NULL;
+	}
+
+	return module;
+}
+
+IRFunction* irFunction(IRModule* module, char* id, ValueType returnType, int paramCount) {
+
+	if (module == NULL || id == NULL) {
+		return NULL;
+	}
+
+	IRFunction* function = arenaAlloc(module->arena, sizeof(IRFunction));
+
+	if (function == NULL) {
+		return NULL;
+	}
+
+	function->id = id;
+	function->returnType = returnType;
+	function->paramCount = paramCount;
+	function->module = module;
+	function->blocks = arenaDynamicArray(module->arena, 2);
+
+	if (function->blocks == NULL || !pushItem(module->functions, function)) {
+		return NULL;
+	}
+
+	return function;
+}
+
+IRGlobal* irGlobal(IRModule* module, char* id, ValueType type, long long value) {
+
+	if (module == NULL || id == NULL) {
+		return NULL;
+	}
+
+	IRGlobal* global = arenaAlloc(module->arena, sizeof(IRGlobal));
+
+	if (global == NULL) {
+		return NULL;
+	}
+
+	global->id = id;
+	global->type = type;
+	global->value = value;
+
+	if (!pushItem(module->globals, global)) {
+		return NULL;
+	}
+
+	return global;
+}
+
+// a new block is not part of the layout until it is placed
+IRBlock* irBlock(IRFunction* function) {
+
+	IRBlock* block = arenaAlloc(function->module->arena, sizeof(IRBlock));
+
+	if (block == NULL) {
+		return NULL;
+	}
+
+	block->id = function->blockCount++;
+	return block;
+}
+
+int placeBlock(IRFunction* function, IRBlock* block) {
+	return pushItem(function->blocks, block);
+}
+
+void removeBlock(IRFunction* function, IRBlock* block) {
+
+	DynamicArray* blocks = function->blocks;
+
+	for (int i = 0; i < blocks->size; i++) {
+		if (blocks->array[i] == block) {
+			memmove(blocks->array + i, blocks->array + i + 1, (blocks->size - i - 1) * sizeof(void*));
+			blocks->size--;
+			return;
+		}
+	}
+}
+
+IRInstr* irInstr(IRFunction* function, IROpcode opcode, ValueType type, int operandCount) {
+
+	Arena* arena = function->module->arena;
+	IRInstr* instr = arenaAlloc(arena, sizeof(IRInstr));
+
+	if (instr == NULL) {
+		return NULL;
+	}
+
+	if (operandCount > 0) {
+		instr->operands = arenaAlloc(arena, operandCount * sizeof(IRInstr*));
+
+		if (instr->operands == NULL) {
+			return NULL;
+		}
+	}
+
+	instr->opcode = opcode;
+	instr->type = type;
+	instr->id = function->valueCount++;
+	instr->operandCount = operandCount;
+	return instr;
+}
+
+IRInstr* irConstant(IRFunction* function, ValueType type, long long value) {
+
+	IRInstr* constant = irInstr(function, CONST_IR, type, 0);
+
+	if (constant != NULL) {
+		constant->as.constant = truncateConstant(type, value);
+	}
+
+	return constant;
+}
+
+void appendIR(IRBlock* block, IRInstr* instr) {
+	instr->block = block;
+	instr->prev = block->last;
+	instr->next = NULL;
+
+	if (block->last != NULL) {
+		block->last->next = instr;
+	}
+	else {
+		block->first = instr;
+	}
+
+	block->last = instr;
+}
+
+void prependIR(IRBlock* block, IRInstr* instr) {
+	if (block->first == NULL) {
+		appendIR(block, instr);
+		return;
+	}
+	insertIRBefore(block->first, instr);
+}
+
+void insertIRBefore(IRInstr* before, IRInstr* instr) {
+
+	IRBlock* block = before->block;
+	instr->block = block;
+	instr->prev = before->prev;
+	instr->next = before;
+
+	if (before->prev != NULL) {
+		before->prev->next = instr;
+	}
+	else {
+		block->first = instr;
+	}
+
+	before->prev = instr;
+}
+
+// the instruction stays allocated, only its block forgets it
+void removeIR(IRInstr* instr) {
+
+	IRBlock* block = instr->block;
+
+	if (block == NULL) {
+		return;
+	}
+
+	if (instr->prev != NULL) {
+		instr->prev->next = instr->next;
+	}
+	else {
+		block->first = instr->next;
+	}
+
+	if (instr->next != NULL) {
+		instr->next->prev = instr->prev;
+	}
+	else {
+		block->last = instr->prev;
+	}
+
+	instr->block = NULL;
+	instr->prev = NULL;
+	instr->next = NULL;
+}
+
+// phis that already have an operand per predecessor get a NULL one for the new edge, the caller fills it in
+int addPredecessor(IRFunction* function, IRBlock* block, IRBlock* pred) {
+
+	Arena* arena = function->module->arena;
+
+	if (block->predCount == block->predCapacity) {
+		int capacity = block->predCapacity == 0 ? 2 : block->predCapacity * 2;
+		IRBlock** preds = arenaAlloc(arena, capacity * sizeof(IRBlock*));
+
+		if (preds == NULL) {
+			return 0;
+		}
+
+		if (block->predCount > 0) {
+			memcpy(preds, block->preds, block->predCount * sizeof(IRBlock*));
+		}
+
+		block->preds = preds;
+		block->predCapacity = capacity;
+	}
+
+	for (IRInstr* phi = block->first; phi != NULL && phi->opcode == PHI_IR; phi = phi->next) {
+		if (phi->operandCount != block->predCount) {
+			continue;
+		}
+
+		IRInstr** operands = arenaAlloc(arena, (phi->operandCount + 1) * sizeof(IRInstr*));
+
+		if (operands == NULL) {
+			return 0;
+		}
+
+		if (phi->operandCount > 0) {
+			memcpy(operands, phi->operands, phi->operandCount * sizeof(IRInstr*));
+		}
+
+		phi->operands = operands;
+		phi->operandCount++;
+	}
+
+	block->preds[block->predCount++] = pred;
+	return 1;
+}
+
+int predecessorIndex(IRBlock* block, IRBlock* pred) {
+	for (int i = 0; i < block->predCount; i++) {
+		if (block->preds[i] == pred) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+// drops the edge together with the matching operand of every phi
+void removePredecessor(IRBlock* block, int index) {
+
+	for (IRInstr* phi = block->first; phi != NULL && phi->opcode == PHI_IR; phi = phi->next) {
+		if (index < phi->operandCount) {
+			memmove(phi->operands + index, phi->operands + index + 1, (phi->operandCount - index - 1) * sizeof(IRInstr*));
+			phi->operandCount--;
+		}
+	}
+
+	memmove(block->preds + index, block->preds + index + 1, (block->predCount - index - 1) * sizeof(IRBlock*));
+	block->predCount--;
+}
+
+int successorCount(IRBlock* block) {
+
+	if (block->last == NULL) {
+		return 0;
+	}
+
+	switch (block->last->opcode) {
+		case JUMP_IR:
+			return 1;
+		case BRANCH_IR:
+			return 2;
+		default:
+			return 0;
+	}
+}
+
+IRBlock* successor(IRBlock* block, int index) {
+	return block->last->targets[index];
+}
+
+void replaceSuccessor(IRBlock* block, IRBlock* old, IRBlock* new) {
+	for (int i = 0; i < successorCount(block); i++) {
+		if (block->last->targets[i] == old) {
+			block->last->targets[i] = new;
+		}
+	}
+}
+
+static int insertBlockAfter(IRFunction* function, IRBlock* after, IRBlock* block) {
+
+	DynamicArray* blocks = function->blocks;
+
+	if (!pushItem(blocks, block)) {
+		return 0;
+	}
+
+	int idx = blocks->size - 1;
+
+	while (idx > 0 && blocks->array[idx - 1] != after) {
+		blocks->array[idx] = blocks->array[idx - 1];
+		idx--;
+	}
+
+	blocks->array[idx] = block;
+	return 1;
+}
+
+// the copies for the phis of a block are placed at the end of its predecessors, which is only
+// possible if the predecessor does not branch anywhere else. so every branch into a block with phis
+// gets a block of its own, even when it is the only predecessor
+int splitPhiEdges(IRFunction* function) {
+
+	for (int i = 0; i < function->blocks->size; i++) {
+		IRBlock* block = function->blocks->array[i];
+
+		if (successorCount(block) != 2) {
+			continue;
+		}
+
+		for (int j = 0; j < 2; j++) {
+			IRBlock* target = block->last->targets[j];
+
+			if (target->first == NULL || target->first->opcode != PHI_IR) {
+				continue;
+			}
+
+			IRBlock* edge = irBlock(function);
+			IRInstr* jump = irInstr(function, JUMP_IR, UNKNOWN, 0);
+
+			if (edge == NULL || jump == NULL || !insertBlockAfter(function, block, edge)) {
+				return 0;
+			}
+
+			jump->targets[0] = target;
+			appendIR(edge, jump);
+			block->last->targets[j] = edge;
+
+			// the edge block takes over the predecessor entry, so the phi operands stay in place
+			target->preds[predecessorIndex(target, block)] = edge;
+
+			if (!addPredecessor(function, edge, block)) {
+				return 0;
+			}
+		}
+	}
+
+	return 1;
+}
+
+bool isTerminator(IROpcode opcode) {
+	return opcode == JUMP_IR || opcode == BRANCH_IR || opcode == RETURN_IR;
+}
+
+bool isComparison(IROpcode opcode) {
+	return opcode >= LESS_IR && opcode <= NOT_EQUAL_IR;
+}
+
+// instructions without side effects may be removed once nothing uses their value
+bool hasSideEffects(IRInstr* instr) {
+	return instr->opcode == STORE_IR || instr->opcode == CALL_IR || isTerminator(instr->opcode);
+}
+
+// the value of the call is returned right away, maybe through the phis of blocks that only pass it on
+bool isTailCall(IRInstr* call) {
+
+	IRInstr* value = call;
+	IRBlock* block = call->block;
+	IRInstr* instr = call->next;
+
+	// a few blocks are enough for the joins of nested ifs, and loops cannot keep it going forever
+	for (int steps = 0; steps < 8 && instr != NULL; steps++) {
+		if (instr->opcode == RETURN_IR) {
+			return instr->operandCount == 0 ? call->type == UNKNOWN : instr->operands[0] == value;
+		}
+
+		if (instr->opcode != JUMP_IR) {
+			return false;
+		}
+
+		IRBlock* target = instr->targets[0];
+		int index = predecessorIndex(target, block);
+		IRInstr* passed = value;
+
+		for (instr = target->first; instr != NULL && instr->opcode == PHI_IR; instr = instr->next) {
+			if (instr->operands[index] == value) {
+				passed = instr;
+			}
+		}
+
+		if (instr == NULL || !isTerminator(instr->opcode)) {
+			return false;
+		}
+
+		value = passed;
+		block = target;
+	}
+
+	return false;
+}
+
+// i32 arithmetic wraps around, bools are 0 or 1
+long long truncateConstant(ValueType type, long long value) {
+	switch (type) {
+		case BOOL_TYPE:
+			return value != 0;
+		case LONG_TYPE:
+			return (int32_t)(uint32_t)value;
+		default:
+			return value;
+	}
+}
+
+// evaluates an arithmetic or comparison instruction on constants like the machine would, unary ones ignore right,
+// fails for divisions that would trap at runtime
+bool foldConstant(IROpcode opcode, ValueType type, long long left, long long right, long long* result) {
+
+	long long value;
+
+	switch (opcode) {
+		case ADD_IR: value = left + right; break;
+		case SUB_IR: value = left - right; break;
+		case MUL_IR: value = left * right; break;
+		case DIV_IR:
+		case MOD_IR:
+			if (right == 0 || (left == INT32_MIN && right == -1)) {
+				return false;
+			}
+			value = opcode == DIV_IR ? left / right : left % right;
+			break;
+		case NEG_IR: value = -left; break;
+		case NOT_IR: value = left == 0; break;
+		case LESS_IR: value = left < right; break;
+		case LESS_EQUAL_IR: value = left <= right; break;
+		case GREATER_IR: value = left > right; break;
+		case GREATER_EQUAL_IR: value = left >= right; break;
+		case EQUAL_IR: value = left == right; break;
+		case NOT_EQUAL_IR: value = left != right; break;
+		default:
+			return false;
+	}
+
+	*result = truncateConstant(type, value);
+	return true;
+}
+
+IRInstr* resolveValue(IRInstr* value) {
+
+	IRInstr* resolved = value;
+
+	while (resolved != NULL && resolved->replacement != NULL) {
+		resolved = resolved->replacement;
+	}
+
+	// shorten the chain for the next lookup
+	while (value != NULL && value->replacement != NULL && value->replacement != resolved) {
+		IRInstr* next = value->replacement;
+		value->replacement = resolved;
+		value = next;
+	}
+
+	return resolved;
+}
+
+void applyReplacements(IRFunction* function) {
+	for (int i = 0; i < function->blocks->size; i++) {
+		IRBlock* block = function->blocks->array[i];
+
+		for (IRInstr* instr = block->first; instr != NULL; instr = instr->next) {
+			for (int j = 0; j < instr->operandCount; j++) {
+				instr->operands[j] = resolveValue(instr->operands[j]);
+			}
+		}
+	}
+}
+
+static bool verifyBlock(IRFunction* function, IRBlock* block) {
+
+	if (block->last == NULL || !isTerminator(block->last->opcode)) {
+		fprintf(stderr, "Error: In Function %s: block%d does not end with a terminator\n", function->id, block->id);
+		return false;
+	}
+
+	bool phis = true;
+
+	for (IRInstr* instr = block->first; instr != NULL; instr = instr->next) {
+
+		if (instr->block != block) {
+			fprintf(stderr, "Error: In Function %s: %%%d is linked into the wrong block\n", function->id, instr->id);
+			return false;
+		}
+
+		if (instr != block->last && isTerminator(instr->opcode)) {
+			fprintf(stderr, "Error: In Function %s: terminator in the middle of block%d\n", function->id, block->id);
+			return false;
+		}
+
+		if (instr->opcode == PHI_IR) {
+			if (!phis) {
+				fprintf(stderr, "Error: In Function %s: phi %%%d follows other instructions\n", function->id, instr->id);
+				return false;
+			}
+			if (instr->operandCount != block->predCount) {
+				fprintf(stderr, "Error: In Function %s: phi %%%d has %d operands for %d predecessors\n", function->id, instr->id, instr->operandCount, block->predCount);
+				return false;
+			}
+			if (block->predCount == 0) {
+				fprintf(stderr, "Error: In Function %s: phi %%%d is in a block without predecessors\n", function->id, instr->id);
+				return false;
+			}
+
+			// codegen copies the operands at the end of the predecessors, so each of them has to be entered
+			for (int i = 0; i < block->predCount; i++) {
+				IRBlock* pred = block->preds[i];
+
+				if (pred != function->blocks->array[0] && pred->predCount == 0) {
+					fprintf(stderr, "Error: In Function %s: phi %%%d takes a value from block%d, which is never entered\n", function->id, instr->id, pred->id);
+					return false;
+				}
+			}
+		}
+		else {
+			phis = false;
+		}
+
+		for (int i = 0; i < instr->operandCount; i++) {
+			IRInstr* operand = instr->operands[i];
+
+			if (operand == NULL || operand->replacement != NULL || operand->block == NULL || operand->block->mark != 1) {
+				fprintf(stderr, "Error: In Function %s: %%%d uses a value that is not defined in the function\n", function->id, instr->id);
+				return false;
+			}
+		}
+	}
+
+	for (int i = 0; i < successorCount(block); i++) {
+		IRBlock* target = successor(block, i);
+
+		if (target->mark != 1 || predecessorIndex(target, block) < 0) {
+			fprintf(stderr, "Error: In Function %s: edge from block%d to block%d is not registered\n", function->id, block->id, target->id);
+			return false;
+		}
+	}
+
+	for (int i = 0; i < block->predCount; i++) {
+		IRBlock* pred = block->preds[i];
+		bool found = false;
+
+		for (int j = 0; pred->mark == 1 && j < successorCount(pred); j++) {
+			found = found || successor(pred, j) == block;
+		}
+
+		if (!found) {
+			fprintf(stderr, "Error: In Function %s: block%d is no predecessor of block%d\n", function->id, pred->id, block->id);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// checks the structural invariants the passes rely on, the marks of the blocks are reset afterwards
+bool verifyIR(IRFunction* function) {
+
+	DynamicArray* blocks = function->blocks;
+
+	if (blocks->size == 0) {
+		fprintf(stderr, "Error: Function %s has no blocks\n", function->id);
+		return false;
+	}
+
+	for (int i = 0; i < blocks->size; i++) {
+		((IRBlock*)blocks->array[i])->mark = 1;
+	}
+
+	bool valid = ((IRBlock*)blocks->array[0])->predCount == 0;
+
+	if (!valid) {
+		fprintf(stderr, "Error: In Function %s: the entry block has predecessors\n", function->id);
+	}
+
+	for (int i = 0; valid && i < blocks->size; i++) {
+		valid = verifyBlock(function, blocks->array[i]);
+	}
+
+	for (int i = 0; i < blocks->size; i++) {
+		((IRBlock*)blocks->array[i])->mark = 0;
+	}
+
+	return valid;
+}
+
+const char* irOpcodeName(IROpcode opcode) {
+	switch (opcode) {
+		case CONST_IR: return "const";
+		case PARAM_IR: return "param";
+		case ADD_IR: return "add";
+		case SUB_IR: return "sub";
+		case MUL_IR: return "mul";
+		case DIV_IR: return "div";
+		case MOD_IR: return "mod";
+		case NEG_IR: return "neg";
+		case NOT_IR: return "not";
+		case LESS_IR: return "less";
+		case LESS_EQUAL_IR: return "lessEqual";
+		case GREATER_IR: return "greater";
+		case GREATER_EQUAL_IR: return "greaterEqual";
+		case EQUAL_IR: return "equal";
+		case NOT_EQUAL_IR: return "notEqual";
+		case LOAD_IR: return "load";
+		case STORE_IR: return "store";
+		case CALL_IR: return "call";
+		case PHI_IR: return "phi";
+		case JUMP_IR: return "jump";
+		case BRANCH_IR: return "branch";
+		case RETURN_IR: return "return";
+		default: return "?";
+	}
+}
+
+static const char* typeName(ValueType type) {
+	switch (type) {
+		case BOOL_TYPE: return "bool";
+		case LONG_TYPE: return "i32";
+		default: return "void";
+	}
+}
+
+static void printInstr(IRInstr* instr, FILE* file) {
+
+	fputc('\t', file);
+
+	if (instr->type != UNKNOWN) {
+		fprintf(file, "%%%d = ", instr->id);
+	}
+
+	fprintf(file, "%s", irOpcodeName(instr->opcode));
+
+	if (instr->type != UNKNOWN) {
+		fprintf(file, " %s", typeName(instr->type));
+	}
+
+	switch (instr->opcode) {
+		case CONST_IR:
+			fprintf(file, " %lld\n", instr->as.constant);
+			return;
+		case PARAM_IR:
+			fprintf(file, " %d\n", instr->as.param);
+			return;
+		case LOAD_IR:
+			fprintf(file, " @%s\n", instr->as.symbol);
+			return;
+		case STORE_IR:
+			fprintf(file, " @%s, %%%d\n", instr->as.symbol, instr->operands[0]->id);
+			return;
+		case CALL_IR:
+			fprintf(file, " %s(", instr->as.symbol);
+			for (int i = 0; i < instr->operandCount; i++) {
+				fprintf(file, i == 0 ? "%%%d" : ", %%%d", instr->operands[i]->id);
+			}
+			fprintf(file, ")\n");
+			return;
+		case PHI_IR:
+			for (int i = 0; i < instr->operandCount; i++) {
+				IRInstr* operand = instr->operands[i];
+				fprintf(file, "%s[%%%d, block%d]", i == 0 ? " " : ", ", operand != NULL ? operand->id : -1, instr->block->preds[i]->id);
+			}
+			fputc('\n', file);
+			return;
+		case JUMP_IR:
+			fprintf(file, " block%d\n", instr->targets[0]->id);
+			return;
+		case BRANCH_IR:
+			fprintf(file, " %%%d, block%d, block%d\n", instr->operands[0]->id, instr->targets[0]->id, instr->targets[1]->id);
+			return;
+		default:
+			for (int i = 0; i < instr->operandCount; i++) {
+				fprintf(file, i == 0 ? " %%%d" : ", %%%d", instr->operands[i]->id);
+			}
+			fputc('\n', file);
+			return;
+	}
+}
+
+void printIRFunction(IRFunction* function, FILE* file) {
+
+	fprintf(file, "function %s -> %s\n", function->id, typeName(function->returnType));
+
+	for (int i = 0; i < function->blocks->size; i++) {
+		IRBlock* block = function->blocks->array[i];
+
+		fprintf(file, "block%d:", block->id);
+		for (int j = 0; j < block->predCount; j++) {
+			fprintf(file, j == 0 ? " ; preds block%d" : ", block%d", block->preds[j]->id);
+		}
+		fputc('\n', file);
+
+		for (IRInstr* instr = block->first; instr != NULL; instr = instr->next) {
+			printInstr(instr, file);
+		}
+	}
+
+	fputc('\n', file);
+}
+
+void printIR(IRModule* module, FILE* file) {
+
+	for (int i = 0; i < module->globals->size; i++) {
+		IRGlobal* global = module->globals->array[i];
+		fprintf(file, "global @%s %s = %lld\n", global->id, typeName(global->type), global->value);
+	}
+
+	if (module->globals->size > 0) {
+		fputc('\n', file);
+	}
+
+	for (int i = 0; i < module->functions->size; i++) {
+		printIRFunction(module->functions->array[i], file);
+	}
+}
+
+void freeIRModule(IRModule* module) {
+	if (module == NULL) return;
+	freeArena(module->arena);
+	free(module);
+}
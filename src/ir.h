@@ -0,0 +1,140 @@
+#ifndef IR_H
+#define IR_H
+
+#include "parser.h"
+#include "utils.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+typedef struct IRInstr IRInstr;
+typedef struct IRBlock IRBlock;
+typedef struct IRFunction IRFunction;
+typedef struct IRGlobal IRGlobal;
+typedef struct IRModule IRModule;
+
+typedef enum {
+	CONST_IR,
+	PARAM_IR,
+	ADD_IR,
+	SUB_IR,
+	MUL_IR,
+	DIV_IR,
+	MOD_IR,
+	NEG_IR,
+	NOT_IR,
+	LESS_IR,
+	LESS_EQUAL_IR,
+	GREATER_IR,
+	GREATER_EQUAL_IR,
+	EQUAL_IR,
+	NOT_EQUAL_IR,
+	// globals live in memory, locals are only ever ssa values
+	LOAD_IR,
+	STORE_IR,
+	CALL_IR,
+	PHI_IR,
+	// terminators, every block ends with exactly one of them
+	JUMP_IR,
+	BRANCH_IR,
+	RETURN_IR
+} IROpcode;
+
+// every instruction is also the value it computes
+struct IRInstr {
+	IROpcode opcode;
+	// BOOL_TYPE or LONG_TYPE, UNKNOWN for instructions without a result
+	ValueType type;
+	// dense per function, so passes can keep tables indexed by it
+	int id;
+	IRBlock* block;
+	IRInstr* prev;
+	IRInstr* next;
+	// a phi has one operand per predecessor of its block, in the same order
+	IRInstr** operands;
+	int operandCount;
+	union {
+		long long constant;
+		int param;
+		// the global of LOAD_IR and STORE_IR, the callee of CALL_IR
+		char* symbol;
+	} as;
+	// JUMP_IR uses the first, BRANCH_IR jumps to the first if its operand is true
+	IRBlock* targets[2];
+	// set when the value was replaced, applyReplacements redirects its uses
+	IRInstr* replacement;
+};
+
+struct IRBlock {
+	int id;
+	IRInstr* first;
+	IRInstr* last;
+	IRBlock** preds;
+	int predCount;
+	int predCapacity;
+	// free for passes, e.g. visited marks or an order index
+	int mark;
+};
+
+struct IRFunction {
+	char* id;
+	ValueType returnType;
+	int paramCount;
+	// in layout order, the first block is the entry
+	DynamicArray* blocks;
+	int valueCount;
+	int blockCount;
+	IRModule* module;
+};
+
+struct IRGlobal {
+	char* id;
+	ValueType type;
+	long long value;
+};
+
+// everything in the module is allocated from its arena
+struct IRModule {
+	Arena* arena;
+	DynamicArray* globals;
+	DynamicArray* functions;
+};
+
+IRModule* irModule();
+IRFunction* irFunction(IRModule* module, char* id, ValueType returnType, int paramCount);
+IRGlobal* irGlobal(IRModule* module, char* id, ValueType type, long long value);
+IRBlock* irBlock(IRFunction* function);
+int placeBlock(IRFunction* function, IRBlock* block);
+void removeBlock(IRFunction* function, IRBlock* block);
+IRInstr* irInstr(IRFunction* function, IROpcode opcode, ValueType type, int operandCount);
+IRInstr* irConstant(IRFunction* function, ValueType type, long long value);
+
+void appendIR(IRBlock* block, IRInstr* instr);
+void prependIR(IRBlock* block, IRInstr* instr);
+void insertIRBefore(IRInstr* before, IRInstr* instr);
+void removeIR(IRInstr* instr);
+
+int addPredecessor(IRFunction* function, IRBlock* block, IRBlock* pred);
+int predecessorIndex(IRBlock* block, IRBlock* pred);
+void removePredecessor(IRBlock* block, int index);
+int successorCount(IRBlock* block);
+IRBlock* successor(IRBlock* block, int index);
+void replaceSuccessor(IRBlock* block, IRBlock* old, IRBlock* new);
+int splitPhiEdges(IRFunction* function);
+
+bool isTerminator(IROpcode opcode);
+bool isComparison(IROpcode opcode);
+bool hasSideEffects(IRInstr* instr);
+bool isTailCall(IRInstr* call);
+long long truncateConstant(ValueType type, long long value);
+bool foldConstant(IROpcode opcode, ValueType type, long long left, long long right, long long* result);
+
+IRInstr* resolveValue(IRInstr* value);
+void applyReplacements(IRFunction* function);
+
+bool verifyIR(IRFunction* function);
+void printIR(IRModule* module, FILE* file);
+void printIRFunction(IRFunction* function, FILE* file);
+const char* irOpcodeName(IROpcode opcode);
+void freeIRModule(IRModule* module);
+
+#endif
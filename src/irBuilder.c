@@ -0,0 +1,1071 @@
+#include "irBuilder.h"
+#include "ir.h"
+#include "parser.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+typedef struct IncompletePhi IncompletePhi;
+
+// a phi created while its block still expects predecessors, completed once the block is sealed
+struct IncompletePhi {
+	int slot;
+	IRInstr* phi;
+	IncompletePhi* next;
+};
+
+typedef struct BlockState {
+	// all predecessors of the block are known
+	bool sealed;
+	IncompletePhi* incompletePhis;
+} BlockState;
+
+// the value a local has at the end of a block, keyed by block id and slot
+typedef struct Definition {
+	long long key;
+	IRInstr* value;
+} Definition;
+
+// builds the ssa form directly while walking the ast, after "Simple and Efficient
+// Construction of Static Single Assignment Form" by Braun et al.
+typedef struct IRBuilder {
+	IRModule* module;
+	IRFunction* function;
+	// receives the next instructions, NULL after a return until the next statement
+	IRBlock* block;
+	BlockState* blockStates;
+	int blockStateCapacity;
+	Definition* definitions;
+	int definitionCount;
+	int definitionCapacity;
+	// the value of a local that was never assigned on some path, by type
+	IRInstr* undefinedBool;
+	IRInstr* undefinedLong;
+} IRBuilder;
+
+int lowerStatement(IRBuilder* builder, Statement* statement);
+int lowerGlobalStatement(IRBuilder* builder, Statement* statement);
+int lowerGlobalAssignment(IRBuilder* builder, Assignment* assignment);
+Value* calculateGlobalExpression(Expression* expression);
+Value* addValues(BinOperationType binOpType, Value* left, Value* right);
+int lowerFunctionStmt(IRBuilder* builder, FunctionStmt* function);
+int lowerBlockStmt(IRBuilder* builder, BlockStmt* blockStmt);
+int lowerWhileStmt(IRBuilder* builder, WhileStmt* whileStmt);
+int lowerIfStmt(IRBuilder* builder, IfStmt* ifStmt);
+int lowerReturnStmt(IRBuilder* builder, ReturnStmt* returnStmt);
+IRInstr* lowerExpression(IRBuilder* builder, Expression* expression);
+IRInstr* lowerFunctionCall(IRBuilder* builder, FunctionCall* function);
+IRInstr* lowerAssignment(IRBuilder* builder, Assignment* assignment);
+IRInstr* lowerBinOperation(IRBuilder* builder, BinOperation* binOperation, ValueType type);
+IRInstr* lowerUnaryOperation(IRBuilder* builder, UnaryOperation* unaryOperation, ValueType type);
+IRInstr* lowerVariable(IRBuilder* builder, Variable* variable);
+IRInstr* lowerValue(IRBuilder* builder, Value* value);
+
+IRModule* lowerProgram(DynamicArray* ast) {
+
+	if (ast == NULL) {
+		return NULL;
+	}
+
+	IRBuilder builder = {0};
+	builder.module = irModule();
+
+	if (builder.module == NULL) {
+		return NULL;
+	}
+
+	int success = 1;
+
+	for (int i = 0; success && i < ast->size; i++) {
+		success = lowerGlobalStatement(&builder, (Statement*)ast->array[i]);
+	}
+
+	free(builder.blockStates);
+	free(builder.definitions);
+
+	if (!success) {
+		freeIRModule(builder.module);
+		return NULL;
+	}
+
+	return builder.module;
+}
+
+static BlockState* blockState(IRBuilder* builder, IRBlock* block) {
+
+	if (block->id >= builder->blockStateCapacity) {
+		int capacity = builder->blockStateCapacity == 0 ? 64 : builder->blockStateCapacity * 2;
+
+		while (capacity <= block->id) {
+			capacity *= 2;
+		}
+
+		BlockState* states = realloc(builder->blockStates, capacity * sizeof(BlockState));
+
+		if (states == NULL) {
+			return NULL;
+		}
+
+		memset(states + builder->blockStateCapacity, 0, (capacity - builder->blockStateCapacity) * sizeof(BlockState));
+		builder->blockStates = states;
+		builder->blockStateCapacity = capacity;
+	}
+
+	return &builder->blockStates[block->id];
+}
+
+static long long definitionKey(IRBlock* block, int slot) {
+	return ((long long)block->id << 32) | (unsigned int)slot;
+}
+
+static unsigned long definitionHash(long long key) {
+	return ((unsigned long)key * 0x9E3779B97F4A7C15ul) >> 17;
+}
+
+static Definition* findDefinition(IRBuilder* builder, long long key) {
+
+	if (builder->definitionCapacity == 0) {
+		return NULL;
+	}
+
+	int mask = builder->definitionCapacity - 1;
+	int idx = definitionHash(key) & mask;
+
+	while (builder->definitions[idx].key != -1) {
+		if (builder->definitions[idx].key == key) {
+			return &builder->definitions[idx];
+		}
+		idx = (idx + 1) & mask;
+	}
+
+	return NULL;
+}
+
+static int growDefinitions(IRBuilder* builder) {
+
+	int oldCapacity = builder->definitionCapacity;
+	Definition* old = builder->definitions;
+	int capacity = oldCapacity == 0 ? 256 : oldCapacity * 2;
+	Definition* definitions = malloc(capacity * sizeof(Definition));
+
+	if (definitions == NULL) {
+		return 0;
+	}
+
+	for (int i = 0; i < capacity; i++) {
+		definitions[i].key = -1;
+	}
+
+	builder->definitions = definitions;
+	builder->definitionCapacity = capacity;
+
+	for (int i = 0; i < oldCapacity; i++) {
+		if (old[i].key == -1) {
+			continue;
+		}
+
+		int idx = definitionHash(old[i].key) & (capacity - 1);
+		while (definitions[idx].key != -1) {
+			idx = (idx + 1) & (capacity - 1);
+		}
+		definitions[idx] = old[i];
+	}
+
+	free(old);
+	return 1;
+}
+
+static int writeVariable(IRBuilder* builder, int slot, IRBlock* block, IRInstr* value) {
+
+	long long key = definitionKey(block, slot);
+	Definition* definition = findDefinition(builder, key);
+
+	if (definition != NULL) {
+		definition->value = value;
+		return 1;
+	}
+
+	if ((builder->definitionCount + 1) * 4 > builder->definitionCapacity * 3 && !growDefinitions(builder)) {
+		return 0;
+	}
+
+	int mask = builder->definitionCapacity - 1;
+	int idx = definitionHash(key) & mask;
+
+	while (builder->definitions[idx].key != -1) {
+		idx = (idx + 1) & mask;
+	}
+
+	builder->definitions[idx].key = key;
+	builder->definitions[idx].value = value;
+	builder->definitionCount++;
+	return 1;
+}
+
+// reading a local that was not assigned on every path yields zero, like a fresh stack slot
+static IRInstr* undefinedValue(IRBuilder* builder, ValueType type) {
+
+	IRInstr** cached = type == BOOL_TYPE ? &builder->undefinedBool : &builder->undefinedLong;
+
+	if (*cached == NULL) {
+		*cached = irConstant(builder->function, type, 0);
+
+		if (*cached == NULL) {
+			return NULL;
+		}
+
+		prependIR((IRBlock*)builder->function->blocks->array[0], *cached);
+	}
+
+	return *cached;
+}
+
+static IRInstr* readVariable(IRBuilder* builder, int slot, ValueType type, IRBlock* block);
+
+static int addPhiOperands(IRBuilder* builder, int slot, IRInstr* phi) {
+
+	IRBlock* block = phi->block;
+
+	if (block->predCount > 0) {
+		phi->operands = arenaAlloc(builder->module->arena, block->predCount * sizeof(IRInstr*));
+
+		if (phi->operands == NULL) {
+			return 0;
+		}
+	}
+
+	phi->operandCount = block->predCount;
+
+	for (int i = 0; i < block->predCount; i++) {
+		phi->operands[i] = readVariable(builder, slot, phi->type, block->preds[i]);
+
+		if (phi->operands[i] == NULL) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static IRInstr* readVariableRecursive(IRBuilder* builder, int slot, ValueType type, IRBlock* block) {
+
+	BlockState* state = blockState(builder, block);
+
+	if (state == NULL) {
+		return NULL;
+	}
+
+	IRInstr* value;
+
+	if (!state->sealed) {
+		// more predecessors will follow, the operands are added when the block is sealed
+		value = irInstr(builder->function, PHI_IR, type, 0);
+		IncompletePhi* incomplete = arenaAlloc(builder->module->arena, sizeof(IncompletePhi));
+
+		if (value == NULL || incomplete == NULL) {
+			return NULL;
+		}
+
+		prependIR(block, value);
+		incomplete->slot = slot;
+		incomplete->phi = value;
+		incomplete->next = state->incompletePhis;
+		state->incompletePhis = incomplete;
+	}
+	else if (block->predCount == 0) {
+		value = undefinedValue(builder, type);
+	}
+	else if (block->predCount == 1) {
+		value = readVariable(builder, slot, type, block->preds[0]);
+	}
+	else {
+		// the phi is recorded first, so a loop back to this block finds it instead of recursing forever
+		value = irInstr(builder->function, PHI_IR, type, 0);
+
+		if (value == NULL) {
+			return NULL;
+		}
+
+		prependIR(block, value);
+
+		if (!writeVariable(builder, slot, block, value) || !addPhiOperands(builder, slot, value)) {
+			return NULL;
+		}
+	}
+
+	if (value == NULL || !writeVariable(builder, slot, block, value)) {
+		return NULL;
+	}
+
+	return value;
+}
+
+static IRInstr* readVariable(IRBuilder* builder, int slot, ValueType type, IRBlock* block) {
+
+	Definition* definition = findDefinition(builder, definitionKey(block, slot));
+
+	if (definition != NULL) {
+		return definition->value;
+	}
+
+	return readVariableRecursive(builder, slot, type, block);
+}
+
+static int sealBlock(IRBuilder* builder, IRBlock* block) {
+
+	BlockState* state = blockState(builder, block);
+
+	if (state == NULL) {
+		return 0;
+	}
+
+	for (IncompletePhi* incomplete = state->incompletePhis; incomplete != NULL; incomplete = incomplete->next) {
+		if (!addPhiOperands(builder, incomplete->slot, incomplete->phi)) {
+			return 0;
+		}
+	}
+
+	state->incompletePhis = NULL;
+	state->sealed = true;
+	return 1;
+}
+
+// a phi whose operands are all the same value or the phi itself is replaced by that value,
+// which can make other phis trivial in turn
+static int removeTrivialPhis(IRBuilder* builder) {
+
+	IRFunction* function = builder->function;
+	bool changed = true;
+
+	while (changed) {
+		changed = false;
+
+		for (int i = 0; i < function->blocks->size; i++) {
+			IRBlock* block = function->blocks->array[i];
+			IRInstr* phi = block->first;
+
+			while (phi != NULL && phi->opcode == PHI_IR) {
+				IRInstr* next = phi->next;
+				IRInstr* same = NULL;
+				bool trivial = true;
+
+				for (int j = 0; j < phi->operandCount; j++) {
+					IRInstr* operand = resolveValue(phi->operands[j]);
+					phi->operands[j] = operand;
+
+					if (operand == phi || operand == same) {
+						continue;
+					}
+					if (same != NULL) {
+						trivial = false;
+						break;
+					}
+					same = operand;
+				}
+
+				if (trivial) {
+					if (same == NULL) {
+						same = undefinedValue(builder, phi->type);
+						if (same == NULL) return 0;
+					}
+					phi->replacement = same;
+					removeIR(phi);
+					changed = true;
+				}
+
+				phi = next;
+			}
+		}
+	}
+
+	applyReplacements(function);
+	return 1;
+}
+
+static IRInstr* emitIR(IRBuilder* builder, IRInstr* instr) {
+	if (instr != NULL) {
+		appendIR(builder->block, instr);
+	}
+	return instr;
+}
+
+// makes the block the current one, all of its predecessors have to be known already
+static int startBlock(IRBuilder* builder, IRBlock* block) {
+
+	if (!placeBlock(builder->function, block) || !sealBlock(builder, block)) {
+		return 0;
+	}
+
+	builder->block = block;
+	return 1;
+}
+
+// statements after a return still need a block, it stays without predecessors
+static int ensureBlock(IRBuilder* builder) {
+
+	if (builder->block != NULL) {
+		return 1;
+	}
+
+	IRBlock* block = irBlock(builder->function);
+	return block != NULL && startBlock(builder, block);
+}
+
+static int jumpTo(IRBuilder* builder, IRBlock* target) {
+
+	if (builder->block == NULL) {
+		return 1;
+	}
+
+	IRInstr* jump = emitIR(builder, irInstr(builder->function, JUMP_IR, UNKNOWN, 0));
+
+	if (jump == NULL) {
+		return 0;
+	}
+
+	jump->targets[0] = target;
+
+	if (!addPredecessor(builder->function, target, builder->block)) {
+		return 0;
+	}
+
+	builder->block = NULL;
+	return 1;
+}
+
+static int branchTo(IRBuilder* builder, IRInstr* condition, IRBlock* trueTarget, IRBlock* falseTarget) {
+
+	IRInstr* branch = emitIR(builder, irInstr(builder->function, BRANCH_IR, UNKNOWN, 1));
+
+	if (branch == NULL) {
+		return 0;
+	}
+
+	branch->operands[0] = condition;
+	branch->targets[0] = trueTarget;
+	branch->targets[1] = falseTarget;
+
+	if (!addPredecessor(builder->function, trueTarget, builder->block)
+		|| !addPredecessor(builder->function, falseTarget, builder->block)) {
+		return 0;
+	}
+
+	builder->block = NULL;
+	return 1;
+}
+
+int lowerGlobalStatement(IRBuilder* builder, Statement* statement) {
+	if (builder == NULL || statement == NULL) {
+		return 0;
+	}
+
+	if (statement->type == FUNCTION_STMT) {
+		return lowerFunctionStmt(builder, statement->as.function);
+	}
+
+	if (statement->type != EXPRESSION_STMT || statement->as.expression->type != ASSIGN_EXPR) {
+		fprintf(stderr, "Error: Encountered ILLEGAL statement in Global Data Section\n");
+		return 0;
+	}
+
+	switch (statement->as.expression->valueType) {
+		case BOOL_TYPE:
+		case LONG_TYPE: {
+			return lowerGlobalAssignment(builder, statement->as.expression->as.assignment);
+		}
+		case DOUBLE_TYPE:
+			fprintf(stderr, "Error: Did not implement float Types yet :(\n");
+			return 0;
+		default:
+			fprintf(stderr, "Error: Unrecognized Type in lowerGlobalStatement\n");
+			return 0;
+	}
+}
+
+int lowerGlobalAssignment(IRBuilder* builder, Assignment* assignment) {
+	if (builder == NULL || assignment == NULL) {
+		return 0;
+	}
+
+	ValueType type = assignment->variable->type;
+
+	if (type == UNKNOWN) {
+		fprintf(stderr, "Error: Declarations without Assingment not allowed in global Scope\n");
+	}
+	
+	Value* value = calculateGlobalExpression(assignment->expression);
+
+	if (value == NULL) {
+		fprintf(stderr, "Error: Failed to Calculate Value in lowerGlobalAssignment\n");
+		return 0;
+	}
+
+	char* variableId = assignment->variable->id;
+	// only the first assignment of a global declares it, the resolver marks that occurrence
+	if (!assignment->variable->declaration) {
+		fprintf(stderr, "Error: Tried to redifine global variable \"%s\"", variableId);
+		free(value);
+		return 0;
+	}
+
+	switch (type) {
+		case BOOL_TYPE: {
+			bool val = value->as.b;
+			free(value);
+			return irGlobal(builder->module, variableId, BOOL_TYPE, val) != NULL;
+		}
+		case LONG_TYPE: {
+			long long val = value->as.i_64;
+			free(value);
+			return irGlobal(builder->module, variableId, LONG_TYPE, truncateConstant(LONG_TYPE, val)) != NULL;
+		}
+		case DOUBLE_TYPE:
+			fprintf(stderr, "Error: Did not implement float Types yet :(\n");
+			free(value);
+			return 0;
+		default:
+			fprintf(stderr, "Error: Unrecognized Type in calculate Expression\n");
+			free(value);
+			return 0;
+	}
+}
+
+static bool binaryOpcode(BinOperationType type, IROpcode* opcode) {
+	switch (type) {
+		case ADD_OP: *opcode = ADD_IR; return true;
+		case SUB_OP: *opcode = SUB_IR; return true;
+		case MUL_OP: *opcode = MUL_IR; return true;
+		case DIV_OP: *opcode = DIV_IR; return true;
+		case MOD_OP: *opcode = MOD_IR; return true;
+		case ST_OP: *opcode = LESS_IR; return true;
+		case STE_OP: *opcode = LESS_EQUAL_IR; return true;
+		case GT_OP: *opcode = GREATER_IR; return true;
+		case GTE_OP: *opcode = GREATER_EQUAL_IR; return true;
+		case EQ_OP: *opcode = EQUAL_IR; return true;
+		case NEQ_OP: *opcode = NOT_EQUAL_IR; return true;
+		default: return false;
+	}
+}
+
+Value* calculateGlobalExpression(Expression* expression) {
+	if (expression == NULL) {
+		return NULL;
+	}
+
+	switch (expression->type) {
+		case EXPR_WRAPPER_EXPR:
+			return calculateGlobalExpression(expression->as.expWrap);
+		case ASSIGN_EXPR:
+			fprintf(stderr, "Error: Unexpected Assignment in calculateGlobalExpression\n");
+			return NULL;
+		case UNARY_EXPR: {
+			if (expression->as.unop->type == MINUS) {
+				Value* value = calculateGlobalExpression(expression->as.unop->right);
+				if (value->type == LONG_TYPE) {
+					value->as.i_64 = -value->as.i_64;
+					return value;
+				}
+				free(value);
+				fprintf(stderr, "Error: Unexpected type for Unary Operand -\n");
+				return NULL;
+			}
+			if (expression->as.unop->type == NOT) {
+				Value* value = calculateGlobalExpression(expression->as.unop->right);
+				if (value->type == BOOL_TYPE) {
+					value->as.b = 1 ? value->as.b == 0 : 0;
+					return value;
+				}
+				fprintf(stderr, "Error: Unexpected type for Unary Operand !\n");
+				free(value);
+				return NULL;
+			}
+		}
+		case BINOP_EXPR: {
+			Value* left = calculateGlobalExpression(expression->as.binop->left);
+			Value* right = calculateGlobalExpression(expression->as.binop->right);
+			Value* newValue = addValues(expression->as.binop->type, left, right);
+			if (newValue == NULL) {
+				return NULL;
+			}
+			return newValue;
+		}
+		case VARIABLE_EXPR:
+			fprintf(stderr, "Error: Unexpected Variable in Global Expression\n");
+			return NULL;
+		case VALUE_EXPR: {
+			Value* copiedValue = calloc(1, sizeof(Value));
+			memcpy(copiedValue, expression->as.value, sizeof(Value));
+			return copiedValue;
+		}
+		default:
+			fprintf(stderr, "Error: Unexpected Expression type in generate Expression\n");
+			return 0;
+	}
+}
+
+// folds with the same rules as the functions use at runtime
+Value* addValues(BinOperationType binOpType, Value* left, Value* right) {
+	if (left == NULL || right == NULL) {
+		free(left);
+		free(right);
+		return NULL;
+	}
+
+	IROpcode opcode;
+
+	if (!binaryOpcode(binOpType, &opcode)) {
+		fprintf(stderr, "Error: Encountered illegal Operand in addValues\n");
+		free(left);
+		free(right);
+		return NULL;
+	}
+
+	if (left->type != LONG_TYPE || right->type != LONG_TYPE) {
+		fprintf(stderr, "Error: Operand %s only allowed for type i32 in addValues\n", irOpcodeName(opcode));
+		free(left);
+		free(right);
+		return NULL;
+	}
+
+	ValueType type = isComparison(opcode) ? BOOL_TYPE : LONG_TYPE;
+	long long result;
+	bool folded = foldConstant(opcode, type, left->as.i_64, right->as.i_64, &result);
+	free(left);
+	free(right);
+
+	if (!folded) {
+		fprintf(stderr, "Error: Division by zero in global Expression\n");
+		return NULL;
+	}
+
+	Value* res = calloc(1, sizeof(Value));
+
+	if (res == NULL) return NULL;
+
+	res->type = type;
+	if (type == BOOL_TYPE) {
+		res->as.b = result;
+	}
+	else {
+		res->as.i_64 = result;
+	}
+	return res;
+}
+
+int lowerStatement(IRBuilder* builder, Statement* statement) {
+	if (builder == NULL || statement == NULL) {
+		return 0;
+	}
+
+	if (!ensureBlock(builder)) {
+		return 0;
+	}
+
+	switch (statement->type) {
+		case EXPRESSION_STMT: {
+			Expression* expression = statement->as.expression;
+			// a bare variable without a type only declares it
+			if (expression->type == VARIABLE_EXPR && expression->valueType == UNKNOWN) {
+				return 1;
+			}
+			return lowerExpression(builder, expression) != NULL;
+		}
+		case FUNCTION_STMT:
+			fprintf(stderr, "Error: Function \"%s\" can not be declared inside another Function\n", statement->as.function->id);
+			return 0;
+		case BLOCK_STMT:
+			return lowerBlockStmt(builder, statement->as.blockStmt);
+		case WHILE_STMT:
+			return lowerWhileStmt(builder, statement->as.whileStmt);
+		case IF_STMT:
+			return lowerIfStmt(builder, statement->as.ifStmt);
+		case RETURN_STMT:
+			return lowerReturnStmt(builder, statement->as.returnStmt);
+		case DECLARATION_STMT:
+		default:
+			fprintf(stderr, "Error: Unexpected Statement type %d in lowerStatement\n", statement->type);
+			return 0;
+	}
+}
+
+int lowerFunctionStmt(IRBuilder* builder, FunctionStmt* function) {
+	if (builder == NULL || function == NULL) {
+		return 0;
+	}
+
+	builder->function = irFunction(builder->module, function->id, function->returnType, function->params->size);
+
+	if (builder->function == NULL) {
+		return 0;
+	}
+
+	// the block ids and with them all keys start over
+	for (int i = 0; i < builder->definitionCapacity; i++) {
+		builder->definitions[i].key = -1;
+	}
+	builder->definitionCount = 0;
+	memset(builder->blockStates, 0, builder->blockStateCapacity * sizeof(BlockState));
+	builder->undefinedBool = NULL;
+	builder->undefinedLong = NULL;
+
+	IRBlock* entry = irBlock(builder->function);
+
+	if (entry == NULL || !startBlock(builder, entry)) {
+		return 0;
+	}
+
+	for (int i = 0; i < function->params->size; i++) {
+		Variable* param = (Variable*)function->params->array[i];
+		IRInstr* value = emitIR(builder, irInstr(builder->function, PARAM_IR, param->type, 0));
+
+		if (value == NULL) {
+			return 0;
+		}
+
+		value->as.param = i;
+
+		if (!writeVariable(builder, param->slot, entry, value)) {
+			return 0;
+		}
+	}
+
+	if (!lowerBlockStmt(builder, function->blockStmt)) {
+		return 0;
+	}
+
+	// the type checker demands a final return, this only covers blocks it cannot see into
+	if (builder->block != NULL) {
+		IRInstr* value = undefinedValue(builder, function->returnType);
+		IRInstr* ret = emitIR(builder, irInstr(builder->function, RETURN_IR, UNKNOWN, 1));
+
+		if (value == NULL || ret == NULL) {
+			return 0;
+		}
+
+		ret->operands[0] = value;
+	}
+
+	builder->block = NULL;
+
+	if (!removeTrivialPhis(builder)) {
+		return 0;
+	}
+
+	builder->function = NULL;
+	return 1;
+}
+
+int lowerBlockStmt(IRBuilder* builder, BlockStmt* blockStmt) {
+	if (builder == NULL || blockStmt == NULL) {
+		return 0;
+	}
+
+	for (int i = 0; i < blockStmt->stmts->size; i++) {
+		if (!lowerStatement(builder, (Statement*)blockStmt->stmts->array[i])) {
+			return 0;
+		}
+
+		// the rest of the block follows a return and can never run
+		if (builder->block == NULL) {
+			break;
+		}
+	}
+
+	return 1;
+}
+
+// loops are rotated into a guard and a do-while: the condition is tested once before the loop
+// and again at the end of the body, which branches back to the start of the body. that saves
+// the jump back to a test at the top in every iteration. the body gets its predecessors from
+// the guard and the end of the body, so it is only sealed once the body is lowered
+int lowerWhileStmt(IRBuilder* builder, WhileStmt* whileStmt) {
+	if (builder == NULL || whileStmt == NULL) {
+		return 0;
+	}
+
+	IRBlock* body = irBlock(builder->function);
+	IRBlock* exit = irBlock(builder->function);
+
+	if (body == NULL || exit == NULL) {
+		return 0;
+	}
+
+	IRInstr* guard = lowerExpression(builder, whileStmt->condition);
+
+	if (guard == NULL || !branchTo(builder, guard, body, exit) || !placeBlock(builder->function, body)) {
+		return 0;
+	}
+
+	builder->block = body;
+
+	if (!lowerBlockStmt(builder, whileStmt->body)) {
+		return 0;
+	}
+
+	// a body that always returns has no end to test the condition at
+	if (builder->block != NULL) {
+		IRInstr* condition = lowerExpression(builder, whileStmt->condition);
+
+		if (condition == NULL || !branchTo(builder, condition, body, exit)) {
+			return 0;
+		}
+	}
+
+	if (!sealBlock(builder, body)) {
+		return 0;
+	}
+
+	return startBlock(builder, exit);
+}
+
+int lowerIfStmt(IRBuilder* builder, IfStmt* ifStmt) {
+	if (builder == NULL || ifStmt == NULL) {
+		return 0;
+	}
+
+	IRInstr* condition = lowerExpression(builder, ifStmt->condition);
+
+	if (condition == NULL) {
+		return 0;
+	}
+
+	IRBlock* trueBlock = irBlock(builder->function);
+	IRBlock* falseBlock = ifStmt->type == ONLYIF ? NULL : irBlock(builder->function);
+	IRBlock* join = irBlock(builder->function);
+
+	if (trueBlock == NULL || join == NULL || (ifStmt->type != ONLYIF && falseBlock == NULL)) {
+		return 0;
+	}
+
+	if (!branchTo(builder, condition, trueBlock, falseBlock != NULL ? falseBlock : join)) {
+		return 0;
+	}
+
+	if (!startBlock(builder, trueBlock) || !lowerBlockStmt(builder, ifStmt->trueBody) || !jumpTo(builder, join)) {
+		return 0;
+	}
+
+	if (falseBlock != NULL) {
+		if (!startBlock(builder, falseBlock)) {
+			return 0;
+		}
+
+		if (ifStmt->type == IF_ELSE) {
+			if (!lowerBlockStmt(builder, ifStmt->as.ifElse)) return 0;
+		}
+		else {
+			if (!lowerIfStmt(builder, ifStmt->as.ifElseIf)) return 0;
+		}
+
+		if (!jumpTo(builder, join)) {
+			return 0;
+		}
+	}
+
+	// every branch returned, whatever follows is unreachable
+	if (join->predCount == 0) {
+		return 1;
+	}
+
+	return startBlock(builder, join);
+}
+
+int lowerReturnStmt(IRBuilder* builder, ReturnStmt* returnStmt) {
+	if (builder == NULL || returnStmt == NULL) {
+		return 0;
+	}
+
+	IRInstr* value = lowerExpression(builder, returnStmt->expression);
+
+	if (value == NULL) {
+		return 0;
+	}
+
+	IRInstr* ret = emitIR(builder, irInstr(builder->function, RETURN_IR, UNKNOWN, 1));
+
+	if (ret == NULL) {
+		return 0;
+	}
+
+	ret->operands[0] = value;
+	builder->block = NULL;
+	return 1;
+}
+
+IRInstr* lowerExpression(IRBuilder* builder, Expression* expression) {
+	if (builder == NULL || expression == NULL) {
+		return NULL;
+	}
+
+	switch (expression->type) {
+		case EXPR_WRAPPER_EXPR:
+			return lowerExpression(builder, expression->as.expWrap);
+		case FUNCTIONCALL_EXPR:
+			return lowerFunctionCall(builder, expression->as.functionCall);
+		case ASSIGN_EXPR:
+			return lowerAssignment(builder, expression->as.assignment);
+		case BINOP_EXPR:
+			return lowerBinOperation(builder, expression->as.binop, expression->valueType);
+		case UNARY_EXPR:
+			return lowerUnaryOperation(builder, expression->as.unop, expression->valueType);
+		case VARIABLE_EXPR:
+			return lowerVariable(builder, expression->as.variable);
+		case VALUE_EXPR:
+			return lowerValue(builder, expression->as.value);
+		default:
+			fprintf(stderr, "Error: Unexpected Expression type in lowerExpression\n");
+			return NULL;
+	}
+}
+
+IRInstr* lowerFunctionCall(IRBuilder* builder, FunctionCall* function) {
+	if (builder == NULL || function == NULL) {
+		return NULL;
+	}
+
+	IRInstr* call = irInstr(builder->function, CALL_IR, function->returnType, function->params->size);
+
+	if (call == NULL) {
+		return NULL;
+	}
+
+	for (int i = 0; i < function->params->size; i++) {
+		call->operands[i] = lowerExpression(builder, (Expression*)function->params->array[i]);
+
+		if (call->operands[i] == NULL) {
+			return NULL;
+		}
+	}
+
+	call->as.symbol = function->id;
+	return emitIR(builder, call);
+}
+
+IRInstr* lowerAssignment(IRBuilder* builder, Assignment* assignment) {
+	if (builder == NULL || assignment == NULL) {
+		return NULL;
+	}
+
+	IRInstr* value = lowerExpression(builder, assignment->expression);
+
+	if (value == NULL) {
+		return NULL;
+	}
+
+	Variable* variable = assignment->variable;
+
+	switch (variable->kind) {
+		case LOCAL_SYMBOL:
+			return writeVariable(builder, variable->slot, builder->block, value) ? value : NULL;
+		case GLOBAL_SYMBOL: {
+			IRInstr* store = emitIR(builder, irInstr(builder->function, STORE_IR, UNKNOWN, 1));
+
+			if (store == NULL) {
+				return NULL;
+			}
+
+			store->operands[0] = value;
+			store->as.symbol = variable->id;
+			return value;
+		}
+		default:
+			fprintf(stderr, "Error: Assignment to unresolved Variable \"%s\"\n", variable->id);
+			return NULL;
+	}
+}
+
+IRInstr* lowerBinOperation(IRBuilder* builder, BinOperation* binOperation, ValueType type) {
+	if (builder == NULL || binOperation == NULL) {
+		return NULL;
+	}
+
+	IROpcode opcode;
+	if (!binaryOpcode(binOperation->type, &opcode)) {
+		fprintf(stderr, "Error: Encountered illegal Operand in lowerBinOperation\n");
+		return NULL;
+	}
+
+	IRInstr* left = lowerExpression(builder, binOperation->left);
+	IRInstr* right = left != NULL ? lowerExpression(builder, binOperation->right) : NULL;
+	IRInstr* instr = right != NULL ? irInstr(builder->function, opcode, type, 2) : NULL;
+
+	if (instr == NULL) {
+		return NULL;
+	}
+
+	instr->operands[0] = left;
+	instr->operands[1] = right;
+	return emitIR(builder, instr);
+}
+
+IRInstr* lowerUnaryOperation(IRBuilder* builder, UnaryOperation* unaryOperation, ValueType type) {
+	if (builder == NULL || unaryOperation == NULL) {
+		return NULL;
+	}
+
+	IROpcode opcode;
+	if (unaryOperation->type == NOT) {
+		opcode = NOT_IR;
+	}
+	else if (unaryOperation->type == MINUS) {
+		opcode = NEG_IR;
+	}
+	else {
+		fprintf(stderr, "Error: Unexpected Unary Operation Operand encountered in lowerUnaryOperation: %d\n", unaryOperation->type);
+		return NULL;
+	}
+
+	IRInstr* operand = lowerExpression(builder, unaryOperation->right);
+	IRInstr* instr = operand != NULL ? irInstr(builder->function, opcode, type, 1) : NULL;
+
+	if (instr == NULL) {
+		return NULL;
+	}
+
+	instr->operands[0] = operand;
+	return emitIR(builder, instr);
+}
+
+IRInstr* lowerVariable(IRBuilder* builder, Variable* variable) {
+	if (builder == NULL || variable == NULL) {
+		return NULL;
+	}
+
+	switch (variable->kind) {
+		case LOCAL_SYMBOL:
+			return readVariable(builder, variable->slot, variable->type, builder->block);
+		case GLOBAL_SYMBOL: {
+			IRInstr* load = emitIR(builder, irInstr(builder->function, LOAD_IR, variable->type, 0));
+
+			if (load != NULL) {
+				load->as.symbol = variable->id;
+			}
+
+			return load;
+		}
+		default:
+			fprintf(stderr, "Error: Tried to read unresolved Variable \"%s\"\n", variable->id);
+			return NULL;
+	}
+}
+
+IRInstr* lowerValue(IRBuilder* builder, Value* value) {
+	if (builder == NULL || value == NULL) {
+		return NULL;
+	}
+
+	switch (value->type) {
+		case LONG_TYPE:
+			return emitIR(builder, irConstant(builder->function, LONG_TYPE, value->as.i_32));
+		case BOOL_TYPE:
+			return emitIR(builder, irConstant(builder->function, BOOL_TYPE, value->as.b));
+		case DOUBLE_TYPE:
+			fprintf(stderr, "Error: Did not implement float Types yet :(\n");
+			return NULL;
+		default:
+			fprintf(stderr, "Error: Unregognized Value Type in lowerValue\n");
+			return NULL;
+	}
+}
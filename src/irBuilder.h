@@ -0,0 +1,11 @@
+#ifndef IRBUILDER_H
+#define IRBUILDER_H
+
+#include "ir.h"
+#include "parser.h"
+#include "utils.h"
+
+// lowers the checked ast into ssa form: locals become values, with phis where control flow merges
+IRModule* lowerProgram(DynamicArray* ast);
+
+#endif
@@ -0,0 +1,912 @@
+#include "irPasses.h"
+#include "ir.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// blocks that cannot be reached from the entry are dropped together with their outgoing edges
+static int removeUnreachableBlocks(IRFunction* function, bool* changed) {
+
+	DynamicArray* blocks = function->blocks;
+	IRBlock** stack = malloc(blocks->size * sizeof(IRBlock*));
+
+	if (stack == NULL) {
+		return 0;
+	}
+
+	for (int i = 0; i < blocks->size; i++) {
+		((IRBlock*)blocks->array[i])->mark = 0;
+	}
+
+	int top = 0;
+	IRBlock* entry = blocks->array[0];
+	entry->mark = 1;
+	stack[top++] = entry;
+
+	while (top > 0) {
+		IRBlock* block = stack[--top];
+
+		for (int i = 0; i < successorCount(block); i++) {
+			IRBlock* target = successor(block, i);
+
+			if (target->mark == 0) {
+				target->mark = 1;
+				stack[top++] = target;
+			}
+		}
+	}
+
+	free(stack);
+
+	int kept = 0;
+
+	for (int i = 0; i < blocks->size; i++) {
+		IRBlock* block = blocks->array[i];
+
+		if (block->mark == 1) {
+			blocks->array[kept++] = block;
+			continue;
+		}
+
+		for (int j = 0; j < successorCount(block); j++) {
+			IRBlock* target = successor(block, j);
+			int index = predecessorIndex(target, block);
+
+			if (index >= 0) {
+				removePredecessor(target, index);
+			}
+		}
+
+		*changed = true;
+	}
+
+	blocks->size = kept;
+
+	for (int i = 0; i < blocks->size; i++) {
+		((IRBlock*)blocks->array[i])->mark = 0;
+	}
+
+	return 1;
+}
+
+// a branch to the same block on both sides does not need its condition
+static void simplifyBranch(IRFunction* function, IRBlock* block, bool* changed) {
+
+	IRInstr* branch = block->last;
+
+	if (branch->opcode != BRANCH_IR || branch->targets[0] != branch->targets[1]) {
+		return;
+	}
+
+	IRBlock* target = branch->targets[0];
+	branch->opcode = JUMP_IR;
+	branch->operandCount = 0;
+	branch->targets[1] = NULL;
+	removePredecessor(target, predecessorIndex(target, block));
+	*changed = true;
+}
+
+static bool removeTrivialPhis(IRBlock* block) {
+
+	bool removed = false;
+	IRInstr* phi = block->first;
+
+	while (phi != NULL && phi->opcode == PHI_IR) {
+		IRInstr* next = phi->next;
+		IRInstr* same = NULL;
+		bool trivial = true;
+
+		for (int i = 0; i < phi->operandCount; i++) {
+			IRInstr* operand = resolveValue(phi->operands[i]);
+
+			if (operand == phi || operand == same) {
+				continue;
+			}
+			if (same != NULL) {
+				trivial = false;
+				break;
+			}
+			same = operand;
+		}
+
+		// a phi without any other operand only exists in blocks without predecessors, which are removed anyway
+		if (trivial && same != NULL) {
+			phi->replacement = same;
+			removeIR(phi);
+			removed = true;
+		}
+
+		phi = next;
+	}
+
+	return removed;
+}
+
+// appends the block to its only predecessor, which jumps to nowhere else
+static bool mergeIntoPredecessor(IRFunction* function, IRBlock* block) {
+
+	if (block == function->blocks->array[0] || block->predCount != 1) {
+		return false;
+	}
+
+	IRBlock* pred = block->preds[0];
+
+	if (pred == block || pred->last->opcode != JUMP_IR) {
+		return false;
+	}
+
+	// with a single predecessor every phi is trivial
+	for (IRInstr* phi = block->first; phi != NULL && phi->opcode == PHI_IR; phi = block->first) {
+		phi->replacement = phi->operands[0];
+		removeIR(phi);
+	}
+
+	removeIR(pred->last);
+
+	while (block->first != NULL) {
+		IRInstr* instr = block->first;
+		removeIR(instr);
+		appendIR(pred, instr);
+	}
+
+	for (int i = 0; i < successorCount(pred); i++) {
+		IRBlock* target = successor(pred, i);
+		int index = predecessorIndex(target, block);
+
+		if (index >= 0) {
+			target->preds[index] = pred;
+		}
+	}
+
+	block->predCount = 0;
+	removeBlock(function, block);
+	return true;
+}
+
+// predecessors of a block that only jumps on go to its target directly,
+// as long as the target has no phis that would have to tell them apart
+static int skipEmptyBlock(IRFunction* function, IRBlock* block, bool* skipped) {
+
+	IRInstr* jump = block->first;
+
+	if (block == function->blocks->array[0] || jump == NULL || jump->opcode != JUMP_IR) {
+		return 1;
+	}
+
+	IRBlock* target = jump->targets[0];
+
+	if (target == block || (target->first != NULL && target->first->opcode == PHI_IR)) {
+		return 1;
+	}
+
+	removePredecessor(target, predecessorIndex(target, block));
+
+	for (int i = 0; i < block->predCount; i++) {
+		IRBlock* pred = block->preds[i];
+		replaceSuccessor(pred, block, target);
+
+		if (!addPredecessor(function, target, pred)) {
+			return 0;
+		}
+	}
+
+	block->predCount = 0;
+	removeBlock(function, block);
+	*skipped = true;
+	return 1;
+}
+
+int simplifyCFG(IRFunction* function) {
+
+	if (function == NULL || function->blocks->size == 0) {
+		return 0;
+	}
+
+	bool changed = true;
+
+	while (changed) {
+		changed = false;
+
+		if (!removeUnreachableBlocks(function, &changed)) {
+			return 0;
+		}
+
+		for (int i = 0; i < function->blocks->size; i++) {
+			simplifyBranch(function, function->blocks->array[i], &changed);
+		}
+
+		for (int i = 0; i < function->blocks->size; i++) {
+			IRBlock* block = function->blocks->array[i];
+			bool removed = false;
+
+			if (removeTrivialPhis(block)) {
+				changed = true;
+			}
+
+			if (mergeIntoPredecessor(function, block)) {
+				removed = true;
+			}
+			else if (!skipEmptyBlock(function, block, &removed)) {
+				return 0;
+			}
+
+			// the next block moved into this index
+			if (removed) {
+				changed = true;
+				i--;
+			}
+		}
+
+		applyReplacements(function);
+	}
+
+	return 1;
+}
+
+int eliminateDeadCode(IRFunction* function) {
+
+	if (function == NULL) {
+		return 0;
+	}
+
+	bool* live = calloc(function->valueCount, sizeof(bool));
+	IRInstr** worklist = malloc(function->valueCount * sizeof(IRInstr*));
+
+	if (live == NULL || worklist == NULL) {
+		free(live);
+		free(worklist);
+		return 0;
+	}
+
+	int count = 0;
+
+	for (int i = 0; i < function->blocks->size; i++) {
+		IRBlock* block = function->blocks->array[i];
+
+		for (IRInstr* instr = block->first; instr != NULL; instr = instr->next) {
+			if (hasSideEffects(instr)) {
+				live[instr->id] = true;
+				worklist[count++] = instr;
+			}
+		}
+	}
+
+	while (count > 0) {
+		IRInstr* instr = worklist[--count];
+
+		for (int i = 0; i < instr->operandCount; i++) {
+			IRInstr* operand = instr->operands[i];
+
+			if (!live[operand->id]) {
+				live[operand->id] = true;
+				worklist[count++] = operand;
+			}
+		}
+	}
+
+	for (int i = 0; i < function->blocks->size; i++) {
+		IRBlock* block = function->blocks->array[i];
+		IRInstr* instr = block->first;
+
+		while (instr != NULL) {
+			IRInstr* next = instr->next;
+
+			if (!live[instr->id]) {
+				removeIR(instr);
+			}
+
+			instr = next;
+		}
+	}
+
+	free(live);
+	free(worklist);
+	return 1;
+}
+
+// globals that are certain to be stored again before they are read, as one bit per stored global.
+// walks the block backwards from the state at its end: calls and returns may read every global
+static void transferStores(HashTable* globals, IRBlock* block, unsigned long long* dead, int words, bool removeStores) {
+
+	IRInstr* instr = block->last;
+
+	while (instr != NULL) {
+		IRInstr* prev = instr->prev;
+		bool accessesGlobal = instr->opcode == LOAD_IR || instr->opcode == STORE_IR;
+		long index = accessesGlobal ? (long)getValue(globals, instr->as.symbol) - 1 : -1;
+
+		if (instr->opcode == CALL_IR || instr->opcode == RETURN_IR) {
+			memset(dead, 0, words * sizeof(unsigned long long));
+		}
+		else if (instr->opcode == LOAD_IR && index >= 0) {
+			dead[index / 64] &= ~(1ULL << (index % 64));
+		}
+		else if (instr->opcode == STORE_IR) {
+			if (removeStores && (dead[index / 64] & (1ULL << (index % 64)))) {
+				removeIR(instr);
+			}
+			dead[index / 64] |= 1ULL << (index % 64);
+		}
+
+		instr = prev;
+	}
+}
+
+// the state at the end of the block, a global is only dead there if it is dead on every successor
+static void deadAtEnd(IRBlock* block, unsigned long long* deadIn, unsigned long long* dead, int words) {
+
+	for (int w = 0; w < words; w++) {
+		dead[w] = ~0ULL;
+	}
+
+	for (int i = 0; i < successorCount(block); i++) {
+		unsigned long long* in = &deadIn[successor(block, i)->mark * words];
+
+		for (int w = 0; w < words; w++) {
+			dead[w] &= in[w];
+		}
+	}
+}
+
+// locals are ssa values that dce removes, this handles the stores to globals
+int eliminateDeadStores(IRFunction* function) {
+
+	if (function == NULL) {
+		return 0;
+	}
+
+	HashTable* globals = symbolTable(16, NULL);
+
+	if (globals == NULL) {
+		return 0;
+	}
+
+	long globalCount = 0;
+
+	for (int i = 0; i < function->blocks->size; i++) {
+		IRBlock* block = function->blocks->array[i];
+		block->mark = i;
+
+		for (IRInstr* instr = block->first; instr != NULL; instr = instr->next) {
+			if (instr->opcode == STORE_IR && !containsKey(globals, instr->as.symbol)) {
+				if (!insertKeyPair(globals, instr->as.symbol, (void*)(globalCount + 1))) {
+					freeTable(globals);
+					return 0;
+				}
+				globalCount++;
+			}
+		}
+	}
+
+	if (globalCount == 0) {
+		freeTable(globals);
+		return 1;
+	}
+
+	int words = (globalCount + 63) / 64;
+	int blockCount = function->blocks->size;
+	// starts out with everything dead, so stores in loops are found as well
+	unsigned long long* deadIn = malloc(blockCount * words * sizeof(unsigned long long));
+	unsigned long long* dead = malloc(words * sizeof(unsigned long long));
+
+	if (deadIn == NULL || dead == NULL) {
+		free(deadIn);
+		free(dead);
+		freeTable(globals);
+		return 0;
+	}
+
+	memset(deadIn, 0xFF, blockCount * words * sizeof(unsigned long long));
+	bool changed = true;
+
+	while (changed) {
+		changed = false;
+
+		for (int i = blockCount - 1; i >= 0; i--) {
+			IRBlock* block = function->blocks->array[i];
+			deadAtEnd(block, deadIn, dead, words);
+			transferStores(globals, block, dead, words, false);
+
+			if (memcmp(dead, &deadIn[i * words], words * sizeof(unsigned long long)) != 0) {
+				memcpy(&deadIn[i * words], dead, words * sizeof(unsigned long long));
+				changed = true;
+			}
+		}
+	}
+
+	for (int i = 0; i < blockCount; i++) {
+		IRBlock* block = function->blocks->array[i];
+		deadAtEnd(block, deadIn, dead, words);
+		transferStores(globals, block, dead, words, true);
+	}
+
+	free(deadIn);
+	free(dead);
+	freeTable(globals);
+	return 1;
+}
+
+// the calls of the function to itself whose value is returned right away, they become jumps
+// back to the start. the entry turns into the loop header, with a phi per param
+int eliminateTailRecursion(IRFunction* function) {
+
+	if (function == NULL) {
+		return 0;
+	}
+
+	DynamicArray* blocks = function->blocks;
+	IRBlock* header = blocks->array[0];
+	bool found = false;
+
+	for (int i = 0; i < blocks->size && !found; i++) {
+		IRBlock* block = blocks->array[i];
+		IRInstr* call = block->last->prev;
+		found = call != NULL && call->opcode == CALL_IR && call->as.symbol == function->id && isTailCall(call);
+	}
+
+	if (!found) {
+		return 1;
+	}
+
+	// the params stay in a new entry in front of the header, which has no predecessors itself
+	IRBlock* entry = irBlock(function);
+	IRInstr* jump = irInstr(function, JUMP_IR, UNKNOWN, 0);
+	IRInstr** phis = calloc(function->paramCount + 1, sizeof(IRInstr*));
+
+	if (entry == NULL || jump == NULL || phis == NULL || !pushItem(blocks, entry)) {
+		free(phis);
+		return 0;
+	}
+
+	memmove(blocks->array + 1, blocks->array, (blocks->size - 1) * sizeof(void*));
+	blocks->array[0] = entry;
+	IRInstr* instr = header->first;
+
+	while (instr != NULL) {
+		IRInstr* next = instr->next;
+
+		if (instr->opcode == PARAM_IR) {
+			IRInstr* phi = irInstr(function, PHI_IR, instr->type, 1);
+
+			if (phi == NULL) {
+				free(phis);
+				return 0;
+			}
+
+			removeIR(instr);
+			appendIR(entry, instr);
+			insertIRBefore(header->first, phi);
+			phis[instr->as.param] = phi;
+			instr->replacement = phi;
+		}
+
+		instr = next;
+	}
+
+	jump->targets[0] = header;
+	appendIR(entry, jump);
+
+	if (!addPredecessor(function, header, entry)) {
+		free(phis);
+		return 0;
+	}
+
+	// every use of a param now reads its phi, except the phi itself
+	applyReplacements(function);
+
+	for (instr = entry->first; instr->opcode == PARAM_IR; instr = instr->next) {
+		instr->replacement = NULL;
+		phis[instr->as.param]->operands[0] = instr;
+	}
+
+	for (int i = 1; i < blocks->size; i++) {
+		IRBlock* block = blocks->array[i];
+		IRInstr* call = block->last->prev;
+
+		if (call == NULL || call->opcode != CALL_IR || call->as.symbol != function->id || !isTailCall(call)) {
+			continue;
+		}
+
+		// the arguments go around the loop, the return is left to the other paths
+		IRInstr* terminator = block->last;
+
+		if (terminator->opcode == JUMP_IR) {
+			removePredecessor(terminator->targets[0], predecessorIndex(terminator->targets[0], block));
+		}
+
+		if (!addPredecessor(function, header, block)) {
+			free(phis);
+			return 0;
+		}
+
+		for (int j = 0; j < function->paramCount; j++) {
+			if (phis[j] != NULL) {
+				phis[j]->operands[header->predCount - 1] = call->operands[j];
+			}
+		}
+
+		removeIR(terminator);
+		removeIR(call);
+		terminator->opcode = JUMP_IR;
+		terminator->operandCount = 0;
+		terminator->targets[0] = header;
+		appendIR(block, terminator);
+	}
+
+	free(phis);
+
+	// blocks that only passed the value of a call on may not be reachable anymore
+	bool changed = false;
+	return removeUnreachableBlocks(function, &changed);
+}
+
+typedef enum {
+	// no executable definition seen yet
+	UNDEFINED_LATTICE,
+	CONSTANT_LATTICE,
+	// differs between executions
+	VARYING_LATTICE
+} LatticeKind;
+
+typedef struct LatticeValue {
+	LatticeKind kind;
+	long long constant;
+} LatticeValue;
+
+typedef struct SCCP {
+	IRFunction* function;
+	LatticeValue* values;
+	// users of every value as ranges into the users array, indexed by value id
+	int* userStart;
+	IRInstr** users;
+	// two outgoing edges per block id, in the order of the terminator targets
+	bool* executableEdges;
+	bool* visitedBlocks;
+	IRBlock** blockWorklist;
+	int blockCount;
+	IRInstr** valueWorklist;
+	int valueCount;
+	int valueCapacity;
+} SCCP;
+
+static int collectUsers(SCCP* sccp) {
+
+	IRFunction* function = sccp->function;
+	int* counts = calloc(function->valueCount + 1, sizeof(int));
+
+	if (counts == NULL) {
+		return 0;
+	}
+
+	int total = 0;
+
+	for (int i = 0; i < function->blocks->size; i++) {
+		IRBlock* block = function->blocks->array[i];
+
+		for (IRInstr* instr = block->first; instr != NULL; instr = instr->next) {
+			for (int j = 0; j < instr->operandCount; j++) {
+				counts[instr->operands[j]->id]++;
+				total++;
+			}
+		}
+	}
+
+	sccp->userStart = malloc((function->valueCount + 1) * sizeof(int));
+	sccp->users = malloc((total + 1) * sizeof(IRInstr*));
+
+	if (sccp->userStart == NULL || sccp->users == NULL) {
+		free(counts);
+		return 0;
+	}
+
+	int start = 0;
+
+	for (int i = 0; i <= function->valueCount; i++) {
+		sccp->userStart[i] = start;
+		start += counts[i];
+		counts[i] = sccp->userStart[i];
+	}
+
+	for (int i = 0; i < function->blocks->size; i++) {
+		IRBlock* block = function->blocks->array[i];
+
+		for (IRInstr* instr = block->first; instr != NULL; instr = instr->next) {
+			for (int j = 0; j < instr->operandCount; j++) {
+				sccp->users[counts[instr->operands[j]->id]++] = instr;
+			}
+		}
+	}
+
+	free(counts);
+	return 1;
+}
+
+static int pushValue(SCCP* sccp, IRInstr* instr) {
+
+	if (sccp->valueCount == sccp->valueCapacity) {
+		int capacity = sccp->valueCapacity == 0 ? 16 : sccp->valueCapacity * 2;
+		IRInstr** worklist = realloc(sccp->valueWorklist, capacity * sizeof(IRInstr*));
+
+		if (worklist == NULL) {
+			return 0;
+		}
+
+		sccp->valueWorklist = worklist;
+		sccp->valueCapacity = capacity;
+	}
+
+	sccp->valueWorklist[sccp->valueCount++] = instr;
+	return 1;
+}
+
+static LatticeValue meet(LatticeValue left, LatticeValue right) {
+
+	if (left.kind == UNDEFINED_LATTICE) {
+		return right;
+	}
+	if (right.kind == UNDEFINED_LATTICE || (left.kind == CONSTANT_LATTICE && right.kind == CONSTANT_LATTICE && left.constant == right.constant)) {
+		return left;
+	}
+
+	return (LatticeValue){VARYING_LATTICE, 0};
+}
+
+static bool isEdgeExecutable(SCCP* sccp, IRBlock* pred, IRBlock* block) {
+	for (int i = 0; i < successorCount(pred); i++) {
+		if (successor(pred, i) == block && sccp->executableEdges[pred->id * 2 + i]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static LatticeValue evaluate(SCCP* sccp, IRInstr* instr) {
+
+	LatticeValue varying = {VARYING_LATTICE, 0};
+
+	switch (instr->opcode) {
+		case CONST_IR:
+			return (LatticeValue){CONSTANT_LATTICE, instr->as.constant};
+		case PHI_IR: {
+			LatticeValue result = {UNDEFINED_LATTICE, 0};
+
+			for (int i = 0; i < instr->operandCount; i++) {
+				if (isEdgeExecutable(sccp, instr->block->preds[i], instr->block)) {
+					result = meet(result, sccp->values[instr->operands[i]->id]);
+				}
+			}
+
+			return result;
+		}
+		case ADD_IR:
+		case SUB_IR:
+		case MUL_IR:
+		case DIV_IR:
+		case MOD_IR:
+		case NEG_IR:
+		case NOT_IR:
+		case LESS_IR:
+		case LESS_EQUAL_IR:
+		case GREATER_IR:
+		case GREATER_EQUAL_IR:
+		case EQUAL_IR:
+		case NOT_EQUAL_IR: {
+			long long operands[2] = {0, 0};
+
+			for (int i = 0; i < instr->operandCount; i++) {
+				LatticeValue operand = sccp->values[instr->operands[i]->id];
+
+				if (operand.kind != CONSTANT_LATTICE) {
+					return operand;
+				}
+
+				operands[i] = operand.constant;
+			}
+
+			long long result;
+
+			// a division by zero is left to trap at runtime
+			if (!foldConstant(instr->opcode, instr->type, operands[0], operands[1], &result)) {
+				return varying;
+			}
+
+			return (LatticeValue){CONSTANT_LATTICE, result};
+		}
+		default:
+			return varying;
+	}
+}
+
+static int markEdge(SCCP* sccp, IRBlock* block, int index) {
+
+	if (sccp->executableEdges[block->id * 2 + index]) {
+		return 1;
+	}
+
+	sccp->executableEdges[block->id * 2 + index] = true;
+	IRBlock* target = successor(block, index);
+
+	// a visited target only has to look at its phis again, the rest of it does not depend on the edge
+	if (sccp->visitedBlocks[target->id]) {
+		for (IRInstr* phi = target->first; phi != NULL && phi->opcode == PHI_IR; phi = phi->next) {
+			if (!pushValue(sccp, phi)) {
+				return 0;
+			}
+		}
+		return 1;
+	}
+
+	sccp->visitedBlocks[target->id] = true;
+	sccp->blockWorklist[sccp->blockCount++] = target;
+	return 1;
+}
+
+static int visitInstruction(SCCP* sccp, IRInstr* instr) {
+
+	if (instr->opcode == JUMP_IR) {
+		return markEdge(sccp, instr->block, 0);
+	}
+
+	if (instr->opcode == BRANCH_IR) {
+		LatticeValue condition = sccp->values[instr->operands[0]->id];
+
+		switch (condition.kind) {
+			case CONSTANT_LATTICE:
+				return markEdge(sccp, instr->block, condition.constant ? 0 : 1);
+			case VARYING_LATTICE:
+				return markEdge(sccp, instr->block, 0) && markEdge(sccp, instr->block, 1);
+			default:
+				return 1;
+		}
+	}
+
+	if (instr->type == UNKNOWN) {
+		return 1;
+	}
+
+	LatticeValue* current = &sccp->values[instr->id];
+	LatticeValue value = evaluate(sccp, instr);
+
+	if (value.kind == current->kind && value.constant == current->constant) {
+		return 1;
+	}
+
+	*current = value;
+
+	for (int i = sccp->userStart[instr->id]; i < sccp->userStart[instr->id + 1]; i++) {
+		IRInstr* user = sccp->users[i];
+
+		// users in blocks that were not reached yet are evaluated once they are
+		if (user->block != NULL && sccp->visitedBlocks[user->block->id] && !pushValue(sccp, user)) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static int solve(SCCP* sccp) {
+
+	IRBlock* entry = sccp->function->blocks->array[0];
+	sccp->visitedBlocks[entry->id] = true;
+	sccp->blockWorklist[sccp->blockCount++] = entry;
+
+	while (sccp->blockCount > 0 || sccp->valueCount > 0) {
+
+		while (sccp->valueCount > 0) {
+			if (!visitInstruction(sccp, sccp->valueWorklist[--sccp->valueCount])) {
+				return 0;
+			}
+		}
+
+		if (sccp->blockCount > 0) {
+			IRBlock* block = sccp->blockWorklist[--sccp->blockCount];
+
+			for (IRInstr* instr = block->first; instr != NULL; instr = instr->next) {
+				if (!visitInstruction(sccp, instr)) {
+					return 0;
+				}
+			}
+		}
+	}
+
+	return 1;
+}
+
+// constants go to the entry block, which dominates every use
+static int rewriteConstants(SCCP* sccp) {
+
+	IRFunction* function = sccp->function;
+	IRBlock* entry = function->blocks->array[0];
+
+	for (int i = 0; i < function->blocks->size; i++) {
+		IRBlock* block = function->blocks->array[i];
+
+		if (!sccp->visitedBlocks[block->id]) {
+			continue;
+		}
+
+		IRInstr* instr = block->first;
+
+		while (instr != NULL) {
+			IRInstr* next = instr->next;
+			LatticeValue value = sccp->values[instr->id];
+
+			if (instr->opcode != CONST_IR && instr->type != UNKNOWN && value.kind == CONSTANT_LATTICE && !hasSideEffects(instr)) {
+				IRInstr* constant = irConstant(function, instr->type, value.constant);
+
+				if (constant == NULL) {
+					return 0;
+				}
+
+				prependIR(entry, constant);
+				instr->replacement = constant;
+				removeIR(instr);
+			}
+
+			instr = next;
+		}
+
+		// only one side of the branch is ever taken
+		IRInstr* branch = block->last;
+
+		if (branch != NULL && branch->opcode == BRANCH_IR && sccp->executableEdges[block->id * 2] != sccp->executableEdges[block->id * 2 + 1]) {
+			int taken = sccp->executableEdges[block->id * 2] ? 0 : 1;
+			IRBlock* dropped = branch->targets[1 - taken];
+
+			branch->opcode = JUMP_IR;
+			branch->operandCount = 0;
+			branch->targets[0] = branch->targets[taken];
+			branch->targets[1] = NULL;
+
+			removePredecessor(dropped, predecessorIndex(dropped, block));
+		}
+	}
+
+	// the blocks that were never reached go with their phi operands, a phi that is left with a
+	// single operand has no edge to copy on anymore and becomes that operand
+	bool changed = false;
+
+	if (!removeUnreachableBlocks(function, &changed)) {
+		return 0;
+	}
+
+	for (int i = 1; i < function->blocks->size; i++) {
+		IRBlock* block = function->blocks->array[i];
+
+		for (IRInstr* phi = block->first; block->predCount == 1 && phi != NULL && phi->opcode == PHI_IR; phi = block->first) {
+			phi->replacement = phi->operands[0];
+			removeIR(phi);
+		}
+	}
+
+	applyReplacements(function);
+	return 1;
+}
+
+int propagateConstants(IRFunction* function) {
+
+	if (function == NULL || function->blocks->size == 0) {
+		return 0;
+	}
+
+	SCCP sccp = {0};
+	sccp.function = function;
+	sccp.values = calloc(function->valueCount, sizeof(LatticeValue));
+	sccp.executableEdges = calloc(function->blockCount * 2, sizeof(bool));
+	sccp.visitedBlocks = calloc(function->blockCount, sizeof(bool));
+	sccp.blockWorklist = malloc(function->blockCount * sizeof(IRBlock*));
+
+	int success = sccp.values != NULL && sccp.executableEdges != NULL && sccp.visitedBlocks != NULL && sccp.blockWorklist != NULL
+		&& collectUsers(&sccp) && solve(&sccp) && rewriteConstants(&sccp);
+
+	free(sccp.values);
+	free(sccp.userStart);
+	free(sccp.users);
+	free(sccp.executableEdges);
+	free(sccp.visitedBlocks);
+	free(sccp.blockWorklist);
+	free(sccp.valueWorklist);
+	return success;
+}
@@ -0,0 +1,20 @@
+#ifndef IRPASSES_H
+#define IRPASSES_H
+
+#include "ir.h"
+
+// every pass returns 0 on failure and reports the error itself
+
+// sparse conditional constant propagation: folds values that are constant on every executable path
+// and turns branches on them into jumps
+int propagateConstants(IRFunction* function);
+// removes unreachable blocks, merges straight line blocks and skips empty ones
+int simplifyCFG(IRFunction* function);
+// removes instructions whose values are never used and that have no side effects
+int eliminateDeadCode(IRFunction* function);
+// removes stores to globals that are stored again on every path before anything can read them
+int eliminateDeadStores(IRFunction* function);
+// turns calls of a function to itself whose value is returned right away into a loop
+int eliminateTailRecursion(IRFunction* function);
+
+#endif
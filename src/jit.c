@@ -0,0 +1,204 @@
+#include "jit.h"
+#include "encoder.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+typedef struct ExternalSymbol {
+	const char* name;
+	void* address;
+} ExternalSymbol;
+
+// the functions the generated code may call, taken from this process
+static const ExternalSymbol externals[] = {
+	{"printf", (void*)printf}
+};
+
+// jmp [rip+0] followed by the 64 bit target, since libc is usually out of reach of a rel32 call
+#define STUB_SIZE 16
+
+static size_t alignSize(size_t size, size_t align) {
+	return (size + align - 1) / align * align;
+}
+
+static void* externalAddress(const char* name) {
+	for (size_t i = 0; i < sizeof(externals) / sizeof(externals[0]); i++) {
+		if (strcmp(externals[i].name, name) == 0) {
+			return externals[i].address;
+		}
+	}
+	return NULL;
+}
+
+static unsigned char* writeStub(unsigned char* stub, void* address) {
+	static const unsigned char jump[] = {0xFF, 0x25, 0x00, 0x00, 0x00, 0x00};
+	uint64_t target = (uintptr_t)address;
+
+	memcpy(stub, jump, sizeof(jump));
+	memcpy(stub + sizeof(jump), &target, 8);
+	return stub;
+}
+
+// every symbol gets its address in the mapping, undefined ones the address of their stub
+static int resolveSymbols(MachineCode* code, unsigned char* text, unsigned char* stubs, unsigned char* data, unsigned char** addresses) {
+
+	int stubCount = 0;
+
+	for (int i = 0; i < code->symbolCount; i++) {
+		CodeSymbol* symbol = &code->symbols[i];
+
+		switch (symbol->section) {
+			case TEXT_SECTION:
+				addresses[i] = text + symbol->offset;
+				break;
+			case DATA_SECTION:
+				addresses[i] = data + symbol->offset;
+				break;
+			case UNDEFINED_SECTION: {
+				void* address = externalAddress(symbol->name);
+
+				if (address == NULL) {
+					fprintf(stderr, "Error: Undefined symbol \"%s\"\n", symbol->name);
+					return 0;
+				}
+
+				addresses[i] = writeStub(stubs + stubCount++ * STUB_SIZE, address);
+				break;
+			}
+		}
+	}
+
+	return 1;
+}
+
+static int applyRelocations(MachineCode* code, unsigned char* text, unsigned char** addresses) {
+
+	for (int i = 0; i < code->relocationCount; i++) {
+		Relocation* relocation = &code->relocations[i];
+		unsigned char* field = text + relocation->offset;
+		intptr_t target = (intptr_t)addresses[relocation->symbol] + relocation->addend;
+
+		if (relocation->kind == ABSOLUTE_RELOCATION) {
+			uint64_t value = target;
+			memcpy(field, &value, 8);
+			continue;
+		}
+
+		intptr_t distance = target - (intptr_t)field;
+
+		if (distance < INT32_MIN || distance > INT32_MAX) {
+			fprintf(stderr, "Error: Symbol \"%s\" is out of reach\n", code->symbols[relocation->symbol].name);
+			return 0;
+		}
+
+		int32_t value = (int32_t)distance;
+		memcpy(field, &value, 4);
+	}
+
+	return 1;
+}
+
+LoadedProgram* loadMachineCode(MachineCode* code) {
+
+	if (code == NULL) {
+		return NULL;
+	}
+
+	int stubCount = 0;
+	for (int i = 0; i < code->symbolCount; i++) {
+		stubCount += code->symbols[i].section == UNDEFINED_SECTION;
+	}
+
+	// text and stubs share the executable pages, the data follows on its own writable pages
+	size_t pageSize = sysconf(_SC_PAGESIZE);
+	size_t stubOffset = alignSize(code->text.size, STUB_SIZE);
+	size_t textSize = alignSize(stubOffset + stubCount * STUB_SIZE, pageSize);
+	size_t dataSize = alignSize(code->data.size, pageSize);
+
+	unsigned char* memory = mmap(NULL, textSize + dataSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (memory == MAP_FAILED) {
+		fprintf(stderr, "Error: Could not map memory for the program\n");
+		return NULL;
+	}
+
+	unsigned char* text = memory;
+	unsigned char* data = memory + textSize;
+	memcpy(text, code->text.bytes, code->text.size);
+	memcpy(data, code->data.bytes, code->data.size);
+
+	unsigned char** addresses = malloc(code->symbolCount * sizeof(unsigned char*));
+
+	int success = addresses != NULL
+		&& resolveSymbols(code, text, text + stubOffset, data, addresses)
+		&& applyRelocations(code, text, addresses);
+
+	free(addresses);
+
+	if (success && mprotect(text, textSize, PROT_READ | PROT_EXEC) != 0) {
+		fprintf(stderr, "Error: Could not make the program executable\n");
+		success = 0;
+	}
+
+	LoadedProgram* program = success ? malloc(sizeof(LoadedProgram)) : NULL;
+
+	if (program == NULL) {
+		munmap(memory, textSize + dataSize);
+		return NULL;
+	}
+
+	program->code = code;
+	program->memory = memory;
+	program->size = textSize + dataSize;
+	program->text = text;
+	return program;
+}
+
+void* findFunction(LoadedProgram* program, const char* name) {
+
+	int symbol = findCodeSymbol(program->code, name);
+
+	if (symbol < 0 || program->code->symbols[symbol].section != TEXT_SECTION) {
+		return NULL;
+	}
+
+	return program->text + program->code->symbols[symbol].offset;
+}
+
+void unloadProgram(LoadedProgram* program) {
+	if (program == NULL) return;
+	munmap(program->memory, program->size);
+	free(program);
+}
+
+int runMachineCode(MachineCode* code, int* result) {
+
+	if (code == NULL || result == NULL) {
+		return 0;
+	}
+
+	LoadedProgram* program = loadMachineCode(code);
+
+	if (program == NULL) {
+		return 0;
+	}
+
+	int (*function)(void) = (int (*)(void))findFunction(program, "main");
+
+	if (function == NULL) {
+		fprintf(stderr, "Error: No function \"main\" to run\n");
+		unloadProgram(program);
+		return 0;
+	}
+
+	// output of the compiler must not end up behind the output of the program
+	fflush(stdout);
+	*result = function();
+	fflush(stdout);
+
+	unloadProgram(program);
+	return 1;
+}
@@ -0,0 +1,25 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "encoder.h"
+#include <stddef.h>
+
+typedef struct LoadedProgram LoadedProgram;
+
+// the program mapped into executable memory of this process
+struct LoadedProgram {
+	MachineCode* code;
+	unsigned char* memory;
+	size_t size;
+	unsigned char* text;
+};
+
+LoadedProgram* loadMachineCode(MachineCode* code);
+// address of a function of the loaded program, NULL if it has none of that name
+void* findFunction(LoadedProgram* program, const char* name);
+void unloadProgram(LoadedProgram* program);
+
+// maps the encoded program into executable memory of this process and calls its main
+int runMachineCode(MachineCode* code, int* result);
+
+#endif
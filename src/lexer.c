@@ -1,8 +1,297 @@
 #include "lexer.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAS_X86_SCAN
+#endif
+
+// every scan function returns the index of the first character at or after idx that is not part of the scanned class
+// the buffer is required to be NUL terminated, which ends every class
+typedef int (*ScanFunc)(const char* buff, int idx);
+
+struct Scanner {
+	ScanMode mode;
+	ScanFunc skipWhitespace;
+	ScanFunc scanWord;
+	ScanFunc scanDigits;
+};
+
+static int skipWhitespaceScalar(const char* buff, int idx) {
+	while (buff[idx] == ' ' || buff[idx] == '\n' || buff[idx] == '\t' || buff[idx] == '\r') {
+		idx++;
+	}
+	return idx;
+}
+
+static int scanWordScalar(const char* buff, int idx) {
+	while (isalnum(buff[idx])) {
+		idx++;
+	}
+	return idx;
+}
+
+static int scanDigitsScalar(const char* buff, int idx) {
+	while (isdigit(buff[idx])) {
+		idx++;
+	}
+	return idx;
+}
+
+static const Scanner scalarScanner = { SCALAR_SCAN, skipWhitespaceScalar, scanWordScalar, scanDigitsScalar };
+
+#ifdef HAS_X86_SCAN
+
+// The vector scanners only ever load whole aligned blocks. An aligned block that contains at least one byte of the
+// buffer (which always holds the terminating NUL) can never cross into an unmapped page, but it may read bytes
+// before the start or past the end of the allocation, so these functions are excluded from address sanitizing.
+// Bytes before idx are masked out of the result.
+
+// signed compare trick, SSE2 and AVX2 only offer signed byte compares: x in [lo, lo+n) <=> (x - lo) ^ 0x80 < n - 128
+#define SSE2_IN_RANGE(chunk, lo, n) _mm_cmplt_epi8(_mm_xor_si128(_mm_sub_epi8(chunk, _mm_set1_epi8(lo)), _mm_set1_epi8((char)0x80)), _mm_set1_epi8((char)((n) - 128)))
+#define AVX2_IN_RANGE(chunk, lo, n) _mm256_cmpgt_epi8(_mm256_set1_epi8((char)((n) - 128)), _mm256_xor_si256(_mm256_sub_epi8(chunk, _mm256_set1_epi8(lo)), _mm256_set1_epi8((char)0x80)))
+
+static inline __m128i sse2Whitespace(__m128i chunk) {
+	__m128i spaces = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')));
+	__m128i tabs = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')));
+	return _mm_or_si128(spaces, tabs);
+}
+
+static inline __m128i sse2Alnum(__m128i chunk) {
+	__m128i digits = SSE2_IN_RANGE(chunk, '0', 10);
+	__m128i letters = SSE2_IN_RANGE(_mm_or_si128(chunk, _mm_set1_epi8(0x20)), 'a', 26);
+	return _mm_or_si128(digits, letters);
+}
+
+static inline __m128i sse2Digits(__m128i chunk) {
+	return SSE2_IN_RANGE(chunk, '0', 10);
+}
+
+#define SSE2_SCAN_LOOP(classify) \
+	if (((uintptr_t)(buff + idx) & 4095) <= 4096 - 16) { \
+		__m128i first = _mm_loadu_si128((const __m128i*)(buff + idx)); \
+		unsigned int outside = ~(unsigned int)_mm_movemask_epi8(classify(first)) & 0xFFFF; \
+		if (outside) { \
+			return idx + __builtin_ctz(outside); \
+		} \
+	} \
+	const char* block = (const char*)((uintptr_t)(buff + idx) & ~(uintptr_t)15); \
+	unsigned int before = (unsigned int)((buff + idx) - block); \
+	for (;;) { \
+		__m128i chunk = _mm_load_si128((const __m128i*)block); \
+		unsigned int outside = ~(unsigned int)_mm_movemask_epi8(classify(chunk)) & 0xFFFF; \
+		outside = (outside >> before) << before; \
+		if (outside) { \
+			return (int)(block - buff) + __builtin_ctz(outside); \
+		} \
+		block += 16; \
+		before = 0; \
+	}
+
+__attribute__((no_sanitize_address))
+static int skipWhitespaceSSE2(const char* buff, int idx) {
+	// most tokens are separated by at most one character, dont bother loading a vector for those
+	if (buff[idx] != ' ' && buff[idx] != '\n' && buff[idx] != '\t' && buff[idx] != '\r') {
+		return idx;
+	}
+	SSE2_SCAN_LOOP(sse2Whitespace)
+}
+
+__attribute__((no_sanitize_address))
+static int scanWordSSE2(const char* buff, int idx) {
+	SSE2_SCAN_LOOP(sse2Alnum)
+}
+
+__attribute__((no_sanitize_address))
+static int scanDigitsSSE2(const char* buff, int idx) {
+	SSE2_SCAN_LOOP(sse2Digits)
+}
+
+static const Scanner sse2Scanner = { SSE2_SCAN, skipWhitespaceSSE2, scanWordSSE2, scanDigitsSSE2 };
+
+__attribute__((target("avx2")))
+static inline __m256i avx2Whitespace(__m256i chunk) {
+	__m256i spaces = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')));
+	__m256i tabs = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r')));
+	return _mm256_or_si256(spaces, tabs);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2Alnum(__m256i chunk) {
+	__m256i digits = AVX2_IN_RANGE(chunk, '0', 10);
+	__m256i letters = AVX2_IN_RANGE(_mm256_or_si256(chunk, _mm256_set1_epi8(0x20)), 'a', 26);
+	return _mm256_or_si256(digits, letters);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2Digits(__m256i chunk) {
+	return AVX2_IN_RANGE(chunk, '0', 10);
+}
+
+#define AVX2_SCAN_LOOP(classify) \
+	if (((uintptr_t)(buff + idx) & 4095) <= 4096 - 32) { \
+		__m256i first = _mm256_loadu_si256((const __m256i*)(buff + idx)); \
+		uint64_t outside = ~(uint64_t)(uint32_t)_mm256_movemask_epi8(classify(first)) & 0xFFFFFFFFull; \
+		if (outside) { \
+			return idx + __builtin_ctzll(outside); \
+		} \
+	} \
+	const char* block = (const char*)((uintptr_t)(buff + idx) & ~(uintptr_t)31); \
+	unsigned int before = (unsigned int)((buff + idx) - block); \
+	for (;;) { \
+		__m256i chunk = _mm256_load_si256((const __m256i*)block); \
+		uint64_t outside = ~(uint64_t)(uint32_t)_mm256_movemask_epi8(classify(chunk)) & 0xFFFFFFFFull; \
+		outside = (outside >> before) << before; \
+		if (outside) { \
+			return (int)(block - buff) + __builtin_ctzll(outside); \
+		} \
+		block += 32; \
+		before = 0; \
+	}
+
+__attribute__((no_sanitize_address, target("avx2")))
+static int skipWhitespaceAVX2(const char* buff, int idx) {
+	if (buff[idx] != ' ' && buff[idx] != '\n' && buff[idx] != '\t' && buff[idx] != '\r') {
+		return idx;
+	}
+	AVX2_SCAN_LOOP(avx2Whitespace)
+}
+
+__attribute__((no_sanitize_address, target("avx2")))
+static int scanWordAVX2(const char* buff, int idx) {
+	AVX2_SCAN_LOOP(avx2Alnum)
+}
+
+__attribute__((no_sanitize_address, target("avx2")))
+static int scanDigitsAVX2(const char* buff, int idx) {
+	AVX2_SCAN_LOOP(avx2Digits)
+}
+
+static const Scanner avx2Scanner = { AVX2_SCAN, skipWhitespaceAVX2, scanWordAVX2, scanDigitsAVX2 };
+
+#endif
+
+// picks the widest scanner the cpu supports, cpuid is only queried once
+ScanMode detectScanMode(void) {
+	static int detected = 0;
+	static ScanMode mode = SCALAR_SCAN;
+
+	if (!detected) {
+#ifdef HAS_X86_SCAN
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) {
+			mode = AVX2_SCAN;
+		}
+		else if (__builtin_cpu_supports("sse2")) {
+			mode = SSE2_SCAN;
+		}
+#endif
+		detected = 1;
+	}
+
+	return mode;
+}
+
+static const Scanner* getScanner(ScanMode mode) {
+	switch (mode) {
+#ifdef HAS_X86_SCAN
+		case AVX2_SCAN:
+			return &avx2Scanner;
+		case SSE2_SCAN:
+			return &sse2Scanner;
+#endif
+		case SCALAR_SCAN:
+			return &scalarScanner;
+		default:
+			return NULL;
+	}
+}
+
+// only takes effect for tokens scanned afterwards, use setLexerBuffer to restart from the beginning
+int setLexerScanMode(Lexer* lexer, ScanMode mode) {
+	if (lexer == NULL) {
+		return 0;
+	}
+
+	const Scanner* scanner = getScanner(mode);
+
+	if (scanner == NULL || mode > detectScanMode()) {
+		return 0;
+	}
+
+	lexer->scanner = scanner;
+	return 1;
+}
+
+const char* scanModeName(ScanMode mode) {
+	switch (mode) {
+		case SCALAR_SCAN:
+			return "scalar";
+		case SSE2_SCAN:
+			return "sse2";
+		case AVX2_SCAN:
+			return "avx2";
+		default:
+			return "unknown";
+	}
+}
+
+// checks that a vectorized scanner produces exactly the same token stream as the scalar one
+int compareScanModes(char* buffer, ScanMode mode) {
+
+	Lexer* scalar = initializeLexer(buffer);
+	Lexer* vector = initializeLexer(buffer);
+
+	if (scalar == NULL || vector == NULL) {
+		freeLexer(scalar);
+		freeLexer(vector);
+		return 0;
+	}
+
+	setLexerScanMode(scalar, SCALAR_SCAN);
+	setLexerScanMode(vector, mode);
+	setLexerBuffer(scalar, buffer);
+	setLexerBuffer(vector, buffer);
+
+	long tokens = 0;
+	int equal = 1;
+
+	for (;;) {
+		Token* expected = peekToken(scalar);
+		Token* actual = peekToken(vector);
+
+		if (expected == NULL || actual == NULL) {
+			equal = expected == actual;
+			break;
+		}
+
+		if (expected->type != actual->type || expected->start != actual->start || expected->length != actual->length) {
+			equal = 0;
+			break;
+		}
+
+		if (expected->type == E_O_F) {
+			break;
+		}
+
+		advanceToken(scalar);
+		advanceToken(vector);
+		tokens++;
+	}
+
+	if (!equal) {
+		fprintf(stderr, "Error: %s lexer differs from the scalar lexer after %ld tokens\n", scanModeName(mode), tokens);
+	}
+
+	freeLexer(scalar);
+	freeLexer(vector);
+	return equal;
+}
 
 Lexer* initializeLexer(char* b) {
 	Lexer* lexer = calloc(1, sizeof(Lexer));
@@ -13,9 +302,9 @@ Lexer* initializeLexer(char* b) {
 
 	lexer->buff= b;
 	lexer->idx = 0;
-	lexer->currentToken = getToken(lexer);
+	lexer->scanner = getScanner(detectScanMode());
 
-	if (lexer->currentToken == NULL) {
+	if (!getToken(lexer, &lexer->currentToken)) {
 		freeLexer(lexer);
 		return NULL;
 	}
@@ -27,7 +316,6 @@ void freeLexer(Lexer* lexer) {
 	if (lexer == NULL) {
 		return;
 	}
-	free(lexer->currentToken);
 	free(lexer);
 }
 
@@ -38,34 +326,83 @@ int setLexerBuffer(Lexer* lexer, char* buffer) {
 
 	lexer->buff = buffer;
 	lexer->idx = 0;
-	lexer->currentToken = getToken(lexer);
+	lexer->failed = 0;
+	lexer->lookaheadStart = 0;
+	lexer->lookaheadCount = 0;
 
-	if (lexer->currentToken == NULL) {
-		freeLexer(lexer);
+	if (!getToken(lexer, &lexer->currentToken)) {
+		lexer->failed = 1;
 		return 0;
 	}
 
 	return 1;
 }
 
-Token* getToken(Lexer* lexer) {
-
-	if (lexer == NULL) {
-		return NULL;
+// keywords are matched by length and first character, so every word is compared against at most one keyword
+TokenType classifyWord(const char* word, int length) {
+	switch (length) {
+		case 2:
+			if (word[0] == 'i' && word[1] == 'f') return IF;
+			break;
+		case 3:
+			switch (word[0]) {
+				case 'i':
+					if (memcmp(word, "i16", 3) == 0) return I16;
+					if (memcmp(word, "i32", 3) == 0) return I32;
+					if (memcmp(word, "i64", 3) == 0) return I64;
+					break;
+				case 'f':
+					if (memcmp(word, "f32", 3) == 0) return F32;
+					if (memcmp(word, "f64", 3) == 0) return F64;
+					break;
+				case 's':
+					if (memcmp(word, "str", 3) == 0) return STR;
+					break;
+			}
+			break;
+		case 4:
+			switch (word[0]) {
+				case 'e':
+					if (memcmp(word, "else", 4) == 0) return ELSE;
+					break;
+				case 'b':
+					if (memcmp(word, "bool", 4) == 0) return BOOL;
+					break;
+				case 'c':
+					if (memcmp(word, "char", 4) == 0) return CHAR;
+					break;
+				case 't':
+					if (memcmp(word, "true", 4) == 0) return TRUE;
+					break;
+			}
+			break;
+		case 5:
+			switch (word[0]) {
+				case 'w':
+					if (memcmp(word, "while", 5) == 0) return WHILE;
+					break;
+				case 'f':
+					if (memcmp(word, "false", 5) == 0) return FALSE;
+					break;
+			}
+			break;
+		case 6:
+			if (memcmp(word, "return", 6) == 0) return RETURN;
+			break;
 	}
 
-	char* buff = lexer->buff;
+	return ID;
+}
 
-	while (buff[lexer->idx] == ' ' || buff[lexer->idx] == '\n' || buff[lexer->idx] == '\t' || buff[lexer->idx] == '\r') {
-		lexer->idx++;
+int getToken(Lexer* lexer, Token* token) {
+
+	if (lexer == NULL || token == NULL) {
+		return 0;
 	}
 
-	Token* token = malloc(sizeof(Token));
+	char* buff = lexer->buff;
 
-	if (token == NULL) {
-		fprintf(stderr, "Error: Failed to allocate token in lexer");
-		return NULL;
-	}
+	lexer->idx = lexer->scanner->skipWhitespace(buff, lexer->idx);
 
 	token->start = &buff[lexer->idx];
 	token->length = 1;
@@ -73,8 +410,10 @@ Token* getToken(Lexer* lexer) {
 	switch (buff[lexer->idx]) {
 
 		case '\0':
+			// the end of the buffer is never consumed, so it can be scanned again safely
 			token->type = E_O_F;
-			return token;
+			token->length = 0;
+			return 1;
 		case ',':
 			token->type = COLON;
 			break;
@@ -156,155 +495,99 @@ Token* getToken(Lexer* lexer) {
 			while (buff[lexer->idx + token->length] != '"' && buff[lexer->idx + token->length] != '\0') {
 				token->length++;
 			}
-			token->length++; 
+			// an unterminated literal must not swallow the terminating NUL
+			if (buff[lexer->idx + token->length] != '\0') {
+				token->length++;
+			} 
 			break;
 		case '\'':
 			token->type = SQUOTE;
 			while (buff[lexer->idx + token->length] != '\'' && buff[lexer->idx + token->length] != '\0') {
 				token->length++;
 			}
-			token->length++;
+			// an unterminated literal must not swallow the terminating NUL
+			if (buff[lexer->idx + token->length] != '\0') {
+				token->length++;
+			}
 			break;
 		default:
 
 			if (isdigit(buff[lexer->idx])) {
 				token->type = NUM;
 				bool isFloat = false;
-				while (isdigit(buff[lexer->idx + token->length]) || buff[lexer->idx + token->length] == '.') {
-					if (buff[lexer->idx + token->length] == '.') {
-						if (isFloat) {
-							fprintf(stderr, "INVALID NUMBER TOKEN WITH MORE THAN ONE FLOAT IDENTIFIER\n");
-							free(token);
-							return NULL;
-						}
-						isFloat = true;
-						token->type = FNUM;
+				for (;;) {
+					token->length = lexer->scanner->scanDigits(buff, lexer->idx + token->length) - lexer->idx;
+					if (buff[lexer->idx + token->length] != '.') {
+						break;
 					}
+					if (isFloat) {
+						fprintf(stderr, "INVALID NUMBER TOKEN WITH MORE THAN ONE FLOAT IDENTIFIER\n");
+						return 0;
+					}
+					isFloat = true;
+					token->type = FNUM;
 					token->length++;
 				}
 			}
 
 			else if (isalpha(buff[lexer->idx])) {
-
-				if (buff[lexer->idx] == 'i' && buff[lexer->idx+1] == 'f' && !isalnum(buff[lexer->idx+2])) {
-					token->type = IF;
-					token->length = 2;
-					break;
-				}
-
-				if (buff[lexer->idx] == 'e' && buff[lexer->idx+1] == 'l' && buff[lexer->idx+2] == 's' && buff[lexer->idx+3] == 'e' && !isalnum(buff[lexer->idx+4])) {
-					token->type = ELSE;
-					token->length = 4;
-					break;
-				}
-
-				if (buff[lexer->idx] == 'w' && buff[lexer->idx+1] == 'h' && buff[lexer->idx+2] == 'i' && buff[lexer->idx+3] == 'l' && buff[lexer->idx+4] == 'e' && !isalnum(buff[lexer->idx+5])) {
-					token->type = WHILE;
-					token->length = 5;
-					break;
-				}
-
-				if (buff[lexer->idx] == 'b' && buff[lexer->idx+1] == 'o' && buff[lexer->idx+2] == 'o' && buff[lexer->idx+3] == 'l' && !isalnum(buff[lexer->idx+4])) {
-					token->type = BOOL;
-					token->length = 4;
-					break;
-				}
-
-				if (buff[lexer->idx] == 'i' && buff[lexer->idx+1] == '1' && buff[lexer->idx+2] == '6') {
-					token->type = I16;
-					token->length = 3;
-					break;
-				}
-
-				if (buff[lexer->idx] == 'i' && buff[lexer->idx+1] == '3' && buff[lexer->idx+2] == '2') {
-					token->type = I32;
-					token->length = 3;
-					break;
-				}
-
-				if (buff[lexer->idx] == 'i' && buff[lexer->idx+1] == '6' && buff[lexer->idx+2] == '4') {
-					token->type = I64;
-					token->length = 3;
-					break;
-				}
-
-				if (buff[lexer->idx] == 'f' && buff[lexer->idx+1] == '3' && buff[lexer->idx+2] == '2') {
-					token->type = F32;
-					token->length = 3;
-					break;
-				}
-
-				if (buff[lexer->idx] == 'f' && buff[lexer->idx+1] == '6' && buff[lexer->idx+2] == '4') {
-					token->type = F64;
-					token->length = 3;
-					break;
-				}
-
-				if (buff[lexer->idx] == 'c' && buff[lexer->idx+1] == 'h' && buff[lexer->idx+2] == 'a' && buff[lexer->idx+3] == 'r' && !isalnum(buff[lexer->idx+4])) {
-					token->type = CHAR;
-					token->length = 4;
-					break;
-				}
-
-				if (buff[lexer->idx] == 's' && buff[lexer->idx+1] == 't' && buff[lexer->idx+2] == 'r' && !isalnum(buff[lexer->idx+3])) {
-					token->type = STR;
-					token->length = 3;
-					break;
-				}
-
-				if (buff[lexer->idx] == 'r' && buff[lexer->idx+1] == 'e' && buff[lexer->idx+2] == 't' && buff[lexer->idx+3] == 'u' && buff[lexer->idx+4] == 'r' && buff[lexer->idx+5] == 'n' && !isalnum(buff[lexer->idx+6])) {
-					token->type = RETURN;
-					token->length = 6;
-					break;
-				}
-
-				if (buff[lexer->idx] == 't' && buff[lexer->idx+1] == 'r' && buff[lexer->idx+2] == 'u' && buff[lexer->idx+3] == 'e' && !isalnum(buff[lexer->idx+4])) {
-					token->type = TRUE;
-					token->length = 4;
-					break;
-				}
-
-				if (buff[lexer->idx] == 'f' && buff[lexer->idx+1] == 'a' && buff[lexer->idx+2] == 'l' && buff[lexer->idx+3] == 's' && buff[lexer->idx+4] == 'e' && !isalnum(buff[lexer->idx+5])) {
-					token->type = FALSE;
-					token->length = 5;
-					break;
-				}
-
-				token->type = ID;
-				while (isalnum(buff[lexer->idx + token->length])) {
-					token->length++;
-				}
+				// scan the whole word once and only then decide wether it is a keyword
+				token->length = lexer->scanner->scanWord(buff, lexer->idx + token->length) - lexer->idx;
+				token->type = classifyWord(token->start, token->length);
 			}
 			
 			else {
 				fprintf(stderr, "Unexpected Token: %c\n", buff[lexer->idx]);
-				free(token);
-				return NULL;
+				return 0;
 			}
 	}
 
-	return token;
+	lexer->idx += token->length;
+	return 1;
 }
 
 Token* peekToken(Lexer* lexer) {
-	if (lexer == NULL) {
+	if (lexer == NULL || lexer->failed) {
+		return NULL;
+	}
+	return &lexer->currentToken;
+}
+
+// returns the token n positions after the current one, scanning it into the lookahead ring if necessary
+Token* peekTokenAhead(Lexer* lexer, int n) {
+	if (lexer == NULL || lexer->failed || n < 0 || n > LOOKAHEAD_SIZE) {
 		return NULL;
 	}
-	return lexer->currentToken;
+
+	if (n == 0) {
+		return &lexer->currentToken;
+	}
+
+	while (lexer->lookaheadCount < n) {
+		Token* slot = &lexer->lookahead[(lexer->lookaheadStart + lexer->lookaheadCount) % LOOKAHEAD_SIZE];
+		if (!getToken(lexer, slot)) {
+			return NULL;
+		}
+		lexer->lookaheadCount++;
+	}
+
+	return &lexer->lookahead[(lexer->lookaheadStart + n - 1) % LOOKAHEAD_SIZE];
 }
 
 void advanceToken(Lexer* lexer) {
 
-	if (lexer == NULL) {
+	if (lexer == NULL || lexer->failed) {
 		return;
 	}
 
-	if (lexer->currentToken == NULL) {
+	if (lexer->lookaheadCount > 0) {
+		lexer->currentToken = lexer->lookahead[lexer->lookaheadStart];
+		lexer->lookaheadStart = (lexer->lookaheadStart + 1) % LOOKAHEAD_SIZE;
+		lexer->lookaheadCount--;
 		return;
 	}
 
-	lexer->idx += lexer->currentToken->length;
-
-	free(lexer->currentToken);
-	lexer->currentToken = getToken(lexer);
+	if (!getToken(lexer, &lexer->currentToken)) {
+		lexer->failed = 1;
+	}
 }
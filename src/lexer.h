@@ -5,6 +5,14 @@
 
 typedef struct Lexer Lexer;
 typedef struct Token Token;
+typedef struct Scanner Scanner;
+
+// implementations used for skipping whitespace and finding the end of words and numbers
+typedef enum {
+	SCALAR_SCAN,
+	SSE2_SCAN,
+	AVX2_SCAN
+} ScanMode;
 
 typedef enum {
 	E_O_F,
@@ -50,11 +58,8 @@ typedef enum {
 	ID,
 } TokenType;
 
-struct Lexer {
-	char* buff;
-	int idx;
-	Token* currentToken;
-};
+// maximum amount of tokens that can be looked at past the current one
+#define LOOKAHEAD_SIZE 4
 
 struct Token {
 	TokenType type;
@@ -62,11 +67,30 @@ struct Token {
 	int length;
 };
 
+// tokens are stored by value, the lexer never allocates while scanning
+// idx always points behind the last scanned token, which is either the current one or the last one in the lookahead ring
+struct Lexer {
+	char* buff;
+	int idx;
+	int failed;
+	Token currentToken;
+	Token lookahead[LOOKAHEAD_SIZE];
+	int lookaheadStart;
+	int lookaheadCount;
+	const Scanner* scanner;
+};
+
 Lexer* initializeLexer(char* b);
 void freeLexer(Lexer* lexer);
 int setLexerBuffer(Lexer* lexer, char* buffer);
-Token* getToken(Lexer* lexer);
+int getToken(Lexer* lexer, Token* token);
+TokenType classifyWord(const char* word, int length);
 Token* peekToken(Lexer* lexer);
+Token* peekTokenAhead(Lexer* lexer, int n);
 void advanceToken(Lexer* lexer);
+ScanMode detectScanMode(void);
+int setLexerScanMode(Lexer* lexer, ScanMode mode);
+const char* scanModeName(ScanMode mode);
+int compareScanModes(char* buffer, ScanMode mode);
 
 #endif
@@ -0,0 +1,260 @@
+#include "machineIR.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void freeMachineFunction(void* function);
+
+Operand noOperand() {
+	Operand operand = {0};
+	operand.kind = NO_OPERAND;
+	return operand;
+}
+
+Operand registerOperand(Register reg, int size) {
+	Operand operand = {0};
+	operand.kind = REGISTER_OPERAND;
+	operand.size = size;
+	operand.as.reg = reg;
+	return operand;
+}
+
+Operand immediateOperand(long long immediate, int size) {
+	Operand operand = {0};
+	operand.kind = IMMEDIATE_OPERAND;
+	operand.size = size;
+	operand.as.immediate = immediate;
+	return operand;
+}
+
+Operand frameOperand(int offset, int size) {
+	Operand operand = {0};
+	operand.kind = FRAME_OPERAND;
+	operand.size = size;
+	operand.base = RBP_REG;
+	operand.as.offset = offset;
+	return operand;
+}
+
+Operand globalOperand(char* symbol, int size) {
+	Operand operand = {0};
+	operand.kind = GLOBAL_OPERAND;
+	operand.size = size;
+	operand.as.symbol = symbol;
+	return operand;
+}
+
+Operand symbolOperand(char* symbol) {
+	Operand operand = {0};
+	operand.kind = SYMBOL_OPERAND;
+	operand.size = 8;
+	operand.as.symbol = symbol;
+	return operand;
+}
+
+Operand labelOperand(LabelKind kind, int number) {
+	Operand operand = {0};
+	operand.kind = LABEL_OPERAND;
+	operand.as.label.kind = kind;
+	operand.as.label.number = number;
+	return operand;
+}
+
+bool isVirtualRegister(Operand* operand) {
+	return operand->kind == REGISTER_OPERAND && operand->as.reg >= FIRST_VIRTUAL_REG;
+}
+
+// the destination of these is an input as well, like the left operand of add
+bool readsDestination(Opcode opcode) {
+	switch (opcode) {
+		case ADD_INSTR:
+		case SUB_INSTR:
+		case IMUL_INSTR:
+		case IDIV_INSTR:
+		case NEG_INSTR:
+		case CMP_INSTR:
+		case TEST_INSTR:
+		case PUSH_INSTR:
+			return true;
+		default:
+			return false;
+	}
+}
+
+bool writesDestination(Opcode opcode) {
+	switch (opcode) {
+		case MOV_INSTR:
+		case MOVZX_INSTR:
+		case ADD_INSTR:
+		case SUB_INSTR:
+		case IMUL_INSTR:
+		case NEG_INSTR:
+		case SETCC_INSTR:
+		case POP_INSTR:
+			return true;
+		default:
+			return false;
+	}
+}
+
+// the condition that holds exactly when this one does not
+Condition invertCondition(Condition condition) {
+	switch (condition) {
+		case LESS_COND: return GREATER_EQUAL_COND;
+		case LESS_EQUAL_COND: return GREATER_COND;
+		case GREATER_COND: return LESS_EQUAL_COND;
+		case GREATER_EQUAL_COND: return LESS_COND;
+		case EQUAL_COND: return NOT_EQUAL_COND;
+		case NOT_EQUAL_COND: return EQUAL_COND;
+		case ZERO_COND: return NOT_ZERO_COND;
+		case NOT_ZERO_COND: return ZERO_COND;
+		default: return NO_COND;
+	}
+}
+
+// the condition for the same comparison with its operands swapped
+Condition swapCondition(Condition condition) {
+	switch (condition) {
+		case LESS_COND: return GREATER_COND;
+		case LESS_EQUAL_COND: return GREATER_EQUAL_COND;
+		case GREATER_COND: return LESS_COND;
+		case GREATER_EQUAL_COND: return LESS_EQUAL_COND;
+		default: return condition;
+	}
+}
+
+MachineModule* machineModule() {
+
+	MachineModule* module = calloc(1, sizeof(MachineModule));
+
+	if (module == NULL) {
+		return NULL;
+	}
+
+	module->globals = dynamicArray(2, free);
+	module->functions = dynamicArray(2, freeMachineFunction);
+
+	if (module->globals == NULL || module->functions == NULL) {
+		freeMachineModule(module);
+		return NULL;
+	}
+
+	return module;
+}
+
+// the id is borrowed from the ast, which outlives the module
+MachineFunction* machineFunction(MachineModule* module, char* id) {
+
+	if (module == NULL || id == NULL) {
+		return NULL;
+	}
+
+	MachineFunction* function = calloc(1, sizeof(MachineFunction));
+
+	if (function == NULL) {
+		return NULL;
+	}
+
+	function->id = id;
+	function->capacity = 64;
+	function->code = malloc(function->capacity * sizeof(MachineInstr));
+
+	if (function->code == NULL || !pushItem(module->functions, function)) {
+		freeMachineFunction(function);
+		return NULL;
+	}
+
+	return function;
+}
+
+MachineGlobal* machineGlobal(MachineModule* module, char* id, int size, long long value) {
+
+	if (module == NULL || id == NULL) {
+		return NULL;
+	}
+
+	MachineGlobal* global = malloc(sizeof(MachineGlobal));
+
+	if (global == NULL) {
+		return NULL;
+	}
+
+	global->id = id;
+	global->size = size;
+	global->value = value;
+
+	if (!pushItem(module->globals, global)) {
+		free(global);
+		return NULL;
+	}
+
+	return global;
+}
+
+Operand newVirtualRegister(MachineFunction* function, int size) {
+	return registerOperand(FIRST_VIRTUAL_REG + function->registerCount++, size);
+}
+
+static int growFunction(MachineFunction* function, int count) {
+
+	if (function->size + count <= function->capacity) {
+		return 1;
+	}
+
+	int capacity = function->capacity * 2;
+
+	while (capacity < function->size + count) {
+		capacity *= 2;
+	}
+
+	MachineInstr* code = realloc(function->code, capacity * sizeof(MachineInstr));
+
+	if (code == NULL) {
+		return 0;
+	}
+
+	function->code = code;
+	function->capacity = capacity;
+	return 1;
+}
+
+int appendInstruction(MachineFunction* function, Opcode opcode, Condition condition, Operand dst, Operand src) {
+
+	if (function == NULL || !growFunction(function, 1)) {
+		return 0;
+	}
+
+	MachineInstr* instr = &function->code[function->size++];
+	instr->opcode = opcode;
+	instr->condition = condition;
+	instr->dst = dst;
+	instr->src = src;
+	return 1;
+}
+
+// used for code that depends on the finished body, like the prologue
+int insertInstructions(MachineFunction* function, int index, MachineInstr* instructions, int count) {
+
+	if (function == NULL || index < 0 || index > function->size || !growFunction(function, count)) {
+		return 0;
+	}
+
+	memmove(function->code + index + count, function->code + index, (function->size - index) * sizeof(MachineInstr));
+	memcpy(function->code + index, instructions, count * sizeof(MachineInstr));
+	function->size += count;
+	return 1;
+}
+
+void freeMachineFunction(void* function) {
+	if (function == NULL) return;
+	free(((MachineFunction*)function)->code);
+	free(function);
+}
+
+void freeMachineModule(MachineModule* module) {
+	if (module == NULL) return;
+	freeArray(module->globals);
+	freeArray(module->functions);
+	free(module);
+}
@@ -0,0 +1,163 @@
+#ifndef MACHINEIR_H
+#define MACHINEIR_H
+
+#include "utils.h"
+#include <stdbool.h>
+
+typedef struct Operand Operand;
+typedef struct MachineInstr MachineInstr;
+typedef struct MachineFunction MachineFunction;
+typedef struct MachineGlobal MachineGlobal;
+typedef struct MachineModule MachineModule;
+
+// numbered like their hardware encoding
+typedef enum {
+	RAX_REG,
+	RCX_REG,
+	RDX_REG,
+	RBX_REG,
+	RSP_REG,
+	RBP_REG,
+	RSI_REG,
+	RDI_REG,
+	R8_REG,
+	R9_REG,
+	R10_REG,
+	R11_REG,
+	R12_REG,
+	R13_REG,
+	R14_REG,
+	R15_REG,
+	NO_REG,
+	// registers from here on are virtual, the register allocator replaces them with the ones above
+	FIRST_VIRTUAL_REG
+} Register;
+
+typedef enum {
+	NO_OPERAND,
+	REGISTER_OPERAND,
+	IMMEDIATE_OPERAND,
+	// stack slot, relative to rbp or rsp
+	FRAME_OPERAND,
+	// memory at a global data label
+	GLOBAL_OPERAND,
+	// address of a symbol, e.g. a call target
+	SYMBOL_OPERAND,
+	// jump target inside the current function
+	LABEL_OPERAND
+} OperandKind;
+
+typedef enum {
+	// numbered like the ir block it starts
+	BLOCK_LABEL,
+	RETURN_LABEL
+} LabelKind;
+
+typedef enum {
+	NO_COND,
+	LESS_COND,
+	LESS_EQUAL_COND,
+	GREATER_COND,
+	GREATER_EQUAL_COND,
+	EQUAL_COND,
+	NOT_EQUAL_COND,
+	ZERO_COND,
+	NOT_ZERO_COND
+} Condition;
+
+typedef enum {
+	MOV_INSTR,
+	MOVZX_INSTR,
+	ADD_INSTR,
+	SUB_INSTR,
+	IMUL_INSTR,
+	IDIV_INSTR,
+	// sign extends eax into edx for idiv
+	CDQ_INSTR,
+	NEG_INSTR,
+	CMP_INSTR,
+	TEST_INSTR,
+	SETCC_INSTR,
+	JMP_INSTR,
+	JCC_INSTR,
+	CALL_INSTR,
+	PUSH_INSTR,
+	POP_INSTR,
+	LEAVE_INSTR,
+	RET_INSTR,
+	// defines the label in dst, aligned to the number of bytes in src when it is an immediate
+	LABEL_INSTR
+} Opcode;
+
+// the enums are stored in single bytes to keep instructions at 40 bytes
+struct Operand {
+	unsigned char kind;
+	// width of the register or memory access in bytes
+	unsigned char size;
+	// the register a FRAME_OPERAND is relative to, rsp once the frame pointer is omitted
+	unsigned char base;
+	union {
+		Register reg;
+		long long immediate;
+		int offset;
+		char* symbol;
+		struct {
+			LabelKind kind;
+			int number;
+		} label;
+	} as;
+};
+
+struct MachineInstr {
+	unsigned char opcode;
+	// only used by SETCC_INSTR and JCC_INSTR
+	unsigned char condition;
+	Operand dst;
+	Operand src;
+};
+
+struct MachineFunction {
+	char* id;
+	int size;
+	int capacity;
+	MachineInstr* code;
+	// virtual registers handed out so far
+	int registerCount;
+	// bytes of stack slots, known once registers are allocated
+	int frameSize;
+};
+
+struct MachineGlobal {
+	char* id;
+	int size;
+	long long value;
+};
+
+// the data and functions of the program, each in the order of the source
+struct MachineModule {
+	DynamicArray* globals;
+	DynamicArray* functions;
+};
+
+Operand noOperand();
+Operand registerOperand(Register reg, int size);
+Operand immediateOperand(long long immediate, int size);
+Operand frameOperand(int offset, int size);
+Operand globalOperand(char* symbol, int size);
+Operand symbolOperand(char* symbol);
+Operand labelOperand(LabelKind kind, int number);
+bool isVirtualRegister(Operand* operand);
+bool readsDestination(Opcode opcode);
+bool writesDestination(Opcode opcode);
+Condition invertCondition(Condition condition);
+Condition swapCondition(Condition condition);
+
+MachineModule* machineModule();
+MachineFunction* machineFunction(MachineModule* module, char* id);
+MachineGlobal* machineGlobal(MachineModule* module, char* id, int size, long long value);
+Operand newVirtualRegister(MachineFunction* function, int size);
+int appendInstruction(MachineFunction* function, Opcode opcode, Condition condition, Operand dst, Operand src);
+int insertInstructions(MachineFunction* function, int index, MachineInstr* instructions, int count);
+void freeMachineModule(MachineModule* module);
+
+#endif
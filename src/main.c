@@ -1,21 +1,118 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "lexer.h"
 #include "parser.h"
+#include "resolver.h"
 #include "typeChecker.h"
+#include "irBuilder.h"
+#include "passManager.h"
 #include "codegen.h"
+#include "encoder.h"
+#include "elfWriter.h"
+#include "jit.h"
 #include "utils.h"
 
-char* parseArgs(int argc, char* argv[]) {
+typedef struct Source {
+	char* buffer;
+	size_t mappedSize;
+} Source;
+
+typedef struct Options {
+	char* filepath;
+	// write compiled.asm and assemble it with nasm instead of writing the object file directly
+	int emitAsm;
+	// run main in this process right after compiling, without any files
+	int run;
+	// picks the default pass pipeline, 0 lowers the ir straight to machine code
+	int optLevel;
+	// comma separated pass names that replace the pipeline of the optimization level
+	char* passes;
+	// print the ir after the passes ran
+	int dumpIR;
+	// check the ir after every pass
+	int verifyIR;
+	// leave the machine code as the instruction selection produced it
+	int noPeephole;
+	// print how often every peephole rule rewrote the code
+	int peepholeStats;
+	// the largest function that is inlined, -1 keeps the default of the pass
+	int inlineThreshold;
+	// print which calls were inlined
+	int inlineReport;
+	// address the stack slots through rbp in every function, so profilers can walk the stack
+	int keepFramePointer;
+} Options;
+
+Options parseArgs(int argc, char* argv[]) {
+
+	Options options = {0};
+	options.optLevel = 1;
+	options.inlineThreshold = -1;
 
-	// Currently only one argument (the about to be compiled file) is accepted
 	// TODO: Add check for custom file extension to ONLY compile files with that extension
-	if (argc != 2) {
-		fprintf(stderr, "Usage: %s <filename> \n", argv[0]);
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--emit-asm") == 0) {
+			options.emitAsm = 1;
+		}
+		else if (strcmp(argv[i], "--run") == 0) {
+			options.run = 1;
+		}
+		else if (strcmp(argv[i], "-O0") == 0 || strcmp(argv[i], "-O1") == 0 || strcmp(argv[i], "-O2") == 0) {
+			options.optLevel = argv[i][2] - '0';
+		}
+		else if (strncmp(argv[i], "--passes=", 9) == 0) {
+			options.passes = argv[i] + 9;
+		}
+		else if (strcmp(argv[i], "--dump-ir") == 0) {
+			options.dumpIR = 1;
+		}
+		else if (strcmp(argv[i], "--verify-ir") == 0) {
+			options.verifyIR = 1;
+		}
+		else if (strcmp(argv[i], "--no-peephole") == 0) {
+			options.noPeephole = 1;
+		}
+		else if (strcmp(argv[i], "--peephole-stats") == 0) {
+			options.peepholeStats = 1;
+		}
+		else if (strncmp(argv[i], "--inline-threshold=", 19) == 0) {
+			char* end;
+			long threshold = strtol(argv[i] + 19, &end, 10);
+
+			if (*end != '\0' || end == argv[i] + 19 || threshold < 0 || threshold > INT_MAX) {
+				options.filepath = NULL;
+				break;
+			}
+
+			options.inlineThreshold = (int)threshold;
+		}
+		else if (strcmp(argv[i], "--inline-report") == 0) {
+			options.inlineReport = 1;
+		}
+		else if (strcmp(argv[i], "--keep-frame-pointer") == 0) {
+			options.keepFramePointer = 1;
+		}
+		else if (argv[i][0] == '-' || options.filepath != NULL) {
+			options.filepath = NULL;
+			break;
+		}
+		else {
+			options.filepath = argv[i];
+		}
+	}
+
+	if (options.filepath == NULL) {
+		fprintf(stderr, "Usage: %s [--emit-asm] [--run] [-O0|-O1|-O2] [--passes=a,b] [--dump-ir] [--verify-ir] [--no-peephole] [--peephole-stats] [--inline-threshold=n] [--inline-report] [--keep-frame-pointer] <filename> \n", argv[0]);
 		exit(EXIT_FAILURE);
 	}
 
-	return argv[1];
+	return options;
 }
 
 char* readFileToBuffer(char* filepath) {
@@ -51,6 +148,70 @@ char* readFileToBuffer(char* filepath) {
     return buffer;
 }
 
+// maps the file directly from the page cache. the mapping is placed inside an anonymous
+// reservation that is at least one byte larger, so the NUL sentinel after the last byte
+// always exists, even when the file size is an exact multiple of the page size
+int mapFileToSource(Source* source, char* filepath) {
+
+	int fd = open(filepath, O_RDONLY);
+	if (fd < 0) {
+		return 0;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+		close(fd);
+		return 0;
+	}
+
+	size_t pageSize = sysconf(_SC_PAGESIZE);
+	size_t fileSize = info.st_size;
+	size_t mappedSize = (fileSize / pageSize + 1) * pageSize;
+
+	char* buffer = mmap(NULL, mappedSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buffer == MAP_FAILED) {
+		close(fd);
+		return 0;
+	}
+
+	if (fileSize > 0 && mmap(buffer, fileSize, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+		munmap(buffer, mappedSize);
+		close(fd);
+		return 0;
+	}
+
+	close(fd);
+	madvise(buffer, mappedSize, MADV_SEQUENTIAL);
+
+	source->buffer = buffer;
+	source->mappedSize = mappedSize;
+	return 1;
+}
+
+// falls back to a heap copy for inputs that cannot be mapped, which also reports open errors
+int openSource(Source* source, char* filepath) {
+
+	if (mapFileToSource(source, filepath)) {
+		return 1;
+	}
+
+	source->buffer = readFileToBuffer(filepath);
+	source->mappedSize = 0;
+	return source->buffer != NULL;
+}
+
+void closeSource(Source* source) {
+
+	if (source->mappedSize > 0) {
+		munmap(source->buffer, source->mappedSize);
+	}
+	else {
+		free(source->buffer);
+	}
+
+	source->buffer = NULL;
+}
+
 void printStatement(Statement* stmt, int indent);
 void printExpression(Expression* expr, int indent);
 void printBlockStmt(BlockStmt* block, int indent);
@@ -299,19 +460,66 @@ void printStatement(Statement* stmt, int indent) {
     }
 }
 
+// runs the pipeline of the optimization level, or the passes given by name instead
+int optimize(IRModule* ir, Options* options) {
+
+	PassManager* manager = passManager(options->passes != NULL ? 0 : options->optLevel);
+
+	if (manager == NULL) {
+		return 0;
+	}
+
+	manager->verify = options->verifyIR;
+	manager->inlineReport = options->inlineReport;
+
+	if (options->inlineThreshold >= 0) {
+		manager->inlineThreshold = options->inlineThreshold;
+	}
+
+	char* names = options->passes;
+
+	while (names != NULL && *names != '\0') {
+		char* end = strchr(names, ',');
+		int length = end != NULL ? (int)(end - names) : (int)strlen(names);
+		char name[64];
+
+		if (length >= (int)sizeof(name)) {
+			fprintf(stderr, "Error: Unknown pass '%.*s'\n", length, names);
+			freePassManager(manager);
+			return 0;
+		}
+
+		memcpy(name, names, length);
+		name[length] = '\0';
+
+		if (length > 0 && !addPass(manager, name)) {
+			freePassManager(manager);
+			return 0;
+		}
+
+		names = end != NULL ? end + 1 : NULL;
+	}
+
+	int success = runPasses(manager, ir);
+	freePassManager(manager);
+	return success;
+}
+
 int main(int argc, char* argv[]) {
 
-	char* filepath = parseArgs(argc, argv);
-	char* buffer = readFileToBuffer(filepath);
+	Options options = parseArgs(argc, argv);
+	Source source;
 
-	if (buffer == NULL) {
+	if (!openSource(&source, options.filepath)) {
 		return 1;
 	}
 
+	char* buffer = source.buffer;
+
 	Parser* parser = initializeParser(buffer);
 
 	if (parser == NULL) {
-		free(buffer);
+		closeSource(&source);
 		return 1;
 	}
 
@@ -319,17 +527,41 @@ int main(int argc, char* argv[]) {
 
 	if (ast == NULL) {
 		fprintf(stderr, "Parsing failed\n");
-		free(buffer);
+		closeSource(&source);
 		freeParser(parser);
 		return 1;
 	}
 	
 	printf("Parsing Success!\n");
 
-	TypeChecker* typeChecker = initializeChecker(ast);
+	Resolver* resolver = initializeResolver(ast, parser->arena);
+
+	if (resolver == NULL) {
+		closeSource(&source);
+		freeParser(parser);
+		freeArray(ast);
+		return 1;
+	}
+
+	if (!resolveNames(resolver)) {
+		fprintf(stderr, "Resolving failed\n");
+		closeSource(&source);
+		freeResolver(resolver);
+		freeParser(parser);
+		freeArray(ast);
+		return 1;
+	}
+
+	printf("Resolving Success!\n");
+
+	// the annotations live in the ast, only the number of globals is needed afterwards
+	int globalCount = resolver->globalCount;
+	freeResolver(resolver);
+
+	TypeChecker* typeChecker = initializeChecker(ast, globalCount);
 
 	if (typeChecker == NULL) {
-		free(buffer);
+		closeSource(&source);
 		freeParser(parser);
 		freeArray(ast);
 		return 1;
@@ -337,7 +569,7 @@ int main(int argc, char* argv[]) {
 
 	if(!checkTypes(typeChecker)) {
 		fprintf(stderr, "TypeChecking failed\n");
-		free(buffer);
+		closeSource(&source);
 		freeParser(parser);
 		freeArray(ast);
 		freeChecker(typeChecker);
@@ -346,48 +578,114 @@ int main(int argc, char* argv[]) {
 
 	printf("TypeChecking Success!\n");
 
-	Codegen* codegen = initializeCodegen(ast);
+	IRModule* ir = lowerProgram(ast);
+
+	if (ir == NULL) {
+		fprintf(stderr, "Lowering failed\n");
+		freeChecker(typeChecker);
+		freeParser(parser);
+		freeArray(ast);
+		closeSource(&source);
+		return 1;
+	}
+
+	printf("Lowering Success!\n");
+
+	if (!optimize(ir, &options)) {
+		fprintf(stderr, "Optimizing failed\n");
+		freeIRModule(ir);
+		freeChecker(typeChecker);
+		freeParser(parser);
+		freeArray(ast);
+		closeSource(&source);
+		return 1;
+	}
+
+	if (options.dumpIR) {
+		printIR(ir, stdout);
+	}
+
+	Codegen* codegen = initializeCodegen(ir);
 
 	if (codegen == NULL) {
+		freeIRModule(ir);
 		freeChecker(typeChecker);
 		freeParser(parser);
 		freeArray(ast);
-		free(buffer);
+		closeSource(&source);
 		return 1;
 	}
 
+	codegen->peephole = !options.noPeephole;
+	codegen->keepFramePointer = options.keepFramePointer;
+
 	if (!generate(codegen)) {
 		fprintf(stderr, "Generating Failed!\n");
 		freeChecker(typeChecker);
-		freeParser(parser);
 		freeCodegen(codegen);
+		freeIRModule(ir);
+		freeParser(parser);
 		freeArray(ast);
-		free(buffer);
+		closeSource(&source);
 		return 1;
 	}
 
 	printf("Generation Success!\n");
-	writeToFile(codegen, "compiled.asm");
 
-	int status = system("nasm -f elf64 -g -F dwarf -o compiled.o compiled.asm");
+	if (options.peepholeStats && codegen->peephole) {
+		printPeepholeStats(codegen->peepholeStats, stdout);
+	}
+
+	if (options.run) {
+		int result = 1;
+		MachineCode* code = encodeModule(codegen->module);
+		if (code == NULL || !runMachineCode(code, &result)) {
+			fprintf(stderr, "Error: Failed running the program\n");
+			result = 1;
+		}
+		freeMachineCode(code);
+		freeArray(ast);
+		freeChecker(typeChecker);
+		freeCodegen(codegen);
+		freeIRModule(ir);
+		freeParser(parser);
+		closeSource(&source);
+		return result;
+	}
+
+	int status = 0;
+	if (options.emitAsm) {
+		writeToFile(codegen, "compiled.asm");
+		status = system("nasm -f elf64 -g -F dwarf -o compiled.o compiled.asm");
+	}
+	else {
+		MachineCode* code = encodeModule(codegen->module);
+		if (code == NULL || !writeObjectFile(code, "compiled.o")) {
+			status = 1;
+		}
+		freeMachineCode(code);
+	}
+
 	if (status != 0) {
 		fprintf(stderr, "Error: Failed assembling file\n");
-		freeParser(parser);
 		freeArray(ast);
 		freeChecker(typeChecker);
 		freeCodegen(codegen);
-		free(buffer);
+		freeIRModule(ir);
+		freeParser(parser);
+		closeSource(&source);
 		return 0;
 	}
 
 	status = system("gcc -g -no-pie -o compiled compiled.o");
 	if (status != 0) {
 		fprintf(stderr, "Error: Failed linking file\n");
-		freeParser(parser);
 		freeArray(ast);
 		freeChecker(typeChecker);
 		freeCodegen(codegen);
-		free(buffer);
+		freeIRModule(ir);
+		freeParser(parser);
+		closeSource(&source);
 		return 0;
 	}
 
@@ -396,11 +694,12 @@ int main(int argc, char* argv[]) {
 	//status = system("rm compiled.o compiled.asm");
 	if (status != 0) {
 		fprintf(stderr, "Error: Failed removing object file\n");
-		freeParser(parser);
 		freeArray(ast);
 		freeChecker(typeChecker);
 		freeCodegen(codegen);
-		free(buffer);
+		freeIRModule(ir);
+		freeParser(parser);
+		closeSource(&source);
 		return 0;
 	}
 
@@ -413,9 +712,10 @@ int main(int argc, char* argv[]) {
 	}
 	*/
 
-	freeParser(parser);
 	freeArray(ast);
 	freeChecker(typeChecker);
 	freeCodegen(codegen);
-	free(buffer);
+	freeIRModule(ir);
+	freeParser(parser);
+	closeSource(&source);
 }
@@ -2,7 +2,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include "parser.h"
-#include "parser.h"
 #include "utils.h"
 
 Statement* parseStatement(Parser* parser);
@@ -16,27 +15,12 @@ Expression* parseExpression_V2(Parser* parser);
 Expression* parseExpressionToAst(Parser* parser);
 Expression* descent(Expression* this);
 FunctionCall* parseFunctionCall(Parser* parser, Token* idToken);
-BinOperation* parseBinOperation(BinOperationType type, Expression* left, Expression* right);
-UnaryOperation* parseUnaryOperation(TokenType type, Expression* right);
-Assignment* parseAssignment(Variable* variable, Expression* expression);
+BinOperation* parseBinOperation(Parser* parser, BinOperationType type, Expression* left, Expression* right);
+UnaryOperation* parseUnaryOperation(Parser* parser, TokenType type, Expression* right);
+Assignment* parseAssignment(Parser* parser, Variable* variable, Expression* expression);
 Declaration* parseDeclaration(); // not implemented
-Value* parseValue(Token* token);
-Variable* parseVariable(Token* token);
-
-void freeStatement(void* statement);
-void freeFunctionStmt(void* functionStmt);
-void freeExpression(void* expression);
-void freeBinOperation(BinOperation* binOperation);
-void freeUnaryOperation(UnaryOperation* unaryOperation);
-void freeFunctionCall(FunctionCall* functionCall);
-void freeBlockStmt(BlockStmt* blockStmt);
-void freeWhileStmt(WhileStmt* whileStmt);
-void freeIfStmt(IfStmt* ifStmt);
-void freeAssignment(Assignment* assignment);
-void freeReturnStmt(ReturnStmt* returnStmt);
-void freeDeclaration(Declaration* declaration);
-void freeVariable(void* variable);
-void freeValue(Value* value);
+Value* parseValue(Parser* parser, Token* token);
+Variable* parseVariable(Parser* parser, Token* token);
 
 int VERSION = V2_CUSTOM;
 
@@ -53,15 +37,31 @@ Parser* initializeParser(char* buffer) {
 	if (parser == NULL) {
 		return NULL;
 	}
+
+	parser->lexer = lexer;
+
+	// all nodes of the ast live in this arena and are released together in freeParser
+	parser->arena = arena(ARENA_CHUNK_SIZE);
+
+	if (parser->arena == NULL) {
+		freeParser(parser);
+		return NULL;
+	}
+
+	parser->interner = interner(parser->arena);
+
+	if (parser->interner == NULL) {
+		freeParser(parser);
+		return NULL;
+	}
 	
-	DynamicArray* statements = dynamicArray(2, freeStatement);
+	DynamicArray* statements = dynamicArray(2, NULL);
 
 	if (statements == NULL ) {
 		freeParser(parser);
 		return NULL;
 	}
 
-	parser->lexer = lexer;
 	parser->statements = statements;
 	parser->version = VERSION;
 
@@ -79,12 +79,11 @@ DynamicArray* parseBuffer(Parser* parser) {
 
 		if (statement == NULL) {
 			freeArray(parser->statements);
-			parser->statements = dynamicArray(2, freeStatement);
+			parser->statements = dynamicArray(2, NULL);
 			return NULL;
 		}
 
 		if (statement->type == E_O_F_STMT) {
-			freeStatement(statement);
 			break;
 		}
 
@@ -92,7 +91,7 @@ DynamicArray* parseBuffer(Parser* parser) {
 	}
 
 	DynamicArray* ret = parser->statements;
-	parser->statements = dynamicArray(2, freeStatement);
+	parser->statements = dynamicArray(2, NULL);
 
 	if (parser->statements == NULL) {
 		return NULL;
@@ -242,18 +241,15 @@ static BinOperationType getBinOpType(TokenType type) {
 	}
 }
 
-char* parseToken(Token* token) {
+char* parseToken(Parser* parser, Token* token) {
 
-	char* tokenString = malloc(token->length+1);
+	char* tokenString = intern(parser->interner, token->start, token->length);
 
 	if (tokenString == NULL) {
 		fprintf(stderr, "Error: Failed to allocate memory for tokenstring\n");
 		return NULL;
 	}
 
-	memcpy(tokenString, token->start, token->length);
-
-	tokenString[token->length] = '\0';
 	return tokenString;
 }
 
@@ -270,7 +266,7 @@ Statement* parseStatement(Parser* parser) {
 		return NULL;
 	}
 
-	Statement* statement = calloc(1, sizeof(Statement));
+	Statement* statement = arenaAlloc(parser->arena, sizeof(Statement));
 	if (statement == NULL) {
 		fprintf(stderr, "Error: failed to allocate statement in parser\n");
 		return NULL;
@@ -324,70 +320,56 @@ Statement* parseStatement(Parser* parser) {
 		case F64:
 		case CHAR:
 		case STR: {
-			Token* typeToken = calloc(1, sizeof(Token));
-			if (typeToken == NULL) return NULL;
-			memcpy(typeToken, token, sizeof(Token));
-
-			advanceToken(parser->lexer);
+			Token typeToken = *token;
+			Token* idToken = peekTokenAhead(parser->lexer, 1);
+			Token* nextToken = peekTokenAhead(parser->lexer, 2);
 
-			Token* idToken = calloc(1, sizeof(Token));
-			if (idToken == NULL) return NULL;
-			memcpy(idToken, peekToken(parser->lexer), sizeof(Token));
-
-			advanceToken(parser->lexer);
+			if (idToken == NULL || nextToken == NULL) {
+				goto error;
+			}
 
 			if (idToken->type != ID) {
 				fprintf(stderr, "Error: Unexpected Token %d after Type Annotation\n", idToken->type);
-				free(idToken);
-				free(typeToken);
 				goto error;
 			}
 
-			Token* nextToken = calloc(1, sizeof(Token));
-			if (nextToken == NULL) {
-				free(idToken);
-				free(typeToken);
-				free(nextToken);
-				goto error;
-			}
-			memcpy(nextToken, peekToken(parser->lexer), sizeof(Token));
+			// the lookahead slots get reused once we advance, so keep copies around
+			Token idTokenValue = *idToken;
+			TokenType nextType = nextToken->type;
 
-			if (nextToken->type == LPAREN) {
+			advanceToken(parser->lexer);
+			advanceToken(parser->lexer);
+
+			if (nextType == LPAREN) {
 				advanceToken(parser->lexer);
 
 				statement->type = FUNCTION_STMT;
-				statement->as.function = parseFunctionStmt(parser, typeToken, idToken);
+				statement->as.function = parseFunctionStmt(parser, &typeToken, &idTokenValue);
 
 				if (statement->as.function == NULL) {
-					free(idToken);
-					free(typeToken);
-					free(nextToken);
 					goto error;
 				}
 			}
 
-			else if (nextToken->type == ASSIGN) {
+			else if (nextType == ASSIGN) {
 				advanceToken(parser->lexer);
 
 				statement->type = EXPRESSION_STMT;
 
-				statement->as.expression = calloc(1, sizeof(Expression));
+				statement->as.expression = arenaAlloc(parser->arena, sizeof(Expression));
 
 				if (statement->as.expression == NULL) {
 					return NULL;
 				}
 
 				statement->as.expression->type = ASSIGN_EXPR;
-				Variable* variable = parseVariable(idToken);
+				Variable* variable = parseVariable(parser, &idTokenValue);
 
 				if (variable == NULL) {
-					free(idToken);
-					free(typeToken);
-					free(nextToken);
 					goto error;
 				}
 
-				variable->type = getTypeFromToken(typeToken);
+				variable->type = getTypeFromToken(&typeToken);
 
 				Expression* expression;
 
@@ -399,21 +381,12 @@ Statement* parseStatement(Parser* parser) {
 				}
 
 				if (expression == NULL) {
-					freeVariable(variable);
-					free(idToken);
-					free(typeToken);
-					free(nextToken);
 					goto error;
 				}
 
-				statement->as.expression->as.assignment = parseAssignment(variable, expression); 
+				statement->as.expression->as.assignment = parseAssignment(parser, variable, expression); 
 				
 				if (statement->as.expression->as.assignment == NULL) {
-					freeVariable(variable);
-					freeExpression(expression);
-					free(idToken);
-					free(typeToken);
-					free(nextToken);
 					goto error;
 				}
 
@@ -423,29 +396,23 @@ Statement* parseStatement(Parser* parser) {
 			else {
 				statement->type = EXPRESSION_STMT;
 
-				statement->as.expression = calloc(1, sizeof(Expression));
+				statement->as.expression = arenaAlloc(parser->arena, sizeof(Expression));
 
 				if (statement->as.expression == NULL) {
 					return NULL;
 				}
 
 				statement->as.expression->type = VARIABLE_EXPR;
-				Variable* variable = parseVariable(idToken);
+				Variable* variable = parseVariable(parser, &idTokenValue);
 
 				if (variable == NULL) {
-					free(idToken);
-					free(typeToken);
-					free(nextToken);
 					goto error;
 				}
 
 				statement->as.expression->as.variable = variable;
-				variable->type = getTypeFromToken(typeToken);
+				variable->type = getTypeFromToken(&typeToken);
 			}
 
-			free(idToken);
-			free(typeToken);
-			free(nextToken);
 			break;
 		}
 		case ID:
@@ -475,7 +442,7 @@ Statement* parseStatement(Parser* parser) {
 		case RETURN: {
 			advanceToken(parser->lexer);
 
-			statement->as.returnStmt = calloc(1, sizeof(ReturnStmt));
+			statement->as.returnStmt = arenaAlloc(parser->arena, sizeof(ReturnStmt));
 			statement->type = RETURN_STMT;
 
 			if (statement->as.returnStmt == NULL) {
@@ -510,7 +477,6 @@ Statement* parseStatement(Parser* parser) {
 
 error:
 	fprintf(stderr, "Error: Failed to parse Statement\n");
-	freeStatement(statement);
 	return NULL;
 
 }
@@ -541,19 +507,16 @@ Expression* parsePrimaryExpression(Parser* parser) {
 
 		right->valueType = UNKNOWN;
 
-		Expression* unaryExpression = calloc(1, sizeof(Expression));
+		Expression* unaryExpression = arenaAlloc(parser->arena, sizeof(Expression));
 
 		if (unaryExpression == NULL) {
-			freeExpression(right);
 			return NULL;
 		}
 
 		unaryExpression->valueType = UNKNOWN;
-		unaryExpression->as.unop = parseUnaryOperation(type, right);
+		unaryExpression->as.unop = parseUnaryOperation(parser, type, right);
 
 		if (unaryExpression->as.unop == NULL) {
-			freeExpression(right);
-			freeExpression(unaryExpression);
 			return NULL;
 		}
 
@@ -569,7 +532,7 @@ Expression* parsePrimaryExpression(Parser* parser) {
 		case FALSE:
 		case NUM:
 		case FNUM:
-			expression = calloc(1, sizeof(Expression));
+			expression = arenaAlloc(parser->arena, sizeof(Expression));
 
 			if (expression == NULL) {
 				goto error;
@@ -577,7 +540,7 @@ Expression* parsePrimaryExpression(Parser* parser) {
 
 			expression->type = VALUE_EXPR;
 			expression->valueType = UNKNOWN;
-			expression->as.value = parseValue(token);
+			expression->as.value = parseValue(parser, token);
 
 			if (expression->as.value == NULL) {
 				goto error;
@@ -587,27 +550,24 @@ Expression* parsePrimaryExpression(Parser* parser) {
 			break;
 
 		case ID:
-			expression = calloc(1, sizeof(Expression));
+			expression = arenaAlloc(parser->arena, sizeof(Expression));
 
 			if (expression == NULL) {
 				goto error;
 			}
 			expression->valueType = UNKNOWN;
 
-			Token* idToken = calloc(1, sizeof(Token));
-			if (idToken == NULL) {
-				freeExpression(expression);
+			Token* nextToken = peekTokenAhead(parser->lexer, 1);
+			if (nextToken == NULL) {
 				goto error;
 			}
-			memcpy(idToken, peekToken(parser->lexer), sizeof(Token));
-
-			advanceToken(parser->lexer);
 
-			if (peekToken(parser->lexer)->type == LPAREN) {
+			if (nextToken->type == LPAREN) {
+				Token idToken = *token;
+				advanceToken(parser->lexer);
 				advanceToken(parser->lexer);
 				expression->type = FUNCTIONCALL_EXPR;
-				expression->as.functionCall = parseFunctionCall(parser, idToken);
-				free(idToken);
+				expression->as.functionCall = parseFunctionCall(parser, &idToken);
 
 				if (expression->as.functionCall == NULL) {
 					goto error;
@@ -615,8 +575,8 @@ Expression* parsePrimaryExpression(Parser* parser) {
 			}
 			else {
 				expression->type = VARIABLE_EXPR;
-				expression->as.variable = parseVariable(idToken);
-				free(idToken);
+				expression->as.variable = parseVariable(parser, token);
+				advanceToken(parser->lexer);
 
 				if (expression->as.variable == NULL) {
 					goto error;
@@ -646,7 +606,7 @@ Expression* parsePrimaryExpression(Parser* parser) {
 			}
 			
 			if (parser->version == V2_CUSTOM) {
-				Expression* wrapper = calloc(1, sizeof(Expression));
+				Expression* wrapper = arenaAlloc(parser->arena, sizeof(Expression));
 
 				if (wrapper == NULL) {
 					goto error;
@@ -668,7 +628,6 @@ Expression* parsePrimaryExpression(Parser* parser) {
 	return expression;
 
 error:
-	freeExpression(expression);
 	return NULL;
 }
 
@@ -706,18 +665,15 @@ Expression* parseExpression(Parser* parser, int minPrecedence) {
 		Expression* rightExpression = parseExpression(parser, nextMinPrecedence);
 
 		if (rightExpression == NULL) {
-			freeExpression(leftExpression);
 			return NULL;
 		}
 
 		rightExpression->valueType = UNKNOWN;
 
-		Expression* newLeftExpression = calloc(1, sizeof(Expression));
+		Expression* newLeftExpression = arenaAlloc(parser->arena, sizeof(Expression));
 
 		if (newLeftExpression == NULL) {
 			fprintf(stderr, "Error: Failed to allocate expression in parser\n");
-			freeExpression(leftExpression);
-			freeExpression(rightExpression);
 			return NULL;
 		}
 
@@ -726,42 +682,28 @@ Expression* parseExpression(Parser* parser, int minPrecedence) {
 		if (type == ASSIGN) {
 			if (leftExpression->type != VARIABLE_EXPR) {
 				fprintf(stderr, "Error: Invalid target for assignment. Must be a variable.\n");
-				freeExpression(leftExpression);
-				freeExpression(rightExpression);
-				freeExpression(newLeftExpression);
 				return NULL;
 			}
 
 			if (rightExpression->type == ASSIGN_EXPR) {
 				fprintf(stderr, "Error: Invalid Expression for assignment. Cannot Assign an Assignment to a Variable.\n");
-				freeExpression(leftExpression);
-				freeExpression(rightExpression);
-				freeExpression(newLeftExpression);
 				return NULL;
 			}
 			newLeftExpression->type = ASSIGN_EXPR;
-			newLeftExpression->as.assignment = parseAssignment(leftExpression->as.variable, rightExpression);
+			newLeftExpression->as.assignment = parseAssignment(parser, leftExpression->as.variable, rightExpression);
 
 			if (newLeftExpression->as.assignment == NULL) {
-				freeExpression(leftExpression);
-				freeExpression(rightExpression);
-				freeExpression(newLeftExpression);
 				return NULL;
 			}
-
-			free(leftExpression);
 		}
 
 		else {
 			newLeftExpression->type = BINOP_EXPR;
 			BinOperationType binOpType = getBinOpType(type);
 
-			newLeftExpression->as.binop = parseBinOperation(binOpType, leftExpression, rightExpression);
+			newLeftExpression->as.binop = parseBinOperation(parser, binOpType, leftExpression, rightExpression);
 
 			if (newLeftExpression->as.binop == NULL) {
-				freeExpression(leftExpression);
-				freeExpression(rightExpression);
-				freeExpression(newLeftExpression);
 				return NULL;
 			}
 		}
@@ -782,7 +724,6 @@ Expression* parseExpression_V2(Parser* parser) {
 		expression->as.assignment->expression = descent(expression->as.assignment->expression);
 
 		if (expression->as.assignment->expression == NULL) {
-			freeExpression(expression);
 			return NULL;
 		}
 
@@ -792,7 +733,6 @@ Expression* parseExpression_V2(Parser* parser) {
 	expression = descent(expression);
 
 	if (expression == NULL) {
-		freeExpression(expression);
 		return NULL;
 	}
 
@@ -831,14 +771,12 @@ Expression* parseExpressionToAst(Parser* parser) {
 
 		if (leftExpression->type != VARIABLE_EXPR) {
 			fprintf(stderr, "Error: Invalid target for assignment. Must be a variable.\n");
-			freeExpression(leftExpression);
 			return NULL;
 		}
 
-		Expression* assignment = calloc(1, sizeof(Expression));
+		Expression* assignment = arenaAlloc(parser->arena, sizeof(Expression));
 
 		if (assignment == NULL) {
-			freeExpression(leftExpression);
 			return NULL;
 		}
 
@@ -847,35 +785,27 @@ Expression* parseExpressionToAst(Parser* parser) {
 		Expression* rightExpression = parseExpressionToAst(parser);
 
 		if (rightExpression == NULL) {
-			freeExpression(leftExpression);
-			freeExpression(assignment);
 			return NULL;
 		}
 
 		if (rightExpression->type == ASSIGN_EXPR) {
 			fprintf(stderr, "Error: Invalid Expression for assignment. Cannot Assign an Assignment to a Variable.\n");
-			freeExpression(leftExpression);
 			return NULL;
 		}
 
-		assignment->as.assignment = parseAssignment(leftExpression->as.variable, rightExpression);
+		assignment->as.assignment = parseAssignment(parser, leftExpression->as.variable, rightExpression);
 
 		if (assignment->as.assignment == NULL) {
-			freeExpression(assignment);
-			freeExpression(leftExpression);
-			freeExpression(rightExpression);
 			return NULL;
 		}
 
-		free(leftExpression);
 		return assignment;
 	}
 
 	else {
-		Expression* binOperation = calloc(1, sizeof(Expression));
+		Expression* binOperation = arenaAlloc(parser->arena, sizeof(Expression));
 
 		if (binOperation == NULL) {
-			freeExpression(leftExpression);
 			return NULL;
 		}
 
@@ -885,17 +815,12 @@ Expression* parseExpressionToAst(Parser* parser) {
 		Expression* rightExpression = parseExpressionToAst(parser);
 
 		if (rightExpression == NULL) {
-			freeExpression(leftExpression);
-			freeExpression(binOperation);
 			return NULL;
 		}
 
-		binOperation->as.binop = parseBinOperation(binOpType, leftExpression, rightExpression);
+		binOperation->as.binop = parseBinOperation(parser, binOpType, leftExpression, rightExpression);
 
 		if (binOperation->as.binop == NULL || binOperation->as.binop->right == NULL) {
-			freeExpression(binOperation);
-			freeExpression(leftExpression);
-			freeExpression(rightExpression);
 			return NULL;
 		}
 
@@ -923,8 +848,8 @@ Expression* descent(Expression* this) {
 	return this;
 }
 
-BinOperation* parseBinOperation(BinOperationType type, Expression* left, Expression* right) {
-	BinOperation* binOp = calloc(1, sizeof(BinOperation));
+BinOperation* parseBinOperation(Parser* parser, BinOperationType type, Expression* left, Expression* right) {
+	BinOperation* binOp = arenaAlloc(parser->arena, sizeof(BinOperation));
 
 	if (binOp == NULL) {
 		return NULL;
@@ -937,8 +862,8 @@ BinOperation* parseBinOperation(BinOperationType type, Expression* left, Express
 	return binOp;
 }
 
-UnaryOperation* parseUnaryOperation(TokenType type, Expression* right) {
-	UnaryOperation* unaryOperation = calloc(1, sizeof(UnaryOperation));
+UnaryOperation* parseUnaryOperation(Parser* parser, TokenType type, Expression* right) {
+	UnaryOperation* unaryOperation = arenaAlloc(parser->arena, sizeof(UnaryOperation));
 
 	if (unaryOperation == NULL) {
 		return NULL;
@@ -954,28 +879,22 @@ FunctionStmt* parseFunctionStmt(Parser* parser, Token* typeToken, Token* idToken
 		return NULL;
 	}
 
-	FunctionStmt* function = calloc(1, sizeof(FunctionStmt));
+	FunctionStmt* function = arenaAlloc(parser->arena, sizeof(FunctionStmt));
 
 	if (function == NULL) {
 		return NULL;
 	}
 
 	function->returnType = getTypeFromToken(typeToken);
-	function->id = parseToken(idToken);
-	function->calleeSaved = 0;
-	function->callerSaved = 0;
-	function->maxCalleeSaved = -1;
-	function->maxCallerSaved = -1;
+	function->id = parseToken(parser, idToken);
 
 	if (function->id == NULL) {
-		freeFunctionStmt(function);
 		return NULL;
 	}
 
-	function->params = dynamicArray(2, freeVariable);
+	function->params = arenaDynamicArray(parser->arena, 2);
 
 	if (function->params == NULL) {
-		freeFunctionStmt(function);
 		return NULL;
 	}
 
@@ -985,39 +904,34 @@ FunctionStmt* parseFunctionStmt(Parser* parser, Token* typeToken, Token* idToken
 			break;
 		}
 
-		Token* paramType = calloc(1, sizeof(Token));
-		if (paramType == NULL) return NULL;
-		memcpy(paramType, peekToken(parser->lexer), sizeof(Token));
+		Token* paramType = peekToken(parser->lexer);
+		Token* paramId = peekTokenAhead(parser->lexer, 1);
+
+		if (paramType == NULL || paramId == NULL) {
+			return NULL;
+		}
 
 		if (getTypeFromToken(paramType) == -1) {
 			fprintf(stderr, "Error: Expected Type Token but got %d instead\n", paramType->type);
-			free(paramType);
-			freeFunctionStmt(function);
 			return NULL;
 		}
 
-		advanceToken(parser->lexer);
-
-		Token* paramId = calloc(1, sizeof(Token));
-		if (paramId == NULL) return NULL;
-		memcpy(paramId, peekToken(parser->lexer), sizeof(Token));
-
-		advanceToken(parser->lexer);
-
 		if (paramId->type != ID) {
 			fprintf(stderr, "Error: Type Token isn't followed by ID Token\n");
-			free(paramType);
-			free(paramId);
-			freeFunctionStmt(function);
 			return NULL;
 		}
 
-		Variable* param = parseVariable(paramId);
+		Variable* param = parseVariable(parser, paramId);
+
+		if (param == NULL) {
+			return NULL;
+		}
+
 		param->type = getTypeFromToken(paramType);
 		pushItem(function->params, param);
 
-		free(paramType);
-		free(paramId);
+		advanceToken(parser->lexer);
+		advanceToken(parser->lexer);
 
 		if (peekToken(parser->lexer)->type == RPAREN) {
 			advanceToken(parser->lexer);
@@ -1026,7 +940,6 @@ FunctionStmt* parseFunctionStmt(Parser* parser, Token* typeToken, Token* idToken
 
 		if (peekToken(parser->lexer)->type != COLON) {
 			fprintf(stderr, "Error: Expected Token ',' after a Function Parameter\n");
-			freeFunctionStmt(function);
 			return NULL;
 		}
 
@@ -1035,14 +948,12 @@ FunctionStmt* parseFunctionStmt(Parser* parser, Token* typeToken, Token* idToken
 
 	if (peekToken(parser->lexer)->type != LCURL) {
 		fprintf(stderr, "Error: Expected Token '{' after a Function Parameters\n");
-		freeFunctionStmt(function);
 		return NULL;
 	}
 	advanceToken(parser->lexer);
 
 	function->blockStmt = parseBlockStmt(parser);
 	if (function->blockStmt == NULL) {
-		freeFunctionStmt(function);
 		return NULL;
 	}
 
@@ -1055,16 +966,15 @@ BlockStmt* parseBlockStmt(Parser* parser) {
 		return NULL;
 	}
 
-	BlockStmt* blockStmt = calloc(1, sizeof(BlockStmt));
+	BlockStmt* blockStmt = arenaAlloc(parser->arena, sizeof(BlockStmt));
 
 	if (blockStmt == NULL) {
 		return NULL;
 	}
 
-	blockStmt->stmts = dynamicArray(2, freeStatement);
+	blockStmt->stmts = arenaDynamicArray(parser->arena, 2);
 
 	if (blockStmt->stmts == NULL) {
-		freeBlockStmt(blockStmt);
 		return NULL;
 	}
 
@@ -1073,7 +983,6 @@ BlockStmt* parseBlockStmt(Parser* parser) {
 		Statement* statement = parseStatement(parser);
 
 		if (statement == NULL) {
-			freeBlockStmt(blockStmt);
 			return NULL;
 		}
 
@@ -1082,7 +991,6 @@ BlockStmt* parseBlockStmt(Parser* parser) {
 
 	if (peekToken(parser->lexer) == NULL || peekToken(parser->lexer)->type != RCURL) {
 		fprintf(stderr, "Error: Expected '}'\n");
-		freeBlockStmt(blockStmt);
 		return NULL;
 	}
 
@@ -1096,7 +1004,7 @@ WhileStmt* parseWhileStmt(Parser* parser) {
 		return NULL;
 	}
 
-	WhileStmt* whileStmt = calloc(1, sizeof(WhileStmt));
+	WhileStmt* whileStmt = arenaAlloc(parser->arena, sizeof(WhileStmt));
 
 	if (whileStmt == NULL) {
 		return NULL;
@@ -1110,13 +1018,11 @@ WhileStmt* parseWhileStmt(Parser* parser) {
 	}
 	
 	if (whileStmt->condition == NULL) {
-		freeWhileStmt(whileStmt);
 		return NULL;
 	}
 
 	if (peekToken(parser->lexer) == NULL || peekToken(parser->lexer)->type != LCURL) {
 		fprintf(stderr, "Error: Expected '{' after while condition\n");
-		freeWhileStmt(whileStmt);
 		return NULL;
 	}
 
@@ -1125,7 +1031,6 @@ WhileStmt* parseWhileStmt(Parser* parser) {
 	whileStmt->body = parseBlockStmt(parser);
 
 	if (whileStmt->body == NULL) {
-		freeWhileStmt(whileStmt);
 		return NULL;
 	}
 
@@ -1139,7 +1044,7 @@ IfStmt* parseIfStmt(Parser* parser) {
 		return NULL;
 	}
 
-	IfStmt* ifStmt = calloc(1, sizeof(IfStmt));
+	IfStmt* ifStmt = arenaAlloc(parser->arena, sizeof(IfStmt));
 
 	if (ifStmt == NULL) {
 		return NULL;
@@ -1153,14 +1058,12 @@ IfStmt* parseIfStmt(Parser* parser) {
 	}
 	
 	if (ifStmt->condition == NULL) {
-		freeIfStmt(ifStmt);
 		return NULL;
 	}
 
 	if (peekToken(parser->lexer) == NULL || peekToken(parser->lexer)->type != LCURL) {
 		fprintf(stderr, "Error: Expected '{' after if condition\n");
 		fprintf(stderr, "token type was %d\n", peekToken(parser->lexer)->type);
-		freeIfStmt(ifStmt);
 		return NULL;
 	}
 
@@ -1169,7 +1072,6 @@ IfStmt* parseIfStmt(Parser* parser) {
 	ifStmt->trueBody = parseBlockStmt(parser);
 
 	if (ifStmt->trueBody == NULL) {
-		freeIfStmt(ifStmt);
 		return NULL;
 	}
 
@@ -1186,7 +1088,6 @@ IfStmt* parseIfStmt(Parser* parser) {
 			ifStmt->as.ifElseIf = parseIfStmt(parser);
 
 			if (ifStmt->as.ifElseIf == NULL) {
-				freeIfStmt(ifStmt);
 				return NULL;
 			}
 
@@ -1195,7 +1096,6 @@ IfStmt* parseIfStmt(Parser* parser) {
 
 		if (peekToken(parser->lexer) == NULL || peekToken(parser->lexer)->type != LCURL) {
 			fprintf(stderr, "Error: Expected '{' after else\n");
-			freeIfStmt(ifStmt);
 			return NULL;
 		}
 
@@ -1204,7 +1104,6 @@ IfStmt* parseIfStmt(Parser* parser) {
 		ifStmt->as.ifElse = parseBlockStmt(parser);
 
 		if (ifStmt->as.ifElse == NULL) {
-			freeIfStmt(ifStmt);
 			return NULL;
 		}
 	}
@@ -1217,23 +1116,21 @@ FunctionCall* parseFunctionCall(Parser* parser, Token* idToken) {
 		return NULL;
 	}
 
-	FunctionCall* function = calloc(1, sizeof(FunctionCall));
+	FunctionCall* function = arenaAlloc(parser->arena, sizeof(FunctionCall));
 
 	if (function == NULL) {
 		return NULL;
 	}
 
-	function->id = parseToken(idToken);
+	function->id = parseToken(parser, idToken);
 
 	if (function->id == NULL) {
-		freeFunctionCall(function);
 		return NULL;
 	}
 
-	function->params = dynamicArray(2, freeExpression);
+	function->params = arenaDynamicArray(parser->arena, 2);
 	
 	if (function->params == NULL) {
-		freeFunctionCall(function);
 		return NULL;
 	}
 
@@ -1253,7 +1150,6 @@ FunctionCall* parseFunctionCall(Parser* parser, Token* idToken) {
 		}
 
 		if (param == NULL) {
-			freeFunctionCall(function);
 			return NULL;
 		}
 
@@ -1266,7 +1162,6 @@ FunctionCall* parseFunctionCall(Parser* parser, Token* idToken) {
 
 		if (peekToken(parser->lexer)->type != COLON) {
 			fprintf(stderr, "Error: Expected Token ',' after a Function Argument\n");
-			freeFunctionCall(function);
 			return NULL;
 		}
 
@@ -1276,8 +1171,8 @@ FunctionCall* parseFunctionCall(Parser* parser, Token* idToken) {
 	return function;
 }
 
-Assignment* parseAssignment(Variable* variable, Expression* expression) {
-	Assignment* assignment = calloc(1, sizeof(Assignment));
+Assignment* parseAssignment(Parser* parser, Variable* variable, Expression* expression) {
+	Assignment* assignment = arenaAlloc(parser->arena, sizeof(Assignment));
 	
 	if (assignment == NULL) {
 		return NULL;
@@ -1289,26 +1184,25 @@ Assignment* parseAssignment(Variable* variable, Expression* expression) {
 	return assignment;
 }
 
-Variable* parseVariable(Token* token) {
-	Variable* variable = calloc(1, sizeof(Variable));
+Variable* parseVariable(Parser* parser, Token* token) {
+	Variable* variable = arenaAlloc(parser->arena, sizeof(Variable));
 
 	if (variable == NULL) {
 		return NULL;
 	}
 
 	variable->type = UNKNOWN;
-	variable->id = parseToken(token);
+	variable->id = parseToken(parser, token);
 	
 	if (variable->id == NULL) {
-		freeVariable(variable);
 		return NULL;
 	}
 
 	return variable;
 }
 
-Value* parseValue(Token* token) {
-	Value* value = calloc(1, sizeof(Value));
+Value* parseValue(Parser* parser, Token* token) {
+	Value* value = arenaAlloc(parser->arena, sizeof(Value));
 
 	if (value == NULL) return NULL;
 
@@ -1344,224 +1238,13 @@ Value* parseValue(Token* token) {
 
 }
 
-void freeStatement(void* statement) {
-
-	if (statement == NULL) {
-		return;
-	}
-
-	Statement* stmt = (Statement*) statement;
-
-	switch (stmt->type) {
-		case EXPRESSION_STMT:
-			freeExpression(stmt->as.expression);
-			break;
-		case FUNCTION_STMT:
-			freeFunctionStmt(stmt->as.function);
-			break;
-		case BLOCK_STMT:
-			freeBlockStmt(stmt->as.blockStmt);
-			break;
-		case WHILE_STMT:
-			freeWhileStmt(stmt->as.whileStmt);
-			break;
-		case IF_STMT:
-			freeIfStmt(stmt->as.ifStmt);
-			break;
-		case DECLARATION_STMT:
-			freeDeclaration(stmt->as.declaration);
-			break;
-		case RETURN_STMT:
-			freeReturnStmt(stmt->as.returnStmt);
-			break;
-		case E_O_F_STMT:
-			break;
-	}
-	
-	free(stmt);
-}
-
-void freeBlockStmt(BlockStmt* blockStmt) {
-
-	if (blockStmt == NULL) {
-		return;
-	}
-
-	freeArray(blockStmt->stmts);
-	free(blockStmt);
-}
-
-void freeExpression(void* expression) {
-
-	Expression* expr = (Expression*)expression;
-
-	if (expression == NULL) {
-		return;
-	}
-
-	switch (expr->type) {
-		case EXPR_WRAPPER_EXPR:
-			freeExpression(expr->as.expWrap);
-			break;
-		case FUNCTIONCALL_EXPR:
-			freeFunctionCall(expr->as.functionCall);
-			break;
-		case BINOP_EXPR:
-			freeBinOperation(expr->as.binop);
-			break;
-		case UNARY_EXPR:
-			freeUnaryOperation(expr->as.unop);
-			break;
-		case ASSIGN_EXPR:
-			freeAssignment(expr->as.assignment);
-			break;
-		case VARIABLE_EXPR:
-			freeVariable(expr->as.variable);
-			break;
-		case VALUE_EXPR:
-			freeValue(expr->as.value);
-			break;
-		
-	}
-	
-	free(expression);
-}
-
-void freeBinOperation(BinOperation* binOperation) {
-
-	if (binOperation == NULL) {
-		return;
-	}
-
-	freeExpression(binOperation->right);
-	freeExpression(binOperation->left);
-	free(binOperation);
-}
-
-void freeUnaryOperation(UnaryOperation* unaryOperation) {
-
-	if (unaryOperation == NULL) {
-		return;
-	}
-
-	freeExpression(unaryOperation->right);
-	free(unaryOperation);
-}
-
-void freeFunctionStmt(void* functionStmt) {
-
-	FunctionStmt* func = (FunctionStmt*) functionStmt;
-
-	if (functionStmt == NULL) {
-		return;
-	}
-
-	free(func->id);
-	freeArray(func->params);
-	freeArray(func->toEmit);
-	freeBlockStmt(func->blockStmt);
-	free(func);
-}
-
-void freeWhileStmt(WhileStmt* whileStmt) {
-
-	if (whileStmt == NULL) {
-		return;
-	}
-
-	freeExpression(whileStmt->condition);
-	freeBlockStmt(whileStmt->body);
-	free(whileStmt);
-}
-
-void freeIfStmt(IfStmt* ifStmt) {
-
-	if (ifStmt == NULL) {
-		return;
-	}
-
-	freeExpression(ifStmt->condition);
-	freeBlockStmt(ifStmt->trueBody);
-
-	if (ifStmt->type == IF_ELSE) {
-		freeBlockStmt(ifStmt->as.ifElse);
-	}
-	else if (ifStmt->type == IF_ELSE_IF) {
-		freeIfStmt(ifStmt->as.ifElseIf);
-	}
-
-	free(ifStmt);
-}
-
-void freeReturnStmt(ReturnStmt* returnStmt) {
-	if (returnStmt == NULL) {
-		return;
-	}
-	freeExpression(returnStmt->expression);
-	free(returnStmt);
-}
-
-void freeFunctionCall(FunctionCall* functionCall) {
-	if (functionCall == NULL) {
-		return;
-	}
-	free(functionCall->id);
-	freeArray(functionCall->params);
-	free(functionCall);
-}
-
-void freeAssignment(Assignment* assignment) {
-
-	if (assignment == NULL) {
-		return;
-	}
-
-	freeVariable(assignment->variable);
-	freeExpression(assignment->expression);
-	free(assignment);
-}
-
-void freeDeclaration(Declaration* declaration) {
-
-	if (declaration == NULL) {
-		return;
-	}
-
-	freeVariable(declaration->variable);
-	freeExpression(declaration->initializer);
-	free(declaration);
-}
-
-void freeVariable(void* variable) {
-
-	Variable* var = (Variable*) variable;
-
-	if (var == NULL) {
-		return;
-	}
-
-	free(var->id);
-	free(var);
-}
-
-void freeValue(Value* value) {
-
-	if (value == NULL) {
-		return;
-	}
-
-	if (value->type == STR_TYPE) {
-		free(value->as.str);
-	}
-
-	free(value);
-}
-
 void freeParser(Parser* parser) {
 	if (parser == NULL) {
 		return;
 	}
 	freeLexer(parser->lexer);
 	freeArray(parser->statements);
+	freeInterner(parser->interner);
+	freeArena(parser->arena);
 	free(parser);
 }
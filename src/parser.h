@@ -63,6 +63,12 @@ typedef enum {
 	NEQ_OP
 } BinOperationType;
 
+typedef enum {
+	UNRESOLVED_SYMBOL,
+	GLOBAL_SYMBOL,
+	LOCAL_SYMBOL
+} SymbolKind;
+
 typedef enum {
 	ONLYIF,
 	IF_ELSE,
@@ -85,6 +91,9 @@ struct Parser {
 	Lexer* lexer;
 	DynamicArray* statements;
 	ParserVersion version;
+	Arena* arena;
+	// identifiers are interned, so later passes can compare names by pointer
+	Interner* interner;
 };
 
 struct Statement {
@@ -103,13 +112,9 @@ struct Statement {
 struct FunctionStmt {
 	char* id;
 	ValueType returnType;
-	int callerSaved;
-	int maxCallerSaved;
-	int calleeSaved;
-	int maxCalleeSaved;
-	int maxStack;
+	// number of frame slots handed out by the resolver, parameters included
+	int localCount;
 	DynamicArray* params;
-	DynamicArray* toEmit;
 	BlockStmt* blockStmt;
 };
 
@@ -121,6 +126,9 @@ struct FunctionCall {
 
 struct BlockStmt {
 	struct DynamicArray* stmts;
+	// variables declared in this block, parameters first for function bodies, filled in by the resolver
+	// NULL if the block declares nothing
+	struct DynamicArray* locals;
 };
 
 struct ReturnStmt {
@@ -130,7 +138,6 @@ struct ReturnStmt {
 struct Expression {
 	ExpressionType type;
 	ValueType valueType;
-	int hasCall;
 	union {
 		Expression* expWrap;
 		FunctionCall* functionCall;
@@ -184,6 +191,12 @@ struct Declaration {
 struct Variable {
 	ValueType type;
 	char* id;
+	// filled in by the resolver: a global data label or a frame slot of the current function
+	SymbolKind kind;
+	int slot;
+	int scope;
+	// this occurrence introduces the name
+	bool declaration;
 };
 
 struct Value {
@@ -204,8 +217,5 @@ Parser* initializeParser(char* buffer);
 DynamicArray* parseBuffer(Parser* parser);
 int setParserBuffer(Parser* parser, char* buffer);
 void freeParser(Parser* parser);
-void freeStatement(void* statement);
-void freeFunctionStmt(void* function);
-void freeVariable(void* variable);
 
 #endif
@@ -0,0 +1,166 @@
+#include "passManager.h"
+#include "ir.h"
+#include "irPasses.h"
+#include "inliner.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const Pass knownPasses[] = {
+	{"inline", NULL, inlineFunctions},
+	{"sccp", propagateConstants, NULL},
+	{"simplify-cfg", simplifyCFG, NULL},
+	{"dce", eliminateDeadCode, NULL},
+	{"dse", eliminateDeadStores, NULL},
+	{"tail-recursion", eliminateTailRecursion, NULL},
+};
+
+static const int knownPassCount = sizeof(knownPasses) / sizeof(knownPasses[0]);
+
+// the passes of -O1 and -O2, -O2 only inlines larger functions
+static const char* const pipeline[] = {"tail-recursion", "inline", "sccp", "simplify-cfg", "dse", "dce", NULL};
+
+PassManager* passManager(int level) {
+
+	PassManager* manager = calloc(1, sizeof(PassManager));
+
+	if (manager == NULL) {
+		return NULL;
+	}
+
+	manager->inlineThreshold = level >= 2 ? O2_INLINE_THRESHOLD : DEFAULT_INLINE_THRESHOLD;
+
+	if (level == 0) {
+		return manager;
+	}
+
+	for (int i = 0; pipeline[i] != NULL; i++) {
+		if (!addPass(manager, pipeline[i])) {
+			freePassManager(manager);
+			return NULL;
+		}
+	}
+
+	return manager;
+}
+
+int addPass(PassManager* manager, const char* name) {
+
+	if (manager == NULL || name == NULL) {
+		return 0;
+	}
+
+	const Pass* pass = NULL;
+
+	for (int i = 0; i < knownPassCount; i++) {
+		if (strcmp(knownPasses[i].name, name) == 0) {
+			pass = &knownPasses[i];
+		}
+	}
+
+	if (pass == NULL) {
+		fprintf(stderr, "Error: Unknown pass '%s', known passes are:", name);
+		for (int i = 0; i < knownPassCount; i++) {
+			fprintf(stderr, " %s", knownPasses[i].name);
+		}
+		fputc('\n', stderr);
+		return 0;
+	}
+
+	if (manager->count == manager->capacity) {
+		int capacity = manager->capacity == 0 ? 4 : manager->capacity * 2;
+		Pass* passes = realloc(manager->passes, capacity * sizeof(Pass));
+
+		if (passes == NULL) {
+			return 0;
+		}
+
+		manager->passes = passes;
+		manager->capacity = capacity;
+	}
+
+	manager->passes[manager->count++] = *pass;
+	return 1;
+}
+
+static int verifyModule(IRModule* module, const char* pass) {
+	for (int i = 0; i < module->functions->size; i++) {
+		IRFunction* function = module->functions->array[i];
+
+		if (!verifyIR(function)) {
+			if (pass == NULL) {
+				fprintf(stderr, "Error: Invalid ir for %s before any pass ran\n", function->id);
+			}
+			else {
+				fprintf(stderr, "Error: Invalid ir for %s after pass %s\n", function->id, pass);
+			}
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// the passes run in order, consecutive function passes on one function after the other.
+// a module pass sees the whole module once every earlier pass is done with it
+int runPasses(PassManager* manager, IRModule* module) {
+
+	if (manager == NULL || module == NULL) {
+		return 0;
+	}
+
+	if (manager->verify && !verifyModule(module, NULL)) {
+		return 0;
+	}
+
+	int start = 0;
+
+	while (start < manager->count) {
+		Pass* pass = &manager->passes[start];
+
+		if (pass->runModule != NULL) {
+			if (!pass->runModule(module, manager)) {
+				return 0;
+			}
+
+			if (manager->verify && !verifyModule(module, pass->name)) {
+				return 0;
+			}
+
+			start++;
+			continue;
+		}
+
+		int end = start;
+
+		while (end < manager->count && manager->passes[end].runModule == NULL) {
+			end++;
+		}
+
+		for (int i = 0; i < module->functions->size; i++) {
+			IRFunction* function = module->functions->array[i];
+
+			for (int j = start; j < end; j++) {
+				pass = &manager->passes[j];
+
+				if (!pass->run(function)) {
+					return 0;
+				}
+
+				if (manager->verify && !verifyIR(function)) {
+					fprintf(stderr, "Error: Invalid ir for %s after pass %s\n", function->id, pass->name);
+					return 0;
+				}
+			}
+		}
+
+		start = end;
+	}
+
+	return 1;
+}
+
+void freePassManager(PassManager* manager) {
+	if (manager == NULL) return;
+	free(manager->passes);
+	free(manager);
+}
@@ -0,0 +1,38 @@
+#ifndef PASSMANAGER_H
+#define PASSMANAGER_H
+
+#include "ir.h"
+#include <stdbool.h>
+
+typedef struct PassManager PassManager;
+
+typedef int (*PassFunction)(IRFunction* function);
+// for passes that look across functions, they get the manager for its settings
+typedef int (*ModulePassFunction)(IRModule* module, PassManager* manager);
+
+typedef struct Pass {
+	const char* name;
+	// exactly one of them is set
+	PassFunction run;
+	ModulePassFunction runModule;
+} Pass;
+
+struct PassManager {
+	Pass* passes;
+	int count;
+	int capacity;
+	// check the ir after every pass, which points at the pass that broke it
+	bool verify;
+	// the largest callee the inliner still copies into its callers, 0 inlines nothing
+	int inlineThreshold;
+	// print every call the inliner decided on
+	bool inlineReport;
+};
+
+// the default pipeline of an optimization level, 0 runs no passes at all
+PassManager* passManager(int level);
+int addPass(PassManager* manager, const char* name);
+int runPasses(PassManager* manager, IRModule* module);
+void freePassManager(PassManager* manager);
+
+#endif
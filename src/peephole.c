@@ -0,0 +1,476 @@
+#include "peephole.h"
+#include "machineIR.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LABEL_KINDS (RETURN_LABEL + 1)
+// rules can enable each other, but chains of jumps are the longest thing to resolve
+#define MAX_SWEEPS 8
+
+typedef struct Peephole Peephole;
+
+// the function while the rules run over it. removed instructions are only marked
+// and compacted after every sweep, so positions stay valid during one
+struct Peephole {
+	MachineFunction* function;
+	bool* removed;
+	// position of every label and the number of jumps to it, by label number and kind
+	int* labels;
+	int* references;
+	int labelCount;
+};
+
+typedef struct PeepholeRule {
+	const char* name;
+	// rewrites the code at the position if the rule matches there
+	bool (*apply)(Peephole* peephole, int index);
+} PeepholeRule;
+
+static bool removeSelfMove(Peephole* peephole, int index);
+static bool removeDeadMove(Peephole* peephole, int index);
+static bool removeMoveBack(Peephole* peephole, int index);
+static bool forwardStore(Peephole* peephole, int index);
+static bool removeZeroAdjustment(Peephole* peephole, int index);
+static bool removeStackAdjustment(Peephole* peephole, int index);
+static bool threadJump(Peephole* peephole, int index);
+static bool invertBranchOverJump(Peephole* peephole, int index);
+static bool removeJumpToNext(Peephole* peephole, int index);
+static bool removeUnreachable(Peephole* peephole, int index);
+static bool removeUnusedLabel(Peephole* peephole, int index);
+
+static const PeepholeRule rules[] = {
+	// mov eax, eax
+	{"self-move", removeSelfMove},
+	// mov eax, ecx; mov eax, edx
+	{"dead-move", removeDeadMove},
+	// mov eax, ecx; mov ecx, eax
+	{"move-back", removeMoveBack},
+	// mov [rbp-4], eax; mov ecx, [rbp-4]
+	{"store-forward", forwardStore},
+	// add eax, 0
+	{"zero-adjust", removeZeroAdjustment},
+	// add rsp, 16; leave
+	{"stack-before-leave", removeStackAdjustment},
+	// jmp .a; .a: jmp .b
+	{"jump-thread", threadJump},
+	// jl .a; jmp .b; .a:
+	{"branch-over-jump", invertBranchOverJump},
+	// jmp .a; .a:
+	{"jump-to-next", removeJumpToNext},
+	// code after jmp or ret up to the next label
+	{"unreachable", removeUnreachable},
+	{"unused-label", removeUnusedLabel},
+};
+
+static const int ruleCount = sizeof(rules) / sizeof(rules[0]);
+
+static bool sameOperand(Operand* a, Operand* b) {
+
+	if (a->kind != b->kind || a->size != b->size) {
+		return false;
+	}
+
+	switch (a->kind) {
+		case REGISTER_OPERAND:
+			return a->as.reg == b->as.reg;
+		case IMMEDIATE_OPERAND:
+			return a->as.immediate == b->as.immediate;
+		case FRAME_OPERAND:
+			return a->base == b->base && a->as.offset == b->as.offset;
+		case GLOBAL_OPERAND:
+		case SYMBOL_OPERAND:
+			return strcmp(a->as.symbol, b->as.symbol) == 0;
+		case LABEL_OPERAND:
+			return a->as.label.kind == b->as.label.kind && a->as.label.number == b->as.label.number;
+		default:
+			return true;
+	}
+}
+
+static bool isMemory(Operand* operand) {
+	return operand->kind == FRAME_OPERAND || operand->kind == GLOBAL_OPERAND;
+}
+
+static bool isJump(MachineInstr* instr) {
+	return (instr->opcode == JMP_INSTR || instr->opcode == JCC_INSTR) && instr->dst.kind == LABEL_OPERAND;
+}
+
+static int labelIndex(Operand* label) {
+	return label->as.label.number * LABEL_KINDS + label->as.label.kind;
+}
+
+// the next instruction that was not removed
+static int following(Peephole* peephole, int index) {
+	do {
+		index++;
+	} while (index < peephole->function->size && peephole->removed[index]);
+	return index;
+}
+
+// the next instruction that is not removed and not a label, where control goes from a label
+static int followingCode(Peephole* peephole, int index) {
+	MachineInstr* code = peephole->function->code;
+	do {
+		index = following(peephole, index);
+	} while (index < peephole->function->size && code[index].opcode == LABEL_INSTR);
+	return index;
+}
+
+static void removeInstruction(Peephole* peephole, int index) {
+	MachineInstr* instr = &peephole->function->code[index];
+
+	if (isJump(instr)) {
+		peephole->references[labelIndex(&instr->dst)]--;
+	}
+	peephole->removed[index] = true;
+}
+
+static void retarget(Peephole* peephole, MachineInstr* jump, Operand label) {
+	peephole->references[labelIndex(&jump->dst)]--;
+	peephole->references[labelIndex(&label)]++;
+	jump->dst = label;
+}
+
+// the label is defined somewhere between the two positions, with only labels in between
+static bool labelFollows(Peephole* peephole, int index, Operand* label) {
+	int target = peephole->labels[labelIndex(label)];
+	return target > index && followingCode(peephole, index) > target;
+}
+
+static bool removeSelfMove(Peephole* peephole, int index) {
+	MachineInstr* instr = &peephole->function->code[index];
+
+	if (instr->opcode != MOV_INSTR || !sameOperand(&instr->dst, &instr->src)) {
+		return false;
+	}
+
+	removeInstruction(peephole, index);
+	return true;
+}
+
+// a register that is written again right away without being read was written for nothing
+static bool removeDeadMove(Peephole* peephole, int index) {
+	MachineInstr* instr = &peephole->function->code[index];
+	int next = following(peephole, index);
+
+	if (instr->opcode != MOV_INSTR || instr->dst.kind != REGISTER_OPERAND || next >= peephole->function->size) {
+		return false;
+	}
+
+	MachineInstr* other = &peephole->function->code[next];
+	bool reads = other->src.kind == REGISTER_OPERAND && other->src.as.reg == instr->dst.as.reg;
+
+	if ((other->opcode != MOV_INSTR && other->opcode != MOVZX_INSTR) || !sameOperand(&instr->dst, &other->dst) || reads) {
+		return false;
+	}
+
+	removeInstruction(peephole, index);
+	return true;
+}
+
+static bool removeMoveBack(Peephole* peephole, int index) {
+	MachineInstr* instr = &peephole->function->code[index];
+	int next = following(peephole, index);
+
+	if (instr->opcode != MOV_INSTR || next >= peephole->function->size) {
+		return false;
+	}
+
+	MachineInstr* other = &peephole->function->code[next];
+
+	if (other->opcode != MOV_INSTR || !sameOperand(&instr->dst, &other->src) || !sameOperand(&instr->src, &other->dst)) {
+		return false;
+	}
+
+	removeInstruction(peephole, next);
+	return true;
+}
+
+// a value that was just stored is still in the register it came from
+static bool forwardStore(Peephole* peephole, int index) {
+	MachineInstr* instr = &peephole->function->code[index];
+	int next = following(peephole, index);
+
+	if (instr->opcode != MOV_INSTR || !isMemory(&instr->dst) || instr->src.kind != REGISTER_OPERAND || next >= peephole->function->size) {
+		return false;
+	}
+
+	MachineInstr* other = &peephole->function->code[next];
+
+	if (other->opcode != MOV_INSTR || other->dst.kind != REGISTER_OPERAND || !sameOperand(&instr->dst, &other->src)) {
+		return false;
+	}
+
+	if (other->dst.as.reg == instr->src.as.reg) {
+		removeInstruction(peephole, next);
+	}
+	else {
+		other->src = instr->src;
+	}
+	return true;
+}
+
+// the flags are only ever read by the instruction right after a cmp
+static bool removeZeroAdjustment(Peephole* peephole, int index) {
+	MachineInstr* instr = &peephole->function->code[index];
+	int next = following(peephole, index);
+
+	if ((instr->opcode != ADD_INSTR && instr->opcode != SUB_INSTR) || instr->src.kind != IMMEDIATE_OPERAND || instr->src.as.immediate != 0) {
+		return false;
+	}
+
+	if (next < peephole->function->size) {
+		Opcode opcode = peephole->function->code[next].opcode;
+
+		if (opcode == JCC_INSTR || opcode == SETCC_INSTR) {
+			return false;
+		}
+	}
+
+	removeInstruction(peephole, index);
+	return true;
+}
+
+// leave restores rsp from rbp anyway, with a frame pointer
+static bool removeStackAdjustment(Peephole* peephole, int index) {
+	MachineInstr* instr = &peephole->function->code[index];
+	int next = following(peephole, index);
+	bool adjustsStack = (instr->opcode == ADD_INSTR || instr->opcode == SUB_INSTR)
+		&& instr->dst.kind == REGISTER_OPERAND && instr->dst.as.reg == RSP_REG;
+
+	if (!adjustsStack || next >= peephole->function->size || peephole->function->code[next].opcode != LEAVE_INSTR) {
+		return false;
+	}
+
+	removeInstruction(peephole, index);
+	return true;
+}
+
+static bool threadJump(Peephole* peephole, int index) {
+	MachineInstr* instr = &peephole->function->code[index];
+
+	if (!isJump(instr)) {
+		return false;
+	}
+
+	int target = followingCode(peephole, peephole->labels[labelIndex(&instr->dst)]);
+
+	if (target >= peephole->function->size) {
+		return false;
+	}
+
+	MachineInstr* jump = &peephole->function->code[target];
+
+	if (jump->opcode != JMP_INSTR || jump->dst.kind != LABEL_OPERAND || sameOperand(&jump->dst, &instr->dst)) {
+		return false;
+	}
+
+	retarget(peephole, instr, jump->dst);
+	return true;
+}
+
+static bool invertBranchOverJump(Peephole* peephole, int index) {
+	MachineInstr* instr = &peephole->function->code[index];
+	int next = following(peephole, index);
+
+	if (instr->opcode != JCC_INSTR || !isJump(instr) || next >= peephole->function->size) {
+		return false;
+	}
+
+	MachineInstr* jump = &peephole->function->code[next];
+
+	if (jump->opcode != JMP_INSTR || !isJump(jump) || !labelFollows(peephole, next, &instr->dst)) {
+		return false;
+	}
+
+	instr->condition = invertCondition(instr->condition);
+	retarget(peephole, instr, jump->dst);
+	removeInstruction(peephole, next);
+	return true;
+}
+
+static bool removeJumpToNext(Peephole* peephole, int index) {
+	MachineInstr* instr = &peephole->function->code[index];
+
+	if (!isJump(instr) || !labelFollows(peephole, index, &instr->dst)) {
+		return false;
+	}
+
+	removeInstruction(peephole, index);
+	return true;
+}
+
+static bool removeUnreachable(Peephole* peephole, int index) {
+	MachineInstr* code = peephole->function->code;
+	int next = following(peephole, index);
+
+	if (code[index].opcode != JMP_INSTR && code[index].opcode != RET_INSTR) {
+		return false;
+	}
+
+	if (next >= peephole->function->size || code[next].opcode == LABEL_INSTR) {
+		return false;
+	}
+
+	removeInstruction(peephole, next);
+	return true;
+}
+
+static bool removeUnusedLabel(Peephole* peephole, int index) {
+	MachineInstr* instr = &peephole->function->code[index];
+
+	if (instr->opcode != LABEL_INSTR || peephole->references[labelIndex(&instr->dst)] > 0) {
+		return false;
+	}
+
+	removeInstruction(peephole, index);
+	return true;
+}
+
+// positions of the labels and jumps to them, rebuilt before every sweep
+static int indexLabels(Peephole* peephole) {
+
+	MachineFunction* function = peephole->function;
+	int labelCount = 0;
+
+	for (int i = 0; i < function->size; i++) {
+		MachineInstr* instr = &function->code[i];
+
+		if (instr->opcode == LABEL_INSTR || isJump(instr)) {
+			int label = labelIndex(&instr->dst) + 1;
+			labelCount = label > labelCount ? label : labelCount;
+		}
+	}
+
+	if (labelCount > peephole->labelCount) {
+		free(peephole->labels);
+		free(peephole->references);
+		peephole->labels = malloc(labelCount * sizeof(int));
+		peephole->references = malloc(labelCount * sizeof(int));
+		peephole->labelCount = labelCount;
+
+		if (peephole->labels == NULL || peephole->references == NULL) {
+			return 0;
+		}
+	}
+
+	for (int i = 0; i < peephole->labelCount; i++) {
+		peephole->labels[i] = function->size;
+		peephole->references[i] = 0;
+	}
+
+	for (int i = 0; i < function->size; i++) {
+		MachineInstr* instr = &function->code[i];
+
+		if (instr->opcode == LABEL_INSTR) {
+			peephole->labels[labelIndex(&instr->dst)] = i;
+		}
+		else if (isJump(instr)) {
+			peephole->references[labelIndex(&instr->dst)]++;
+		}
+	}
+
+	return 1;
+}
+
+static void compact(Peephole* peephole) {
+
+	MachineFunction* function = peephole->function;
+	int size = 0;
+
+	for (int i = 0; i < function->size; i++) {
+		if (!peephole->removed[i]) {
+			function->code[size++] = function->code[i];
+		}
+	}
+
+	function->size = size;
+}
+
+int optimizePeephole(MachineFunction* function, PeepholeStats* stats) {
+
+	if (function == NULL) {
+		return 0;
+	}
+
+	// the code only shrinks, so the marks are allocated once
+	Peephole peephole = {function, malloc(function->size + 1), NULL, NULL, 0};
+	int originalSize = function->size;
+	bool changed = true;
+
+	for (int sweep = 0; changed && sweep < MAX_SWEEPS; sweep++) {
+		changed = false;
+
+		if (peephole.removed == NULL || !indexLabels(&peephole)) {
+			free(peephole.removed);
+			free(peephole.labels);
+			free(peephole.references);
+			return 0;
+		}
+
+		memset(peephole.removed, 0, function->size + 1);
+
+		for (int i = 0; i < function->size; i = following(&peephole, i)) {
+			for (int r = 0; r < ruleCount && !peephole.removed[i]; r++) {
+				if (rules[r].apply(&peephole, i)) {
+					changed = true;
+
+					if (stats != NULL) {
+						stats->fired[r]++;
+					}
+				}
+			}
+		}
+
+		compact(&peephole);
+	}
+
+	if (stats != NULL) {
+		stats->removed += originalSize - function->size;
+	}
+
+	free(peephole.removed);
+	free(peephole.labels);
+	free(peephole.references);
+	return 1;
+}
+
+PeepholeStats* peepholeStats() {
+
+	PeepholeStats* stats = calloc(1, sizeof(PeepholeStats));
+
+	if (stats == NULL) {
+		return NULL;
+	}
+
+	stats->fired = calloc(ruleCount, sizeof(long long));
+
+	if (stats->fired == NULL) {
+		free(stats);
+		return NULL;
+	}
+
+	return stats;
+}
+
+void printPeepholeStats(PeepholeStats* stats, FILE* file) {
+
+	if (stats == NULL) {
+		return;
+	}
+
+	fprintf(file, "Peephole rules fired:\n");
+
+	for (int i = 0; i < ruleCount; i++) {
+		fprintf(file, "  %-20s %lld\n", rules[i].name, stats->fired[i]);
+	}
+
+	fprintf(file, "  %-20s %lld\n", "instructions removed", stats->removed);
+}
+
+void freePeepholeStats(PeepholeStats* stats) {
+	if (stats == NULL) return;
+	free(stats->fired);
+	free(stats);
+}
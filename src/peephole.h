@@ -0,0 +1,23 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "machineIR.h"
+#include <stdio.h>
+
+typedef struct PeepholeStats PeepholeStats;
+
+// how often every rule rewrote the code, summed up over all functions
+struct PeepholeStats {
+	// by rule, in the order of the rule table
+	long long* fired;
+	long long removed;
+};
+
+PeepholeStats* peepholeStats();
+// rewrites short instruction sequences of the finished function, after registers are allocated
+// and the frame is generated. the stats are optional
+int optimizePeephole(MachineFunction* function, PeepholeStats* stats);
+void printPeepholeStats(PeepholeStats* stats, FILE* file);
+void freePeepholeStats(PeepholeStats* stats);
+
+#endif
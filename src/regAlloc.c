@@ -0,0 +1,815 @@
+#include "regAlloc.h"
+#include "machineIR.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// linear scan over live intervals, after Poletto and Sarkar: every virtual register gets one interval from
+// its first to its last live position, intervals are handed registers in the order they start and the
+// cheapest one is spilled when none is left. uses inside loops make an interval expensive, so the values
+// a loop works on stay in registers
+
+// never handed out by the allocator, spilled registers are loaded into them around every instruction
+static const Register DESTINATION_SCRATCH = R10_REG;
+static const Register SOURCE_SCRATCH = R11_REG;
+
+// caller saved ones first, the callee saved ones cost a push and pop in the prologue and epilogue
+static const Register allocatable[] = {RAX_REG, RCX_REG, RDX_REG, RSI_REG, RDI_REG, R8_REG, R9_REG, RBX_REG, R12_REG, R13_REG, R14_REG, R15_REG};
+static const int allocatableCount = sizeof(allocatable) / sizeof(allocatable[0]);
+
+static const Register callerSaved[] = {RAX_REG, RCX_REG, RDX_REG, RSI_REG, RDI_REG, R8_REG, R9_REG, R10_REG, R11_REG};
+static const Register argumentRegisters[] = {RDI_REG, RSI_REG, RDX_REG, RCX_REG, R8_REG, R9_REG};
+
+typedef struct Range {
+	int start;
+	int end;
+} Range;
+
+// positions where a hardware register holds a value the instructions put there, or is overwritten by them,
+// sorted by start
+typedef struct FixedRanges {
+	Range* ranges;
+	int count;
+	int capacity;
+} FixedRanges;
+
+typedef struct Interval {
+	int vreg;
+	int start;
+	int end;
+	// a register or virtual register a move connects this one to, allocating both the same drops the move
+	Register hint;
+	Register assigned;
+	// uses and definitions, weighted by the depth of the loops they are in
+	double spillCost;
+} Interval;
+
+typedef struct Allocator {
+	MachineFunction* function;
+	int vregCount;
+	// instruction index where each block starts, with the end of the code as the last entry
+	int* blockStarts;
+	int blockCount;
+	// two per block, -1 where there is none
+	int* successors;
+	// number of loops around every block
+	int* loopDepths;
+	// live variable bitsets per block
+	int words;
+	unsigned long long* uses;
+	unsigned long long* defs;
+	unsigned long long* liveIn;
+	unsigned long long* liveOut;
+	Interval* intervals;
+	FixedRanges fixed[R15_REG + 1];
+	// frame slot of every spilled virtual register, -1 for the ones in a register
+	int* slots;
+	int slotCount;
+} Allocator;
+
+// instruction i reads its operands at 2i + 1 and writes its results at 2i + 2, 0 is the function entry
+static int usePosition(int index) {
+	return 2 * index + 1;
+}
+
+static int defPosition(int index) {
+	return 2 * index + 2;
+}
+
+static int virtualIndex(Operand* operand) {
+	return isVirtualRegister(operand) ? (int)operand->as.reg - FIRST_VIRTUAL_REG : -1;
+}
+
+static bool isAllocatable(Register reg) {
+	for (int i = 0; i < allocatableCount; i++) {
+		if (allocatable[i] == reg) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void setBit(unsigned long long* set, int bit) {
+	set[bit / 64] |= 1ULL << (bit % 64);
+}
+
+static bool testBit(unsigned long long* set, int bit) {
+	return (set[bit / 64] >> (bit % 64)) & 1;
+}
+
+static int splitBlocks(Allocator* allocator) {
+
+	MachineFunction* function = allocator->function;
+	allocator->blockStarts = malloc((function->size + 2) * sizeof(int));
+
+	if (allocator->blockStarts == NULL) {
+		return 0;
+	}
+
+	int count = 0;
+	int maxLabel = 0;
+
+	for (int i = 0; i < function->size; i++) {
+		MachineInstr* instr = &function->code[i];
+		bool leader = i == 0 || instr->opcode == LABEL_INSTR;
+
+		if (i > 0) {
+			Opcode previous = function->code[i - 1].opcode;
+			leader = leader || previous == JMP_INSTR || previous == JCC_INSTR || previous == RET_INSTR;
+		}
+
+		if (leader && (count == 0 || allocator->blockStarts[count - 1] != i)) {
+			allocator->blockStarts[count++] = i;
+		}
+
+		if (instr->opcode == LABEL_INSTR && instr->dst.as.label.number > maxLabel) {
+			maxLabel = instr->dst.as.label.number;
+		}
+	}
+
+	allocator->blockStarts[count] = function->size;
+	allocator->blockCount = count;
+
+	// blocks by the number of the block label they start with
+	int* labels = malloc((maxLabel + 1) * sizeof(int));
+	allocator->successors = malloc((count * 2 + 1) * sizeof(int));
+
+	if (labels == NULL || allocator->successors == NULL) {
+		free(labels);
+		return 0;
+	}
+
+	for (int i = 0; i <= maxLabel; i++) {
+		labels[i] = -1;
+	}
+
+	for (int i = 0; i < count; i++) {
+		MachineInstr* first = &function->code[allocator->blockStarts[i]];
+
+		if (first->opcode == LABEL_INSTR && first->dst.as.label.kind == BLOCK_LABEL) {
+			labels[first->dst.as.label.number] = i;
+		}
+	}
+
+	for (int i = 0; i < count; i++) {
+		int* successors = &allocator->successors[i * 2];
+		successors[0] = -1;
+		successors[1] = -1;
+
+		if (allocator->blockStarts[i + 1] == allocator->blockStarts[i]) {
+			continue;
+		}
+
+		MachineInstr* last = &function->code[allocator->blockStarts[i + 1] - 1];
+		bool jumps = last->opcode == JMP_INSTR || last->opcode == JCC_INSTR;
+
+		if (jumps && last->dst.kind == LABEL_OPERAND && last->dst.as.label.kind == BLOCK_LABEL && last->dst.as.label.number <= maxLabel) {
+			successors[0] = labels[last->dst.as.label.number];
+		}
+
+		bool fallsThrough = last->opcode != JMP_INSTR && last->opcode != RET_INSTR;
+
+		if (fallsThrough && i + 1 < count) {
+			successors[1] = i + 1;
+		}
+	}
+
+	free(labels);
+	return 1;
+}
+
+// the layout keeps every loop in one piece from its header to the jump back to it,
+// so every backward edge covers the blocks of one loop
+static int computeLoopDepths(Allocator* allocator) {
+
+	int count = allocator->blockCount;
+	allocator->loopDepths = calloc(count + 1, sizeof(int));
+
+	if (allocator->loopDepths == NULL) {
+		return 0;
+	}
+
+	// entries and exits of the loops, summed up below
+	for (int b = 0; b < count; b++) {
+		for (int s = 0; s < 2; s++) {
+			int successor = allocator->successors[b * 2 + s];
+
+			if (successor >= 0 && successor <= b) {
+				allocator->loopDepths[successor]++;
+				allocator->loopDepths[b + 1]--;
+			}
+		}
+	}
+
+	for (int b = 1; b < count; b++) {
+		allocator->loopDepths[b] += allocator->loopDepths[b - 1];
+	}
+
+	return 1;
+}
+
+static int computeLiveness(Allocator* allocator) {
+
+	MachineFunction* function = allocator->function;
+	int words = (allocator->vregCount + 63) / 64;
+	size_t setSize = (size_t)allocator->blockCount * words + 1;
+
+	allocator->words = words;
+	allocator->uses = calloc(setSize, sizeof(unsigned long long));
+	allocator->defs = calloc(setSize, sizeof(unsigned long long));
+	allocator->liveIn = calloc(setSize, sizeof(unsigned long long));
+	allocator->liveOut = calloc(setSize, sizeof(unsigned long long));
+
+	if (allocator->uses == NULL || allocator->defs == NULL || allocator->liveIn == NULL || allocator->liveOut == NULL) {
+		return 0;
+	}
+
+	// registers read before they are written in the block, and the ones written in it
+	for (int b = 0; b < allocator->blockCount; b++) {
+		unsigned long long* uses = &allocator->uses[(size_t)b * words];
+		unsigned long long* defs = &allocator->defs[(size_t)b * words];
+
+		for (int i = allocator->blockStarts[b]; i < allocator->blockStarts[b + 1]; i++) {
+			MachineInstr* instr = &function->code[i];
+			int src = virtualIndex(&instr->src);
+			int dst = virtualIndex(&instr->dst);
+
+			if (src >= 0 && !testBit(defs, src)) {
+				setBit(uses, src);
+			}
+			if (dst >= 0 && readsDestination(instr->opcode) && !testBit(defs, dst)) {
+				setBit(uses, dst);
+			}
+			if (dst >= 0 && writesDestination(instr->opcode)) {
+				setBit(defs, dst);
+			}
+		}
+	}
+
+	bool changed = true;
+
+	while (changed) {
+		changed = false;
+
+		for (int b = allocator->blockCount - 1; b >= 0; b--) {
+			unsigned long long* out = &allocator->liveOut[(size_t)b * words];
+			unsigned long long* in = &allocator->liveIn[(size_t)b * words];
+			unsigned long long* uses = &allocator->uses[(size_t)b * words];
+			unsigned long long* defs = &allocator->defs[(size_t)b * words];
+
+			for (int s = 0; s < 2; s++) {
+				int successor = allocator->successors[b * 2 + s];
+
+				if (successor < 0) {
+					continue;
+				}
+
+				unsigned long long* successorIn = &allocator->liveIn[(size_t)successor * words];
+
+				for (int w = 0; w < words; w++) {
+					out[w] |= successorIn[w];
+				}
+			}
+
+			for (int w = 0; w < words; w++) {
+				unsigned long long live = uses[w] | (out[w] & ~defs[w]);
+
+				if (live != in[w]) {
+					in[w] = live;
+					changed = true;
+				}
+			}
+		}
+	}
+
+	return 1;
+}
+
+static void extendInterval(Interval* interval, int position) {
+	if (interval->start < 0 || position < interval->start) {
+		interval->start = position;
+	}
+	if (position > interval->end) {
+		interval->end = position;
+	}
+}
+
+static int addFixedRange(FixedRanges* fixed, int start, int end) {
+
+	// reads of the same value extend the range they started
+	if (fixed->count > 0 && fixed->ranges[fixed->count - 1].start == start) {
+		if (end > fixed->ranges[fixed->count - 1].end) {
+			fixed->ranges[fixed->count - 1].end = end;
+		}
+		return 1;
+	}
+
+	if (fixed->count == fixed->capacity) {
+		int capacity = fixed->capacity == 0 ? 8 : fixed->capacity * 2;
+		Range* ranges = realloc(fixed->ranges, capacity * sizeof(Range));
+
+		if (ranges == NULL) {
+			return 0;
+		}
+
+		fixed->ranges = ranges;
+		fixed->capacity = capacity;
+	}
+
+	fixed->ranges[fixed->count++] = (Range){start, end};
+	return 1;
+}
+
+static int readFixed(Allocator* allocator, int* lastDef, Register reg, int position) {
+
+	if (!isAllocatable(reg) || lastDef[reg] < 0) {
+		return 1;
+	}
+
+	return addFixedRange(&allocator->fixed[reg], lastDef[reg], position);
+}
+
+static int writeFixed(Allocator* allocator, int* lastDef, Register reg, int position) {
+
+	if (!isAllocatable(reg)) {
+		return 1;
+	}
+
+	lastDef[reg] = position;
+	return addFixedRange(&allocator->fixed[reg], position, position);
+}
+
+// hardware registers only carry values inside a block: the arguments from the entry to their moves,
+// call arguments and results, the operands of idiv and the return value
+static int collectFixedRanges(Allocator* allocator, int block, int* lastDef) {
+
+	MachineFunction* function = allocator->function;
+
+	for (int r = 0; r <= R15_REG; r++) {
+		lastDef[r] = -1;
+	}
+
+	if (block == 0) {
+		for (int i = 0; i < 6; i++) {
+			lastDef[argumentRegisters[i]] = 0;
+		}
+	}
+
+	for (int i = allocator->blockStarts[block]; i < allocator->blockStarts[block + 1]; i++) {
+		MachineInstr* instr = &function->code[i];
+		int use = usePosition(i);
+		int def = defPosition(i);
+
+		if (instr->src.kind == REGISTER_OPERAND && !readFixed(allocator, lastDef, instr->src.as.reg, use)) {
+			return 0;
+		}
+
+		if (instr->dst.kind == REGISTER_OPERAND && !isVirtualRegister(&instr->dst)) {
+			if (readsDestination(instr->opcode) && !readFixed(allocator, lastDef, instr->dst.as.reg, use)) {
+				return 0;
+			}
+			if (writesDestination(instr->opcode) && !writeFixed(allocator, lastDef, instr->dst.as.reg, def)) {
+				return 0;
+			}
+		}
+
+		switch (instr->opcode) {
+			case CDQ_INSTR:
+				if (!readFixed(allocator, lastDef, RAX_REG, use) || !writeFixed(allocator, lastDef, RDX_REG, def)) return 0;
+				break;
+			case IDIV_INSTR:
+				if (!readFixed(allocator, lastDef, RAX_REG, use) || !readFixed(allocator, lastDef, RDX_REG, use)
+					|| !writeFixed(allocator, lastDef, RAX_REG, def) || !writeFixed(allocator, lastDef, RDX_REG, def)) return 0;
+				break;
+			case CALL_INSTR:
+				// the arguments are set up right before the call, the incoming ones of the entry are read earlier
+				for (int r = 0; r < 6; r++) {
+					if (lastDef[argumentRegisters[r]] > 0 && !readFixed(allocator, lastDef, argumentRegisters[r], use)) return 0;
+				}
+				for (int r = 0; r < (int)(sizeof(callerSaved) / sizeof(callerSaved[0])); r++) {
+					if (!writeFixed(allocator, lastDef, callerSaved[r], def)) return 0;
+				}
+				break;
+			case JMP_INSTR:
+				// a tail call passes its arguments in the same registers, but never comes back
+				for (int r = 0; instr->dst.kind == SYMBOL_OPERAND && r < 6; r++) {
+					if (lastDef[argumentRegisters[r]] > 0 && !readFixed(allocator, lastDef, argumentRegisters[r], use)) return 0;
+				}
+				break;
+			default:
+				break;
+		}
+	}
+
+	return 1;
+}
+
+static int buildIntervals(Allocator* allocator) {
+
+	MachineFunction* function = allocator->function;
+	allocator->intervals = malloc((allocator->vregCount + 1) * sizeof(Interval));
+
+	if (allocator->intervals == NULL) {
+		return 0;
+	}
+
+	for (int v = 0; v < allocator->vregCount; v++) {
+		allocator->intervals[v] = (Interval){v, -1, -1, NO_REG, NO_REG, 0};
+	}
+
+	int lastDef[R15_REG + 1];
+
+	for (int b = 0; b < allocator->blockCount; b++) {
+		int first = allocator->blockStarts[b];
+		int last = allocator->blockStarts[b + 1] - 1;
+
+		if (last < first) {
+			continue;
+		}
+
+		double weight = 1;
+		for (int d = 0; d < allocator->loopDepths[b] && d < 6; d++) {
+			weight *= 10;
+		}
+
+		for (int v = 0; v < allocator->vregCount; v++) {
+			if (testBit(&allocator->liveIn[(size_t)b * allocator->words], v)) {
+				extendInterval(&allocator->intervals[v], usePosition(first));
+			}
+			if (testBit(&allocator->liveOut[(size_t)b * allocator->words], v)) {
+				extendInterval(&allocator->intervals[v], defPosition(last));
+			}
+		}
+
+		for (int i = first; i <= last; i++) {
+			MachineInstr* instr = &function->code[i];
+			int src = virtualIndex(&instr->src);
+			int dst = virtualIndex(&instr->dst);
+
+			if (src >= 0) {
+				extendInterval(&allocator->intervals[src], usePosition(i));
+				allocator->intervals[src].spillCost += weight;
+			}
+			if (dst >= 0 && readsDestination(instr->opcode)) {
+				extendInterval(&allocator->intervals[dst], usePosition(i));
+			}
+			if (dst >= 0 && writesDestination(instr->opcode)) {
+				extendInterval(&allocator->intervals[dst], defPosition(i));
+			}
+			if (dst >= 0) {
+				allocator->intervals[dst].spillCost += weight;
+			}
+
+			// copies suggest giving both sides the same register
+			if (instr->opcode == MOV_INSTR && instr->dst.kind == REGISTER_OPERAND && instr->src.kind == REGISTER_OPERAND) {
+				if (dst >= 0 && allocator->intervals[dst].hint == NO_REG) {
+					allocator->intervals[dst].hint = instr->src.as.reg;
+				}
+				if (src >= 0 && dst < 0 && allocator->intervals[src].hint == NO_REG) {
+					allocator->intervals[src].hint = instr->dst.as.reg;
+				}
+			}
+		}
+
+		if (!collectFixedRanges(allocator, b, lastDef)) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static bool conflictsWithFixed(Allocator* allocator, Register reg, Interval* interval) {
+
+	FixedRanges* fixed = &allocator->fixed[reg];
+	int low = 0;
+	int high = fixed->count;
+
+	// the first range that ends at or after the start of the interval
+	while (low < high) {
+		int mid = (low + high) / 2;
+
+		if (fixed->ranges[mid].end < interval->start) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+
+	// ranges are sorted by start but may nest, the ones after the first can still start in the interval
+	for (int i = low; i < fixed->count && fixed->ranges[i].start <= interval->end; i++) {
+		if (fixed->ranges[i].end >= interval->start) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static int compareStarts(const void* a, const void* b) {
+	const Interval* left = *(Interval* const*)a;
+	const Interval* right = *(Interval* const*)b;
+
+	if (left->start != right->start) {
+		return left->start < right->start ? -1 : 1;
+	}
+	return left->vreg - right->vreg;
+}
+
+static bool isCheaper(Interval* interval, Interval* other) {
+	if (other == NULL || interval->spillCost != other->spillCost) {
+		return other == NULL || interval->spillCost < other->spillCost;
+	}
+	return interval->end > other->end;
+}
+
+// the slot is picked by assignSlots once it is known which intervals end up in memory
+static void spill(Allocator* allocator, Interval* interval) {
+	interval->assigned = NO_REG;
+	allocator->slots[interval->vreg] = 0;
+}
+
+static Register hintedRegister(Allocator* allocator, Interval* interval) {
+
+	Register hint = interval->hint;
+
+	if (hint >= FIRST_VIRTUAL_REG) {
+		return allocator->intervals[hint - FIRST_VIRTUAL_REG].assigned;
+	}
+
+	return hint;
+}
+
+static int linearScan(Allocator* allocator, bool stackOnly) {
+
+	int count = 0;
+	Interval** order = malloc((allocator->vregCount + 1) * sizeof(Interval*));
+	// the active intervals by the register they hold
+	Interval* active[R15_REG + 1] = {NULL};
+	allocator->slots = malloc((allocator->vregCount + 1) * sizeof(int));
+
+	if (order == NULL || allocator->slots == NULL) {
+		free(order);
+		return 0;
+	}
+
+	for (int v = 0; v < allocator->vregCount; v++) {
+		allocator->slots[v] = -1;
+
+		if (allocator->intervals[v].start >= 0) {
+			order[count++] = &allocator->intervals[v];
+		}
+	}
+
+	qsort(order, count, sizeof(Interval*), compareStarts);
+
+	for (int i = 0; i < count; i++) {
+		Interval* current = order[i];
+
+		if (stackOnly) {
+			spill(allocator, current);
+			continue;
+		}
+
+		for (int r = 0; r <= R15_REG; r++) {
+			if (active[r] != NULL && active[r]->end < current->start) {
+				active[r] = NULL;
+			}
+		}
+
+		Register chosen = NO_REG;
+		Register hint = hintedRegister(allocator, current);
+
+		if (hint != NO_REG && isAllocatable(hint) && active[hint] == NULL && !conflictsWithFixed(allocator, hint, current)) {
+			chosen = hint;
+		}
+
+		for (int r = 0; chosen == NO_REG && r < allocatableCount; r++) {
+			Register reg = allocatable[r];
+
+			if (active[reg] == NULL && !conflictsWithFixed(allocator, reg, current)) {
+				chosen = reg;
+			}
+		}
+
+		if (chosen != NO_REG) {
+			current->assigned = chosen;
+			active[chosen] = current;
+			continue;
+		}
+
+		// out of registers: the cheapest interval whose register could be used here gives it up,
+		// of equally cheap ones the one that reaches furthest
+		Interval* victim = NULL;
+
+		for (int r = 0; r < allocatableCount; r++) {
+			Register reg = allocatable[r];
+			Interval* candidate = active[reg];
+
+			if (candidate != NULL && isCheaper(candidate, victim) && !conflictsWithFixed(allocator, reg, current)) {
+				victim = candidate;
+			}
+		}
+
+		if (victim == NULL || !isCheaper(victim, current)) {
+			spill(allocator, current);
+			continue;
+		}
+
+		current->assigned = victim->assigned;
+		active[current->assigned] = current;
+		spill(allocator, victim);
+	}
+
+	free(order);
+	return 1;
+}
+
+// spilled intervals that do not overlap share a slot, which keeps the frame small.
+// in the order they start, every interval takes the first slot whose last interval ended before
+static int assignSlots(Allocator* allocator) {
+
+	int count = 0;
+	Interval** order = malloc((allocator->vregCount + 1) * sizeof(Interval*));
+	// end of the last interval in every slot
+	int* slotEnds = malloc((allocator->vregCount + 1) * sizeof(int));
+
+	if (order == NULL || slotEnds == NULL) {
+		free(order);
+		free(slotEnds);
+		return 0;
+	}
+
+	for (int v = 0; v < allocator->vregCount; v++) {
+		if (allocator->slots[v] >= 0) {
+			order[count++] = &allocator->intervals[v];
+		}
+	}
+
+	qsort(order, count, sizeof(Interval*), compareStarts);
+
+	for (int i = 0; i < count; i++) {
+		Interval* current = order[i];
+		int slot = 0;
+
+		while (slot < allocator->slotCount && slotEnds[slot] >= current->start) {
+			slot++;
+		}
+
+		if (slot == allocator->slotCount) {
+			allocator->slotCount++;
+		}
+
+		slotEnds[slot] = current->end;
+		allocator->slots[current->vreg] = slot;
+	}
+
+	free(order);
+	free(slotEnds);
+	return 1;
+}
+
+static Operand slotOperand(Allocator* allocator, Operand* operand) {
+	return frameOperand(-8 * (allocator->slots[virtualIndex(operand)] + 1), operand->size);
+}
+
+static bool isMemoryOperand(Operand* operand) {
+	return operand->kind == FRAME_OPERAND || operand->kind == GLOBAL_OPERAND;
+}
+
+static void put(MachineInstr* code, int* size, Opcode opcode, Condition condition, Operand dst, Operand src) {
+	code[(*size)++] = (MachineInstr){opcode, condition, dst, src};
+}
+
+// allocated virtual registers become their hardware register
+static void assignOperand(Allocator* allocator, Operand* operand) {
+
+	int vreg = virtualIndex(operand);
+
+	if (vreg >= 0 && allocator->intervals[vreg].assigned != NO_REG) {
+		operand->as.reg = allocator->intervals[vreg].assigned;
+	}
+}
+
+// spilled virtual registers live in their frame slot and go through a scratch register where an
+// instruction needs them in a register
+static int rewrite(Allocator* allocator) {
+
+	MachineFunction* function = allocator->function;
+	// an instruction grows to at most two loads, itself and a store
+	int capacity = function->size * 4 + 1;
+	MachineInstr* code = malloc(capacity * sizeof(MachineInstr));
+
+	if (code == NULL) {
+		return 0;
+	}
+
+	int size = 0;
+
+	for (int i = 0; i < function->size; i++) {
+		MachineInstr* instr = &function->code[i];
+		Operand dst = instr->dst;
+		Operand src = instr->src;
+
+		assignOperand(allocator, &dst);
+		assignOperand(allocator, &src);
+
+		bool spilledDst = isVirtualRegister(&dst);
+		bool spilledSrc = isVirtualRegister(&src);
+
+		if (!spilledDst && !spilledSrc) {
+			// both sides of the copy ended up in the same register
+			bool sameRegister = dst.kind == REGISTER_OPERAND && src.kind == REGISTER_OPERAND && dst.as.reg == src.as.reg && dst.size == src.size;
+
+			if (instr->opcode != MOV_INSTR || !sameRegister) {
+				put(code, &size, instr->opcode, instr->condition, dst, src);
+			}
+			continue;
+		}
+
+		// moves between a slot and a register or an immediate need no scratch register
+		if (instr->opcode == MOV_INSTR && spilledDst && !spilledSrc && !isMemoryOperand(&src)) {
+			put(code, &size, MOV_INSTR, NO_COND, slotOperand(allocator, &dst), src);
+			continue;
+		}
+		if (instr->opcode == MOV_INSTR && spilledSrc && !spilledDst && dst.kind == REGISTER_OPERAND) {
+			put(code, &size, MOV_INSTR, NO_COND, dst, slotOperand(allocator, &src));
+			continue;
+		}
+		if (instr->opcode == MOV_INSTR && spilledDst && spilledSrc) {
+			Operand scratch = registerOperand(SOURCE_SCRATCH, src.size);
+			put(code, &size, MOV_INSTR, NO_COND, scratch, slotOperand(allocator, &src));
+			put(code, &size, MOV_INSTR, NO_COND, slotOperand(allocator, &dst), scratch);
+			continue;
+		}
+
+		if (spilledSrc) {
+			Operand scratch = registerOperand(SOURCE_SCRATCH, src.size);
+			put(code, &size, MOV_INSTR, NO_COND, scratch, slotOperand(allocator, &src));
+			src = scratch;
+		}
+
+		Operand slot = dst;
+		if (spilledDst) {
+			slot = slotOperand(allocator, &dst);
+			dst = registerOperand(DESTINATION_SCRATCH, dst.size);
+
+			if (readsDestination(instr->opcode)) {
+				put(code, &size, MOV_INSTR, NO_COND, dst, slot);
+			}
+		}
+
+		put(code, &size, instr->opcode, instr->condition, dst, src);
+
+		if (spilledDst && writesDestination(instr->opcode)) {
+			put(code, &size, MOV_INSTR, NO_COND, slot, dst);
+		}
+	}
+
+	free(function->code);
+	function->code = code;
+	function->size = size;
+	function->capacity = capacity;
+	function->frameSize = 8 * allocator->slotCount;
+	return 1;
+}
+
+static void freeAllocator(Allocator* allocator) {
+	free(allocator->blockStarts);
+	free(allocator->successors);
+	free(allocator->loopDepths);
+	free(allocator->uses);
+	free(allocator->defs);
+	free(allocator->liveIn);
+	free(allocator->liveOut);
+	free(allocator->intervals);
+	free(allocator->slots);
+
+	for (int r = 0; r <= R15_REG; r++) {
+		free(allocator->fixed[r].ranges);
+	}
+}
+
+int allocateRegisters(MachineFunction* function, bool stackOnly) {
+
+	if (function == NULL) {
+		return 0;
+	}
+
+	Allocator allocator = {0};
+	allocator.function = function;
+	allocator.vregCount = function->registerCount;
+
+	int success = splitBlocks(&allocator)
+		&& computeLoopDepths(&allocator)
+		&& computeLiveness(&allocator)
+		&& buildIntervals(&allocator)
+		&& linearScan(&allocator, stackOnly)
+		&& assignSlots(&allocator)
+		&& rewrite(&allocator);
+
+	freeAllocator(&allocator);
+	return success;
+}
@@ -0,0 +1,12 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include "machineIR.h"
+#include <stdbool.h>
+
+// replaces the virtual registers of the function with hardware registers and stack slots,
+// the frame size of the function is set afterwards. stackOnly puts every value into a slot,
+// like compilers do without optimizations
+int allocateRegisters(MachineFunction* function, bool stackOnly);
+
+#endif
@@ -0,0 +1,295 @@
+#include "resolver.h"
+#include "parser.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int resolveNames(Resolver* resolver);
+int resolveStatement(Resolver* resolver, Statement* statement);
+int resolveFunctionStmt(Resolver* resolver, FunctionStmt* function);
+int resolveBlockStmt(Resolver* resolver, BlockStmt* blockStmt, bool scopeEntered);
+int resolveIfStmt(Resolver* resolver, IfStmt* ifStmt);
+int resolveExpression(Resolver* resolver, Expression* expression);
+int resolveVariable(Resolver* resolver, Variable* variable, bool declare);
+int declareVariable(Resolver* resolver, Variable* variable);
+void freeResolver(Resolver* resolver);
+
+Resolver* initializeResolver(DynamicArray* ast, Arena* arena) {
+
+	if (ast == NULL || arena == NULL) {
+		return NULL;
+	}
+
+	Resolver* resolver = calloc(1, sizeof(Resolver));
+
+	if (resolver == NULL) {
+		return NULL;
+	}
+
+	resolver->ast = ast;
+	resolver->arena = arena;
+	resolver->scopes = scopeStack();
+
+	// global scope
+	if (resolver->scopes == NULL || !enterScope(resolver->scopes)) {
+		freeResolver(resolver);
+		return NULL;
+	}
+
+	resolver->declarations = dynamicArray(2, NULL);
+
+	if (resolver->declarations == NULL) {
+		freeResolver(resolver);
+		return NULL;
+	}
+
+	return resolver;
+}
+
+int resolveNames(Resolver* resolver) {
+
+	if (resolver == NULL) {
+		return 0;
+	}
+
+	for (int i = 0; i < resolver->ast->size; i++) {
+		if (!resolveStatement(resolver, resolver->ast->array[i])) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+int resolveStatement(Resolver* resolver, Statement* statement) {
+
+	if (resolver == NULL || statement == NULL) {
+		return 0;
+	}
+
+	switch (statement->type) {
+		case EXPRESSION_STMT:
+			// a lone variable is an implicit declaration
+			if (statement->as.expression->type == VARIABLE_EXPR) {
+				return resolveVariable(resolver, statement->as.expression->as.variable, true);
+			}
+			return resolveExpression(resolver, statement->as.expression);
+		case FUNCTION_STMT:
+			return resolveFunctionStmt(resolver, statement->as.function);
+		case BLOCK_STMT:
+			return resolveBlockStmt(resolver, statement->as.blockStmt, false);
+		case WHILE_STMT:
+			if (!resolveExpression(resolver, statement->as.whileStmt->condition)) return 0;
+			return resolveBlockStmt(resolver, statement->as.whileStmt->body, false);
+		case IF_STMT:
+			return resolveIfStmt(resolver, statement->as.ifStmt);
+		case RETURN_STMT:
+			return resolveExpression(resolver, statement->as.returnStmt->expression);
+		case DECLARATION_STMT:
+		default:
+			fprintf(stderr, "Error: unexpected Statement type in resolveStatement\n");
+			return 0;
+	}
+}
+
+int resolveFunctionStmt(Resolver* resolver, FunctionStmt* function) {
+
+	if (resolver == NULL || function == NULL) {
+		return 0;
+	}
+
+	if (resolver->scopes->depth != 1) {
+		fprintf(stderr, "Error: Function Declarations only allowed in Global Scope\n");
+		return 0;
+	}
+
+	// the parameters live in the same scope as the function body
+	if (!enterScope(resolver->scopes)) return 0;
+
+	resolver->currentFunction = function;
+	resolver->currentBlock = function->blockStmt;
+	function->localCount = 0;
+
+	for (int i = 0; i < function->params->size; i++) {
+		Variable* param = (Variable*)function->params->array[i];
+		Binding* binding = lookupBinding(resolver->scopes, param->id);
+
+		if (binding != NULL && binding->scope == 0) {
+			fprintf(stderr, "Error: In Function %s: Shadowing Globals with Function Prameters is not allowed\n", function->id);
+			return 0;
+		}
+
+		if (binding != NULL) {
+			fprintf(stderr, "Error: Found duplicate alias \"%s\" in Function for Function Paramter %d in Function \"%s\"\n", param->id, i, function->id);
+			return 0;
+		}
+
+		if (!declareVariable(resolver, param)) return 0;
+	}
+
+	if (!resolveBlockStmt(resolver, function->blockStmt, true)) return 0;
+
+	resolver->currentFunction = NULL;
+	resolver->currentBlock = NULL;
+	return 1;
+}
+
+// if scopeEntered is set the caller already opened the scope of the block, e.g. for parameters
+int resolveBlockStmt(Resolver* resolver, BlockStmt* blockStmt, bool scopeEntered) {
+
+	if (resolver == NULL || blockStmt == NULL) {
+		return 0;
+	}
+
+	if (!scopeEntered && !enterScope(resolver->scopes)) return 0;
+
+	BlockStmt* outerBlock = resolver->currentBlock;
+	resolver->currentBlock = blockStmt;
+
+	// an assignment statement declares its variable for the whole block, the same way
+	// codegen reserves the stack space of a block up front
+	for (int i = 0; i < blockStmt->stmts->size; i++) {
+		Statement* statement = (Statement*)blockStmt->stmts->array[i];
+
+		if (statement->type == EXPRESSION_STMT && statement->as.expression->type == ASSIGN_EXPR) {
+			Variable* variable = statement->as.expression->as.assignment->variable;
+			if (lookupBinding(resolver->scopes, variable->id) == NULL && !declareVariable(resolver, variable)) {
+				return 0;
+			}
+		}
+	}
+
+	for (int i = 0; i < blockStmt->stmts->size; i++) {
+		if (!resolveStatement(resolver, blockStmt->stmts->array[i])) {
+			return 0;
+		}
+	}
+
+	resolver->currentBlock = outerBlock;
+	exitScope(resolver->scopes);
+	return 1;
+}
+
+int resolveIfStmt(Resolver* resolver, IfStmt* ifStmt) {
+
+	if (resolver == NULL || ifStmt == NULL) {
+		return 0;
+	}
+
+	if (!resolveExpression(resolver, ifStmt->condition)) return 0;
+	if (!resolveBlockStmt(resolver, ifStmt->trueBody, false)) return 0;
+
+	if (ifStmt->type == IF_ELSE) {
+		return resolveBlockStmt(resolver, ifStmt->as.ifElse, false);
+	}
+
+	if (ifStmt->type == IF_ELSE_IF) {
+		return resolveIfStmt(resolver, ifStmt->as.ifElseIf);
+	}
+
+	return 1;
+}
+
+int resolveExpression(Resolver* resolver, Expression* expression) {
+
+	if (resolver == NULL || expression == NULL) {
+		return 0;
+	}
+
+	switch (expression->type) {
+		case EXPR_WRAPPER_EXPR:
+			return resolveExpression(resolver, expression->as.expWrap);
+		case FUNCTIONCALL_EXPR:
+			for (int i = 0; i < expression->as.functionCall->params->size; i++) {
+				if (!resolveExpression(resolver, expression->as.functionCall->params->array[i])) return 0;
+			}
+			return 1;
+		case ASSIGN_EXPR:
+			if (!resolveExpression(resolver, expression->as.assignment->expression)) return 0;
+			return resolveVariable(resolver, expression->as.assignment->variable, true);
+		case BINOP_EXPR:
+			if (!resolveExpression(resolver, expression->as.binop->left)) return 0;
+			return resolveExpression(resolver, expression->as.binop->right);
+		case UNARY_EXPR:
+			return resolveExpression(resolver, expression->as.unop->right);
+		case VARIABLE_EXPR: {
+			// a variable with a type annotation declares itself
+			Variable* variable = expression->as.variable;
+			return resolveVariable(resolver, variable, variable->type != UNKNOWN);
+		}
+		case VALUE_EXPR:
+			return 1;
+		default:
+			fprintf(stderr, "Error: unexpected Expression type in resolveExpression\n");
+			return 0;
+	}
+}
+
+// names that are not visible stay unresolved unless declare is set, the type checker reports them
+int resolveVariable(Resolver* resolver, Variable* variable, bool declare) {
+
+	if (resolver == NULL || variable == NULL) {
+		return 0;
+	}
+
+	Binding* binding = lookupBinding(resolver->scopes, variable->id);
+
+	if (binding != NULL) {
+		Variable* declaration = (Variable*)resolver->declarations->array[binding->value];
+		variable->kind = declaration->kind;
+		variable->slot = declaration->slot;
+		variable->scope = declaration->scope;
+		return 1;
+	}
+
+	if (!declare) {
+		variable->kind = UNRESOLVED_SYMBOL;
+		return 1;
+	}
+
+	return declareVariable(resolver, variable);
+}
+
+// everything outside of a function is global data, locals get the next frame slot of their function
+int declareVariable(Resolver* resolver, Variable* variable) {
+
+	if (resolver == NULL || variable == NULL) {
+		return 0;
+	}
+
+	variable->declaration = true;
+	variable->scope = resolver->scopes->depth - 1;
+
+	if (resolver->currentFunction != NULL) {
+		variable->kind = LOCAL_SYMBOL;
+		variable->slot = resolver->currentFunction->localCount++;
+
+		// most blocks declare nothing, so their list is only created on demand
+		BlockStmt* block = resolver->currentBlock;
+		if (block->locals == NULL) {
+			block->locals = arenaDynamicArray(resolver->arena, 2);
+		}
+		if (!pushItem(block->locals, variable)) return 0;
+	}
+	else {
+		variable->kind = GLOBAL_SYMBOL;
+		variable->slot = resolver->globalCount++;
+	}
+
+	if (!pushItem(resolver->declarations, variable)) return 0;
+
+	if (!declareBinding(resolver->scopes, variable->id, resolver->declarations->size - 1)) {
+		fprintf(stderr, "Error: Could not declare variable %s\n", variable->id);
+		return 0;
+	}
+
+	return 1;
+}
+
+void freeResolver(Resolver* resolver) {
+	if (resolver == NULL) return;
+	freeScopeStack(resolver->scopes);
+	freeArray(resolver->declarations);
+	free(resolver);
+}
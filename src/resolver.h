@@ -0,0 +1,26 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include "parser.h"
+#include "utils.h"
+
+typedef struct Resolver Resolver;
+
+// binds every variable occurrence to its declaration once, so the type checker
+// and codegen can read the slot from the ast instead of looking names up again
+struct Resolver {
+	DynamicArray* ast;
+	Arena* arena;
+	ScopeStack* scopes;
+	// declaring variables, indexed by the binding values in scopes
+	DynamicArray* declarations;
+	FunctionStmt* currentFunction;
+	BlockStmt* currentBlock;
+	int globalCount;
+};
+
+Resolver* initializeResolver(DynamicArray* ast, Arena* arena);
+int resolveNames(Resolver* resolver);
+void freeResolver(Resolver* resolver);
+
+#endif
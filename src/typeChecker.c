@@ -8,7 +8,7 @@
 int checkTypes(TypeChecker* typeChecker);
 int checkStatement(TypeChecker* typeChecker, Statement* statement);
 int checkFunctionStmt(TypeChecker* typeChecker, FunctionStmt* function);
-int checkBlockStmt(TypeChecker* typeChecker, BlockStmt* blockStmt, HashTable* scope);
+int checkBlockStmt(TypeChecker* typeChecker, BlockStmt* blockStmt);
 int checkWhileStmt(TypeChecker* typeChecker, WhileStmt* whileStmt);
 int checkIfStmt(TypeChecker* typeChecker, IfStmt* ifStmt);
 int checkReturnStmt(TypeChecker* typeChecker, ReturnStmt* returnStmt);
@@ -19,11 +19,11 @@ ValueType checkBinOperation(TypeChecker* typeChecker, BinOperation* binOperation
 ValueType checkUnaryOperation(TypeChecker* typeChecker, UnaryOperation* unaryOperation);
 ValueType checkVariable(TypeChecker* typeChecker, Variable* variable);
 ValueType checkValue(TypeChecker* typeChecker, Value* value);
-ValueType getVarTypeFromScopes(TypeChecker* typeChecker, char* id);
-HashTable* getVarScope(TypeChecker* typeChecker, char* id);
+ValueType* getSlotType(TypeChecker* typeChecker, Variable* variable);
+ValueType getVariableType(TypeChecker* typeChecker, Variable* variable);
 void freeChecker(TypeChecker* typeChecker);
 
-TypeChecker* initializeChecker (DynamicArray* ast) {
+TypeChecker* initializeChecker (DynamicArray* ast, int globalCount) {
 	
 	if (ast == NULL) {
 		return NULL;
@@ -36,26 +36,19 @@ TypeChecker* initializeChecker (DynamicArray* ast) {
 	}
 
 	typeChecker->ast = ast;
-	typeChecker->typeScopes = dynamicArray(2, freeTable);
+	typeChecker->globalCount = globalCount;
+	typeChecker->globalTypes = malloc((globalCount + 1) * sizeof(ValueType));
 
-	if (typeChecker->typeScopes == NULL) {
+	if (typeChecker->globalTypes == NULL) {
 		freeChecker(typeChecker);
 		return NULL;
 	}
 
-	HashTable* typeTable = hashTable(256, free);
-
-	if (typeTable == NULL) {
-		freeChecker(typeChecker);
-		return NULL;
-	}
-
-	if (!pushItem(typeChecker->typeScopes, typeTable))  {
-		freeChecker(typeChecker);
-		return NULL;
+	for (int i = 0; i < globalCount; i++) {
+		typeChecker->globalTypes[i] = -1;
 	}
 
-	HashTable* functions = hashTable(256, NULL);
+	HashTable* functions = symbolTable(256, NULL);
 
 	if (functions == NULL) {
 		freeChecker(typeChecker);
@@ -76,24 +69,18 @@ int checkTypes(TypeChecker* typeChecker) {
 	for (int i = 0; i < typeChecker->ast->size; i++) {
 		if (!checkStatement(typeChecker, typeChecker->ast->array[i])) { 
 
-			freeArray(typeChecker->typeScopes);
-			freeTable(typeChecker->functions);
-			typeChecker->typeScopes = dynamicArray(2, freeTable);
-			typeChecker->functions = hashTable(256, NULL);
-
-			if (typeChecker->typeScopes == NULL || typeChecker->functions == NULL) {
-				freeChecker(typeChecker);
-				return 0;
+			// forget everything the failed check learned
+			for (int j = 0; j < typeChecker->globalCount; j++) {
+				typeChecker->globalTypes[j] = -1;
 			}
 
-			HashTable* typeTable = hashTable(256, free);
+			free(typeChecker->localTypes);
+			typeChecker->localTypes = NULL;
 
-			if (typeTable == NULL) {
-				freeChecker(typeChecker);
-				return 0;
-			}
+			freeTable(typeChecker->functions);
+			typeChecker->functions = symbolTable(256, NULL);
 
-			if (!pushItem(typeChecker->typeScopes, typeTable))  {
+			if (typeChecker->functions == NULL) {
 				freeChecker(typeChecker);
 				return 0;
 			}
@@ -117,17 +104,15 @@ int checkStatement(TypeChecker* typeChecker, Statement* statement) {
 			Expression* expression = statement->as.expression;
 			if (expression->type == VARIABLE_EXPR) {
 				Variable* variable = expression->as.variable;
-				ValueType valueType = getVarTypeFromScopes(typeChecker, variable->id);
-				// variable is not in any scope
+				ValueType valueType = getVariableType(typeChecker, variable);
+				// variable is not declared yet
 				if (valueType == -1) {
-					HashTable* currentScope = (HashTable*)peekArray(typeChecker->typeScopes);
-					int* unknownValue = malloc(sizeof(int));
-					if (unknownValue == NULL) return 0;
-					*unknownValue = (int)UNKNOWN;
-					if (!insertKeyPair(currentScope, variable->id, unknownValue)) {
+					ValueType* slotType = getSlotType(typeChecker, variable);
+					if (slotType == NULL) {
 						fprintf(stderr, "Error: Could not declare variable %s\n", variable->id);
 						return 0;
 					}
+					*slotType = UNKNOWN;
 					expression->valueType = UNKNOWN;
 					return 1;
 				}
@@ -137,7 +122,7 @@ int checkStatement(TypeChecker* typeChecker, Statement* statement) {
 		case FUNCTION_STMT:
 			return checkFunctionStmt(typeChecker, statement->as.function);
 		case BLOCK_STMT:
-			return checkBlockStmt(typeChecker, statement->as.blockStmt, NULL);
+			return checkBlockStmt(typeChecker, statement->as.blockStmt);
 		case WHILE_STMT:
 			return checkWhileStmt(typeChecker, statement->as.whileStmt);
 		case IF_STMT:
@@ -247,11 +232,11 @@ ValueType checkAssignment(TypeChecker* typeChecker, Assignment* assignment) {
 	ValueType expressionType = assignment->expression->valueType;
 
 	Variable* variable = assignment->variable;
-	ValueType variableType = getVarTypeFromScopes(typeChecker, variable->id);
+	ValueType variableType = getVariableType(typeChecker, variable);
+	ValueType* slotType = getSlotType(typeChecker, variable);
 
-	// is not in scope, can be added to current scope
+	// first assignment, this declares the type
 	if (variableType == -1) {
-		HashTable* currentScope = (HashTable*)peekArray(typeChecker->typeScopes);
 
 		// type needs to be inferred
 		if (variable->type == UNKNOWN) {
@@ -264,23 +249,17 @@ ValueType checkAssignment(TypeChecker* typeChecker, Assignment* assignment) {
 				return -1;
 			}
 		}
-		int* varType = malloc(sizeof(int));
-		if (varType == NULL) return -1;
-		*varType = (int)variable->type;
-		if(!insertKeyPair(currentScope, variable->id, varType)) return -1;
+		if (slotType == NULL) return -1;
+		*slotType = variable->type;
 	}
 
-	// is in one scope
+	// already declared
 	else { 
-		HashTable* varScope = getVarScope(typeChecker, variable->id);
 		// not initialized
 		if (variableType == UNKNOWN) {
 
 			variable->type = expressionType;
-			int* varType = malloc(sizeof(int));
-			if (varType == NULL) return -1;
-			*varType = (int)variable->type;
-			if(!updateKeyPair(varScope, variable->id, varType)) return -1;
+			*slotType = variable->type;
 		}
 	
 		// type mismatch
@@ -376,19 +355,15 @@ ValueType checkVariable(TypeChecker* typeChecker, Variable* variable) {
 		return -1;
 	}
 
-	ValueType type = getVarTypeFromScopes(typeChecker, variable->id);
-	// is not in scope
+	ValueType type = getVariableType(typeChecker, variable);
+	// is not declared yet
 	if (type == -1) {
 		// has annotated type
-		if (variable->type != UNKNOWN) {
-
-			HashTable* currentScope = (HashTable*)peekArray(typeChecker->typeScopes);
+		ValueType* slotType = getSlotType(typeChecker, variable);
+		if (variable->type != UNKNOWN && slotType != NULL) {
 
-			int* varType = malloc(sizeof(int));
-			if (varType == NULL) return -1;
-			*varType = (int)variable->type;
-			if(!insertKeyPair(currentScope, variable->id, varType)) return -1;
-			return *varType;
+			*slotType = variable->type;
+			return variable->type;
 		}
 		fprintf(stderr, "Error: Tried to Access Uninitialized Variable \"%s\"\n", variable->id);
 		return -1;
@@ -411,11 +386,6 @@ int checkFunctionStmt(TypeChecker* typeChecker, FunctionStmt* function) {
 		return 0;
 	}
 
-	if (typeChecker->typeScopes->size != 1) {
-		fprintf(stderr, "Error: Function Declarations only allowed in Global Scope\n");
-		return 0;
-	}
-
 	if (containsKey(typeChecker->functions, function->id)) {
 		fprintf(stderr, "Error: Already Declared Function with id \"%s\" is Declared again\n", function->id);
 		return 0;
@@ -423,33 +393,27 @@ int checkFunctionStmt(TypeChecker* typeChecker, FunctionStmt* function) {
 
 	if (!insertKeyPair(typeChecker->functions, function->id, function)) return 0;
 
-	HashTable* newScope = hashTable(256, free);
-	if (newScope == NULL) return 0;
+	// parameter names were checked by the resolver, they are the first slots of the frame
+	free(typeChecker->localTypes);
+	typeChecker->localTypes = malloc((function->localCount + 1) * sizeof(ValueType));
+	if (typeChecker->localTypes == NULL) return 0;
 
-	for (int i = 0; i < function->params->size; i++) {
-		char* varId = ((Variable*)(function->params->array[i]))->id;
-
-		if (getVarTypeFromScopes(typeChecker, varId) != -1) {
-			freeTable(newScope);
-			fprintf(stderr, "Error: In Function %s: Shadowing Globals with Function Prameters is not allowed\n", function->id);
-			return 0;
-		}
+	for (int i = 0; i < function->localCount; i++) {
+		typeChecker->localTypes[i] = -1;
+	}
 
-		int* varType = malloc(sizeof(int));
-		if (varType == NULL) return -1;
-		*varType = ((Variable*)(function->params->array[i]))->type;
-		if (!insertKeyPair(newScope, varId, varType)) {
-			fprintf(stderr, "Error: Found duplicate alias \"%s\" in Function for Function Paramter %d in Function \"%s\"\n", varId, i, function->id);
-			free(varType);
-			freeTable(newScope);
-			return 0;
-		}
+	for (int i = 0; i < function->params->size; i++) {
+		Variable* param = (Variable*)function->params->array[i];
+		typeChecker->localTypes[param->slot] = param->type;
 	}
 
-	if (!checkBlockStmt(typeChecker, function->blockStmt, newScope)) {
+	if (!checkBlockStmt(typeChecker, function->blockStmt)) {
 		return 0;
 	}
 
+	free(typeChecker->localTypes);
+	typeChecker->localTypes = NULL;
+
 	if (function->blockStmt->stmts->size < 1) {
 		fprintf(stderr, "Error: In Function %s: Function is missing Return Statement\n", function->id);
 		return 0;
@@ -470,34 +434,17 @@ int checkFunctionStmt(TypeChecker* typeChecker, FunctionStmt* function) {
 	return 1;
 }
 
-int checkBlockStmt(TypeChecker* typeChecker, BlockStmt* blockStmt, HashTable* scope) {
+int checkBlockStmt(TypeChecker* typeChecker, BlockStmt* blockStmt) {
 	if (typeChecker == NULL || blockStmt == NULL) {
 		return 0;
 	}
 
-	HashTable* blockScope;
-
-	if (scope != NULL) {
-		blockScope = scope;
-	}
-	else {
-		blockScope = hashTable(256, free);
-	}
-
-	if (blockScope == NULL) return 0;
-
-	if (!pushItem(typeChecker->typeScopes, blockScope)) {
-		freeTable(blockScope);
-		return 0;
-	}
-
 	for (int i = 0; i < blockStmt->stmts->size; i++) {
 		if(!checkStatement(typeChecker, blockStmt->stmts->array[i])) {
 			return 0;
 		}
 	}
 
-	freeTable(popItem(typeChecker->typeScopes));
 	return 1;
 }
 
@@ -512,7 +459,7 @@ int checkWhileStmt(TypeChecker* typeChecker, WhileStmt* whileStmt) {
 		fprintf(stderr, "Error: Condition of WhileStatement is not of type boolean\n");
 		return 0;
 	}
-	if(!checkBlockStmt(typeChecker, whileStmt->body, NULL)) return 0;
+	if(!checkBlockStmt(typeChecker, whileStmt->body)) return 0;
 
 	return 1;
 }
@@ -529,10 +476,10 @@ int checkIfStmt(TypeChecker* typeChecker, IfStmt* ifStmt) {
 		return 0;
 	}
 
-	if(!checkBlockStmt(typeChecker, ifStmt->trueBody, NULL)) return 0;
+	if(!checkBlockStmt(typeChecker, ifStmt->trueBody)) return 0;
 
 	if (ifStmt->type == IF_ELSE) {
-		if(!checkBlockStmt(typeChecker, ifStmt->as.ifElse, NULL)) return 0;
+		if(!checkBlockStmt(typeChecker, ifStmt->as.ifElse)) return 0;
 	}
 
 	else if (ifStmt->type == IF_ELSE_IF) {
@@ -551,39 +498,31 @@ int checkReturnStmt(TypeChecker* typeChecker, ReturnStmt* returnStmt) {
 	return 1;
 }
 
-ValueType getVarTypeFromScopes(TypeChecker* typeChecker, char* id) {
-	if (typeChecker == NULL || id == NULL) {
-		return -1;
-	}
-
-	for (int i = 0; i < typeChecker->typeScopes->size; i++) {
-		if (containsKey(typeChecker->typeScopes->array[i], id)) {
-			void* value = getValue((HashTable*)typeChecker->typeScopes->array[i], id);
-			if (value == NULL) return -1;
-			return (ValueType)*(int*)(value);
-		}
-	}
-
-	return -1;
-}
-
-HashTable* getVarScope(TypeChecker* typeChecker, char* id) {
-	if (typeChecker == NULL || id == NULL) {
+// the type of a resolved variable is stored by its slot, unresolved variables have none
+ValueType* getSlotType(TypeChecker* typeChecker, Variable* variable) {
+	if (typeChecker == NULL || variable == NULL) {
 		return NULL;
 	}
 
-	for (int i = 0; i < typeChecker->typeScopes->size; i++) {
-		if (containsKey(typeChecker->typeScopes->array[i], id)) {
-			return (HashTable*)typeChecker->typeScopes->array[i];
-		}
+	switch (variable->kind) {
+		case GLOBAL_SYMBOL:
+			return &typeChecker->globalTypes[variable->slot];
+		case LOCAL_SYMBOL:
+			return typeChecker->localTypes != NULL ? &typeChecker->localTypes[variable->slot] : NULL;
+		default:
+			return NULL;
 	}
+}
 
-	return NULL;
+ValueType getVariableType(TypeChecker* typeChecker, Variable* variable) {
+	ValueType* slotType = getSlotType(typeChecker, variable);
+	return slotType != NULL ? *slotType : -1;
 }
 
 void freeChecker(TypeChecker* typeChecker) {
 	if (typeChecker == NULL) return;
-	freeArray(typeChecker->typeScopes);
+	free(typeChecker->globalTypes);
+	free(typeChecker->localTypes);
 	freeTable(typeChecker->functions);
 	free(typeChecker);
 }
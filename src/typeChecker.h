@@ -1,16 +1,20 @@
 #ifndef TYPECHECKER_H
 #define TYPECHECKER_H
 
+#include "parser.h"
 #include "utils.h"
 typedef struct TypeChecker TypeChecker;
 
 struct TypeChecker {
 	DynamicArray* ast;
-	DynamicArray* typeScopes;
+	// types by resolver slot, -1 until the variable got its first assignment
+	ValueType* globalTypes;
+	int globalCount;
+	ValueType* localTypes;
 	HashTable* functions;
 };
 
-TypeChecker* initializeChecker (DynamicArray* ast);
+TypeChecker* initializeChecker (DynamicArray* ast, int globalCount);
 int checkTypes(TypeChecker* typeChecker);
 void freeChecker(TypeChecker* typeChecker);
 
@@ -1,6 +1,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include "utils.h"
 
@@ -17,6 +18,7 @@ DynamicArray *dynamicArray(int growthFactor, GenericFreeFunc freeFunc) {
 	dynamicArray->minSize = MINUMUM_SIZE;
 	dynamicArray->size = 0;
 	dynamicArray->freeFunc = freeFunc;
+	dynamicArray->arena = NULL;
 	dynamicArray->array = malloc(INITIAL_CAPACITY * sizeof(void*));
 
 	if (dynamicArray->array == NULL) {
@@ -28,6 +30,34 @@ DynamicArray *dynamicArray(int growthFactor, GenericFreeFunc freeFunc) {
 	return dynamicArray;
 }
 
+DynamicArray* arenaDynamicArray(Arena* arena, int growthFactor) {
+	if (arena == NULL) {
+		return NULL;
+	}
+
+	DynamicArray* dynamicArray = arenaAlloc(arena, sizeof(DynamicArray));
+
+	if (dynamicArray == NULL) {
+		fprintf(stderr, "failed to allocate dynamic array in arena");
+		return NULL;
+	}
+
+	dynamicArray->growthFactor = growthFactor;
+	dynamicArray->maxSize = INITIAL_CAPACITY;
+	dynamicArray->minSize = MINUMUM_SIZE;
+	dynamicArray->size = 0;
+	dynamicArray->freeFunc = NULL;
+	dynamicArray->arena = arena;
+	dynamicArray->array = arenaAlloc(arena, INITIAL_CAPACITY * sizeof(void*));
+
+	if (dynamicArray->array == NULL) {
+		fprintf(stderr, "failed to allocate static array in dynamic array in arena");
+		return NULL;
+	}
+
+	return dynamicArray;
+}
+
 void* getItem(DynamicArray* dynamicArray, int idx) {
 	if (dynamicArray == NULL) {
 		return NULL;
@@ -61,7 +91,18 @@ int pushItem(DynamicArray *dynamicArray, void *item) {
 	if (dynamicArray->size == dynamicArray->maxSize) {
 
 		dynamicArray->maxSize *= dynamicArray->growthFactor;
-		void** tmp = realloc(dynamicArray->array, dynamicArray->maxSize * sizeof(void*));
+		void** tmp;
+
+		// arena storage cannot be resized in place, the old block stays in the arena until it is freed
+		if (dynamicArray->arena) {
+			tmp = arenaAlloc(dynamicArray->arena, dynamicArray->maxSize * sizeof(void*));
+			if (tmp != NULL) {
+				memcpy(tmp, dynamicArray->array, dynamicArray->size * sizeof(void*));
+			}
+		}
+		else {
+			tmp = realloc(dynamicArray->array, dynamicArray->maxSize * sizeof(void*));
+		}
 
 		if (tmp == NULL) {
 			fprintf(stderr, "Error: failed to allocate static array in dynamic array in pushItem");
@@ -84,7 +125,7 @@ void* popItem(DynamicArray* dynamicArray) {
 	dynamicArray->array[dynamicArray->size-1] = NULL;
 	dynamicArray->size--;
 
-	if (dynamicArray->size <= dynamicArray->maxSize / dynamicArray->growthFactor && dynamicArray->size > MINUMUM_SIZE) {
+	if (dynamicArray->arena == NULL && dynamicArray->size <= dynamicArray->maxSize / dynamicArray->growthFactor && dynamicArray->size > MINUMUM_SIZE) {
 
 		dynamicArray->maxSize /= dynamicArray->growthFactor;
 		void** tmp = realloc(dynamicArray->array, dynamicArray->maxSize * sizeof(void*));
@@ -109,144 +150,437 @@ void freeArray(DynamicArray* dynamicArray) {
 			dynamicArray->freeFunc(dynamicArray->array[i]);
 		}
 	}
+
+	if (dynamicArray->arena) {
+		return;
+	}
+
 	free(dynamicArray->array);
 	free(dynamicArray);
 };
 
+Arena* arena(size_t chunkSize) {
+	Arena* arena = malloc(sizeof(Arena));
+
+	if (arena == NULL) {
+		fprintf(stderr, "failed to allocate arena");
+		return NULL;
+	}
+
+	arena->chunkSize = chunkSize;
+	arena->head = NULL;
+	return arena;
+}
+
+void* arenaAlloc(Arena* arena, size_t size) {
+	if (arena == NULL) {
+		return NULL;
+	}
+
+	// keep every allocation aligned for any type
+	size_t alignment = _Alignof(max_align_t);
+	size = (size + alignment - 1) & ~(alignment - 1);
+
+	ArenaChunk* chunk = arena->head;
+
+	if (chunk == NULL || chunk->size - chunk->used < size) {
+		size_t chunkSize = arena->chunkSize;
+
+		if (chunkSize < size) {
+			chunkSize = size;
+		}
+
+		chunk = calloc(1, sizeof(ArenaChunk) + chunkSize);
+
+		if (chunk == NULL) {
+			fprintf(stderr, "Error: failed to allocate chunk in arena");
+			return NULL;
+		}
+
+		chunk->size = chunkSize;
+		chunk->used = 0;
+		chunk->next = arena->head;
+		arena->head = chunk;
+
+		// grow chunks geometrically so big inputs need only a handful of them
+		if (arena->chunkSize < ARENA_MAX_CHUNK_SIZE) {
+			arena->chunkSize *= 2;
+		}
+	}
+
+	void* ret = (char*)chunk->data + chunk->used;
+	chunk->used += size;
+	return ret;
+}
+
+char* arenaStrndup(Arena* arena, const char* str, int length) {
+	if (arena == NULL || str == NULL) {
+		return NULL;
+	}
+
+	char* ret = arenaAlloc(arena, length + 1);
+
+	if (ret == NULL) {
+		return NULL;
+	}
+
+	memcpy(ret, str, length);
+	ret[length] = '\0';
+	return ret;
+}
+
+void freeArena(Arena* arena) {
+	if (arena == NULL) {
+		return;
+	}
+
+	ArenaChunk* current = arena->head;
+
+	while (current != NULL) {
+		ArenaChunk* next = current->next;
+		free(current);
+		current = next;
+	}
+
+	free(arena);
+}
+
+Interner* interner(Arena* arena) {
+	if (arena == NULL) {
+		return NULL;
+	}
+
+	Interner* interner = malloc(sizeof(Interner));
+
+	if (interner == NULL) {
+		fprintf(stderr, "failed to allocate interner");
+		return NULL;
+	}
+
+	interner->arena = arena;
+	interner->size = 0;
+	interner->capacity = 256;
+	interner->symbols = calloc(interner->capacity, sizeof(Symbol*));
+
+	if (interner->symbols == NULL) {
+		fprintf(stderr, "failed to allocate symbols in interner");
+		free(interner);
+		return NULL;
+	}
+
+	return interner;
+}
+
+static int growInterner(Interner* interner) {
+	int capacity = interner->capacity * 2;
+	Symbol** symbols = calloc(capacity, sizeof(Symbol*));
+
+	if (symbols == NULL) {
+		fprintf(stderr, "Error: failed to grow interner");
+		return 0;
+	}
+
+	for (int i = 0; i < interner->capacity; i++) {
+		Symbol* symbol = interner->symbols[i];
+		if (symbol == NULL) {
+			continue;
+		}
+
+		unsigned long slot = symbol->hash & (capacity - 1);
+		while (symbols[slot] != NULL) {
+			slot = (slot + 1) & (capacity - 1);
+		}
+		symbols[slot] = symbol;
+	}
+
+	free(interner->symbols);
+	interner->symbols = symbols;
+	interner->capacity = capacity;
+	return 1;
+}
+
+// returns the unique copy of the name, str does not have to be NUL terminated
+char* intern(Interner* interner, const char* str, int length) {
+	if (interner == NULL || str == NULL) {
+		return NULL;
+	}
+
+	unsigned long hashed = hashLength((const unsigned char*)str, length);
+	unsigned long slot = hashed & (interner->capacity - 1);
+
+	Symbol* current = interner->symbols[slot];
+	while (current != NULL) {
+		if (current->hash == hashed && current->length == length && memcmp(current->name, str, length) == 0) {
+			return current->name;
+		}
+		slot = (slot + 1) & (interner->capacity - 1);
+		current = interner->symbols[slot];
+	}
+
+	Symbol* symbol = arenaAlloc(interner->arena, sizeof(Symbol) + length + 1);
+
+	if (symbol == NULL) {
+		return NULL;
+	}
+
+	symbol->hash = hashed;
+	symbol->length = length;
+	memcpy(symbol->name, str, length);
+	interner->symbols[slot] = symbol;
+	interner->size++;
+
+	// keep the load factor below one half so probe sequences stay short
+	if (interner->size * 2 > interner->capacity && !growInterner(interner)) {
+		return NULL;
+	}
+
+	return symbol->name;
+}
+
+void freeInterner(Interner* interner) {
+	if (interner == NULL) {
+		return;
+	}
+
+	free(interner->symbols);
+	free(interner);
+}
+
+static inline unsigned long hashKey(HashTable* table, char* key) {
+	return table->interned ? hashPointer(key) : hash((unsigned char*)key);
+}
+
+static inline bool keysEqual(HashTable* table, Bucket* bucket, unsigned long hashed, char* key) {
+	if (bucket->hash != hashed) {
+		return false;
+	}
+
+	return table->interned ? bucket->id == key : strcmp(bucket->id, key) == 0;
+}
+
+// how far a bucket sits behind the slot its hash points to
+static inline int probeDistance(HashTable* table, Bucket* bucket, int slot) {
+	return (slot - (int)(bucket->hash & (table->capacity - 1))) & (table->capacity - 1);
+}
+
+static Bucket* allocateBuckets(int capacity) {
+	Bucket* buckets = calloc(capacity, sizeof(Bucket));
+
+	if (buckets == NULL) {
+		fprintf(stderr, "failed to allocate buckets for hashTable");
+	}
+
+	return buckets;
+}
+
 HashTable* hashTable(int size, GenericFreeFunc freeFunc) {
-	int totalSize = sizeof(HashTable) + (size * sizeof(Bucket*));
-	HashTable* table = malloc(totalSize);
+	HashTable* table = malloc(sizeof(HashTable));
 
 	if (table == NULL) {
 		fprintf(stderr, "failed to allocate memory for hashTable");
 		return NULL;
 	}
 
-	table->size = size;
+	int capacity = MINIMUM_TABLE_CAPACITY;
+	while (capacity < size) {
+		capacity *= 2;
+	}
+
+	table->size = 0;
+	table->capacity = capacity;
+	table->interned = false;
 	table->freeFunc = freeFunc;
-	memset(table->array, 0, size * sizeof(Bucket*));
+	table->array = allocateBuckets(capacity);
+
+	if (table->array == NULL) {
+		free(table);
+		return NULL;
+	}
+
 	return table;
 }
 
-int insertKeyPair(HashTable *table, char *key, void* value) {
-	if (table == NULL || key == NULL) {
-		return 0;
+HashTable* symbolTable(int size, GenericFreeFunc freeFunc) {
+	HashTable* table = hashTable(size, freeFunc);
+
+	if (table != NULL) {
+		table->interned = true;
 	}
-	unsigned long hashedKey = hash((unsigned char*)key) % table->size;
 
-	Bucket* current = table->array[hashedKey];
-	while (current != NULL) {
-		if (strcmp(current->id, key) == 0) {
-			return 0;
+	return table;
+}
+
+// robin hood insertion: a bucket that is further away from its home slot takes over
+// the slot of a closer one, which keeps all probe sequences short
+static void placeBucket(HashTable* table, Bucket bucket) {
+	int mask = table->capacity - 1;
+	int slot = bucket.hash & mask;
+	int distance = 0;
+
+	for (;;) {
+		Bucket* current = &table->array[slot];
+
+		if (current->id == NULL) {
+			*current = bucket;
+			return;
+		}
+
+		int currentDistance = probeDistance(table, current, slot);
+		if (currentDistance < distance) {
+			Bucket displaced = *current;
+			*current = bucket;
+			bucket = displaced;
+			distance = currentDistance;
 		}
-		current = current->next;
+
+		slot = (slot + 1) & mask;
+		distance++;
 	}
+}
 
-	Bucket* newBucket = calloc(1, sizeof(Bucket));
+static int growTable(HashTable* table) {
+	Bucket* old = table->array;
+	int oldCapacity = table->capacity;
 
-	if (newBucket == NULL) {
-		fprintf(stderr, "Error: failed to allocate new Bucket");
+	table->array = allocateBuckets(oldCapacity * 2);
+
+	if (table->array == NULL) {
+		table->array = old;
 		return 0;
 	}
 
-	newBucket->id = strdup(key);
-	if (newBucket->id == NULL) {
-		free(newBucket);
-		return 0;
+	table->capacity = oldCapacity * 2;
+
+	for (int i = 0; i < oldCapacity; i++) {
+		if (old[i].id != NULL) {
+			placeBucket(table, old[i]);
+		}
 	}
 
-	newBucket->value = value;
-	newBucket->next = table->array[hashedKey];
-	table->array[hashedKey] = newBucket;
+	free(old);
 	return 1;
 }
 
-int containsKey(HashTable* table, char* key) {
+// returns the slot holding key or -1, the search can stop as soon as the probed
+// bucket is closer to its home slot than key would be
+static int findSlot(HashTable* table, char* key) {
+	unsigned long hashed = hashKey(table, key);
+	int mask = table->capacity - 1;
+	int slot = hashed & mask;
+
+	for (int distance = 0;; distance++) {
+		Bucket* current = &table->array[slot];
+
+		if (current->id == NULL || probeDistance(table, current, slot) < distance) {
+			return -1;
+		}
+
+		if (keysEqual(table, current, hashed, key)) {
+			return slot;
+		}
+
+		slot = (slot + 1) & mask;
+	}
+}
+
+int insertKeyPair(HashTable *table, char *key, void* value) {
 	if (table == NULL || key == NULL) {
 		return 0;
 	}
 
-	unsigned long hashedKey = hash((unsigned char*)key) % table->size;
+	if (findSlot(table, key) >= 0) {
+		return 0;
+	}
 
-	Bucket* current = table->array[hashedKey];
-	while (current != NULL) {
-		if (strcmp(current->id, key) == 0) {
-			return 1;
-		}
-		current = current->next;
+	// grow at a load factor of 3/4
+	if ((table->size + 1) * 4 > table->capacity * 3 && !growTable(table)) {
+		return 0;
+	}
+
+	Bucket bucket;
+	bucket.id = table->interned ? key : strdup(key);
+	bucket.value = value;
+	bucket.hash = hashKey(table, key);
+
+	if (bucket.id == NULL) {
+		return 0;
 	}
 
-	return 0;
+	placeBucket(table, bucket);
+	table->size++;
+	return 1;
 }
 
-void* getValue(HashTable* table, char* key) {
+int containsKey(HashTable* table, char* key) {
 	if (table == NULL || key == NULL) {
-		return NULL;
+		return 0;
 	}
 
-	unsigned long hashedKey = hash((unsigned char*)key) % table->size;
+	return findSlot(table, key) >= 0;
+}
 
-	Bucket* current = table->array[hashedKey];
-	while (current != NULL) {
-		if (strcmp(current->id, key) == 0) {
-			return current->value;
-		}
-		current = current->next;
+void* getValue(HashTable* table, char* key) {
+	if (table == NULL || key == NULL) {
+		return NULL;
 	}
 
-	return NULL;
+	int slot = findSlot(table, key);
+	return slot >= 0 ? table->array[slot].value : NULL;
 }
 
 int updateKeyPair(HashTable *table, char *key, void* value) {
-	if (table == NULL) {
+	if (table == NULL || key == NULL) {
 		return 0;
 	}
-	unsigned long hashedKey = hash((unsigned char*)key) % table->size;
 
-	Bucket* current = table->array[hashedKey];
-	while (current != NULL) {
-		if (strcmp(current->id, key) == 0) {
-			if (table->freeFunc) {
-				table->freeFunc(current->value);
-			}
-			current->value = value;
-			return 1;
-		}
-		current = current->next;
+	int slot = findSlot(table, key);
+
+	if (slot < 0) {
+		return 0;
+	}
+
+	if (table->freeFunc) {
+		table->freeFunc(table->array[slot].value);
 	}
 
-	return 0;
+	table->array[slot].value = value;
+	return 1;
 }
 
+// backward shift deletion: the rest of the probe sequence moves one slot closer
+// to its home slot, so no tombstones are left behind
 void removeKey(HashTable *table, char *key) {
 	if (table == NULL || key == NULL) {
 		return;
 	}
 
-	unsigned long hashedKey = hash((unsigned char*)key) % table->size;
+	int slot = findSlot(table, key);
 
-	Bucket* current = table->array[hashedKey];
-	Bucket* previous = NULL;
-	while (current != NULL) {
-		if (strcmp(current->id, key) == 0) {
-			if (previous == NULL) {
-				table->array[hashedKey] = current->next;
-			}
+	if (slot < 0) {
+		return;
+	}
 
-			else {
-				previous->next = current->next;
-			}
+	Bucket* current = &table->array[slot];
 
-			free(current->id);
-			if (table->freeFunc) {
-				table->freeFunc(current->value);
-			}
-			free(current);
-			return;
-		}
-		previous = current;
-		current = current->next;
+	if (!table->interned) {
+		free(current->id);
 	}
+	if (table->freeFunc) {
+		table->freeFunc(current->value);
+	}
+
+	int mask = table->capacity - 1;
+	int next = (slot + 1) & mask;
+
+	while (table->array[next].id != NULL && probeDistance(table, &table->array[next], next) > 0) {
+		table->array[slot] = table->array[next];
+		slot = next;
+		next = (next + 1) & mask;
+	}
+
+	table->array[slot].id = NULL;
+	table->array[slot].value = NULL;
+	table->size--;
 }
 
 void freeTable(void *table) {
@@ -256,22 +590,147 @@ void freeTable(void *table) {
 
 	HashTable* t = (HashTable*) table;
 
-	for (int i = 0; i < t->size; i++) {
-		Bucket* current = t->array[i];
-		Bucket* previous = NULL;
+	for (int i = 0; i < t->capacity; i++) {
+		Bucket* current = &t->array[i];
+
+		if (current->id == NULL) {
+			continue;
+		}
 
-		while (current != NULL) {
+		if (!t->interned) {
 			free(current->id);
-			if (t->freeFunc) {
-				t->freeFunc(current->value);
-			}
+		}
+		if (t->freeFunc) {
+			t->freeFunc(current->value);
+		}
+	}
 
-			previous = current;
-			current = current->next;
+	free(t->array);
+	free(t);
+}
+
+ScopeStack* scopeStack(void) {
+	ScopeStack* stack = calloc(1, sizeof(ScopeStack));
 
-			free(previous);
+	if (stack == NULL) {
+		fprintf(stderr, "failed to allocate scope stack");
+		return NULL;
+	}
+
+	stack->names = symbolTable(64, NULL);
+	stack->capacity = 64;
+	stack->bindings = malloc(stack->capacity * sizeof(Binding));
+	stack->maxDepth = 16;
+	stack->scopeStarts = malloc(stack->maxDepth * sizeof(int));
+
+	if (stack->names == NULL || stack->bindings == NULL || stack->scopeStarts == NULL) {
+		fprintf(stderr, "failed to allocate scope stack");
+		freeScopeStack(stack);
+		return NULL;
+	}
+
+	return stack;
+}
+
+int enterScope(ScopeStack* stack) {
+	if (stack == NULL) {
+		return 0;
+	}
+
+	if (stack->depth == stack->maxDepth) {
+		int* tmp = realloc(stack->scopeStarts, stack->maxDepth * 2 * sizeof(int));
+		if (tmp == NULL) {
+			fprintf(stderr, "Error: failed to grow scope stack");
+			return 0;
 		}
+		stack->scopeStarts = tmp;
+		stack->maxDepth *= 2;
 	}
 
-	free(t);
+	stack->scopeStarts[stack->depth++] = stack->size;
+	return 1;
+}
+
+// walks the undo log of the innermost scope and points every name back to the binding it shadowed
+void exitScope(ScopeStack* stack) {
+	if (stack == NULL || stack->depth == 0) {
+		return;
+	}
+
+	int start = stack->scopeStarts[--stack->depth];
+
+	for (int i = stack->size - 1; i >= start; i--) {
+		Binding* binding = &stack->bindings[i];
+
+		if (binding->shadowed >= 0) {
+			updateKeyPair(stack->names, binding->id, (void*)(intptr_t)(binding->shadowed + 1));
+		}
+		else {
+			removeKey(stack->names, binding->id);
+		}
+	}
+
+	stack->size = start;
+}
+
+// fails if id is already declared in the innermost scope
+int declareBinding(ScopeStack* stack, char* id, int value) {
+	if (stack == NULL || id == NULL || stack->depth == 0) {
+		return 0;
+	}
+
+	Binding* outer = lookupBinding(stack, id);
+
+	if (outer != NULL && outer->scope == stack->depth - 1) {
+		return 0;
+	}
+
+	if (stack->size == stack->capacity) {
+		Binding* tmp = realloc(stack->bindings, stack->capacity * 2 * sizeof(Binding));
+		if (tmp == NULL) {
+			fprintf(stderr, "Error: failed to grow bindings in scope stack");
+			return 0;
+		}
+		stack->bindings = tmp;
+		stack->capacity *= 2;
+		outer = lookupBinding(stack, id);
+	}
+
+	Binding* binding = &stack->bindings[stack->size];
+	binding->id = id;
+	binding->value = value;
+	binding->scope = stack->depth - 1;
+	binding->shadowed = outer != NULL ? (int)(outer - stack->bindings) : -1;
+
+	// the map stores index + 1 so that a missing name and the first binding can be told apart
+	void* slot = (void*)(intptr_t)(stack->size + 1);
+	int success = outer != NULL ? updateKeyPair(stack->names, id, slot) : insertKeyPair(stack->names, id, slot);
+
+	if (!success) {
+		return 0;
+	}
+
+	stack->size++;
+	return 1;
+}
+
+// returns the innermost visible binding of id, the pointer is only valid until the next declaration
+Binding* lookupBinding(ScopeStack* stack, char* id) {
+	if (stack == NULL || id == NULL) {
+		return NULL;
+	}
+
+	intptr_t slot = (intptr_t)getValue(stack->names, id);
+	return slot > 0 ? &stack->bindings[slot - 1] : NULL;
+}
+
+void freeScopeStack(ScopeStack* stack) {
+	if (stack == NULL) {
+		return;
+	}
+
+	freeTable(stack->names);
+	free(stack->bindings);
+	free(stack->scopeStarts);
+	free(stack);
 }
@@ -2,13 +2,42 @@
 #define DYNAMIC_ARRAY_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 static const int INITIAL_CAPACITY = 16;
 static const int MINUMUM_SIZE = 16;
+static const int MINIMUM_TABLE_CAPACITY = 8;
+static const size_t ARENA_CHUNK_SIZE = 64 * 1024;
+static const size_t ARENA_MAX_CHUNK_SIZE = 16 * 1024 * 1024;
 
 typedef struct HashTable HashTable;
 typedef struct Bucket Bucket;
 typedef struct Box Box;
+typedef struct Arena Arena;
+typedef struct ArenaChunk ArenaChunk;
+typedef struct Interner Interner;
+typedef struct Symbol Symbol;
+typedef struct Binding Binding;
+typedef struct ScopeStack ScopeStack;
+
+// bump allocator, everything allocated from it is released at once by freeArena
+// memory handed out is always zeroed since chunks are calloc'd and never reused
+struct Arena {
+	size_t chunkSize;
+	ArenaChunk* head;
+};
+
+struct ArenaChunk {
+	ArenaChunk* next;
+	size_t size;
+	size_t used;
+	max_align_t data[];
+};
+
+Arena* arena(size_t chunkSize);
+void* arenaAlloc(Arena* arena, size_t size);
+char* arenaStrndup(Arena* arena, const char* str, int length);
+void freeArena(Arena* arena);
 
 typedef void (*GenericFreeFunc) (void*);
 typedef struct DynamicArray {
@@ -18,9 +47,12 @@ typedef struct DynamicArray {
 	int size;
 	void** array;
 	GenericFreeFunc freeFunc;
+	// if set, the array and its storage live in the arena and are never freed individually
+	Arena* arena;
 } DynamicArray;
 
 DynamicArray* dynamicArray(int growthFactor, GenericFreeFunc freeFunc);
+DynamicArray* arenaDynamicArray(Arena* arena, int growthFactor);
 void* getItem(DynamicArray* dynamicArray, int idx);
 void* peekArray(DynamicArray* dynamicArray);
 int pushItem(DynamicArray* dynamicArray, void* item);
@@ -40,19 +72,60 @@ static inline unsigned long hash(unsigned char *str)
     return hash;
 }
 
+static inline unsigned long hashLength(const unsigned char* str, int length)
+{
+    unsigned long hash = 5381;
+
+    for (int i = 0; i < length; i++)
+        hash = ((hash << 5) + hash) + str[i];
+
+    return hash;
+}
+
+// interned keys are unique per name, so they are hashed by address instead of by content
+static inline unsigned long hashPointer(const void* ptr)
+{
+    return ((unsigned long)ptr >> 4) * 0x9E3779B97F4A7C15ul;
+}
+
+// every distinct identifier is stored once in the arena, so two interned names
+// are equal exactly when their pointers are equal
+struct Interner {
+	Arena* arena;
+	int size;
+	int capacity;
+	Symbol** symbols;
+};
+
+struct Symbol {
+	unsigned long hash;
+	int length;
+	char name[];
+};
+
+Interner* interner(Arena* arena);
+char* intern(Interner* interner, const char* str, int length);
+void freeInterner(Interner* interner);
+
+// open addressing with robin hood probing, grows once it is three quarters full
 struct HashTable {
 	int size;
+	int capacity;
+	// keys are interned names, they are compared by identity and not copied
+	bool interned;
 	GenericFreeFunc freeFunc;
-	Bucket* array[];
+	Bucket* array;
 };
 
+// a slot is empty when id is NULL, the full hash is kept to skip most key compares
 struct Bucket {
 	char* id;
 	void* value;
-	Bucket* next;
+	unsigned long hash;
 };
 
 HashTable* hashTable(int size, GenericFreeFunc freeFunc);
+HashTable* symbolTable(int size, GenericFreeFunc freeFunc);
 void* getValue(HashTable* table, char* key);
 int insertKeyPair(HashTable* table, char* key, void* value);
 int containsKey(HashTable* table, char* key);
@@ -60,4 +133,33 @@ int updateKeyPair(HashTable* table, char* key, void* value);
 void removeKey(HashTable* table, char* key);
 void freeTable(void* table);
 
+// one declaration, the bindings of all open scopes together form the undo log
+struct Binding {
+	char* id;
+	int value;
+	// depth of the declaring scope, 0 is the outermost one
+	int scope;
+	// index of the binding of the same id in an outer scope or -1
+	int shadowed;
+};
+
+// scoped symbol table: each name maps to its innermost binding, so a lookup is a single
+// hash. leaving a scope restores what its bindings shadowed. ids have to be interned
+struct ScopeStack {
+	HashTable* names;
+	Binding* bindings;
+	int size;
+	int capacity;
+	int* scopeStarts;
+	int depth;
+	int maxDepth;
+};
+
+ScopeStack* scopeStack(void);
+int enterScope(ScopeStack* stack);
+void exitScope(ScopeStack* stack);
+int declareBinding(ScopeStack* stack, char* id, int value);
+Binding* lookupBinding(ScopeStack* stack, char* id);
+void freeScopeStack(ScopeStack* stack);
+
 #endif